@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""
+Compare two microbench JSON results and flag regressions.
+
+microbench writes Google Benchmark JSON (csvfiles/microbench.json by default).
+Keep one run as a baseline and compare later runs against it: every benchmark
+present in both is listed with its time change and its allocations per
+iteration, and the exit status is 1 if any got slower than --threshold percent
+or allocates more than before, so the check can gate a build.
+
+Usage:
+  python3 analysis/compare_microbench.py baseline.json csvfiles/microbench.json
+  python3 analysis/compare_microbench.py baseline.json new.json --threshold 10 --filter RoundTrip
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    results = {}
+    for bench in data.get("benchmarks", []):
+        # With --benchmark_repetitions only the median is compared
+        if bench.get("run_type") == "aggregate" and bench.get("aggregate_name") != "median":
+            continue
+        name = bench.get("run_name", bench["name"])
+        if bench.get("error_occurred"):
+            continue
+        results[name] = bench
+    return data.get("context", {}), results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two microbench JSON results")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="percent slowdown reported as a regression (default: 5)")
+    parser.add_argument("--filter", default="", help="only benchmarks whose name contains this")
+    args = parser.parse_args()
+
+    base_context, base = load(args.baseline)
+    context, current = load(args.current)
+    for key in ("payload", "grpc_version", "protobuf_version", "num_cpus"):
+        if base_context.get(key) != context.get(key):
+            print(f"note: {key} differs: {base_context.get(key)} -> {context.get(key)}")
+
+    regressions = 0
+    print(f"{'Benchmark':58} {'Base':>12} {'Now':>12} {'Change':>8} {'Allocs':>13}")
+    for name in sorted(base.keys() & current.keys()):
+        if args.filter not in name:
+            continue
+        old, new = base[name], current[name]
+        old_time, new_time = old["real_time"], new["real_time"]
+        change = (new_time - old_time) / old_time * 100.0 if old_time > 0 else 0.0
+        old_allocs, new_allocs = old.get("allocs", 0.0), new.get("allocs", 0.0)
+        flag = ""
+        if change > args.threshold or new_allocs > old_allocs + 0.5:
+            flag = "  REGRESSION"
+            regressions += 1
+        print(f"{name:58} {old_time:>10.1f}{old['time_unit']:>2} {new_time:>10.1f}{new['time_unit']:>2} "
+              f"{change:>+7.1f}% {old_allocs:>6.1f}->{new_allocs:<5.1f}{flag}")
+
+    for name in sorted(base.keys() - current.keys()):
+        print(f"missing from {args.current}: {name}")
+
+    print(f"\n{regressions} regression(s) above {args.threshold:.1f}%")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""
+Merge latency histogram files written by benchmarkHead and print percentiles.
+
+Each run writes csvfiles/latency_histograms_<pattern>.hist with one histogram per
+payload size. Histograms with the same label (pattern:payloadSize) are merged
+bucket by bucket, so results from repeated runs or from several head nodes can
+be combined without losing tail accuracy.
+
+Usage:
+  python3 analysis/merge_histograms.py csvfiles/latency_histograms_direct.hist [more.hist ...]
+  python3 analysis/merge_histograms.py run*/latency_histograms_twohop.hist --out merged.hist --csv merged.csv
+"""
+
+import argparse
+import sys
+
+PERCENTILES = [50.0, 90.0, 99.0, 99.9, 99.99]
+
+
+class Histogram:
+    def __init__(self, sub_bucket_bits):
+        self.sub_bucket_bits = sub_bucket_bits
+        self.counts = {}
+        self.count = 0
+        self.min = None
+        self.max = 0
+        self.sum = 0
+
+    def merge(self, other):
+        if other.sub_bucket_bits != self.sub_bucket_bits:
+            raise ValueError("cannot merge histograms with different subBucketBits")
+        for index, c in other.counts.items():
+            self.counts[index] = self.counts.get(index, 0) + c
+        self.count += other.count
+        self.sum += other.sum
+        self.max = max(self.max, other.max)
+        if other.count:
+            self.min = other.min if self.min is None else min(self.min, other.min)
+
+    def highest_equivalent_value(self, index):
+        half = 1 << (self.sub_bucket_bits - 1)
+        if index < 2 * half:
+            return index
+        shift = index // half - 1
+        mantissa = index - shift * half
+        return ((mantissa + 1) << shift) - 1
+
+    def value_at_percentile(self, percentile):
+        if self.count == 0:
+            return 0
+        target = int(percentile / 100.0 * self.count + 0.5)
+        target = max(1, min(target, self.count))
+        cumulative = 0
+        for index in sorted(self.counts):
+            cumulative += self.counts[index]
+            if cumulative >= target:
+                return min(self.highest_equivalent_value(index), self.max)
+        return self.max
+
+    def write(self, out, label):
+        out.write(f"histogram {label} subBucketBits={self.sub_bucket_bits} count={self.count} "
+                  f"min={self.min or 0} max={self.max} sum={self.sum}\n")
+        for index in sorted(self.counts):
+            out.write(f"{index} {self.counts[index]}\n")
+        out.write("end\n")
+
+
+def load_histograms(path):
+    """Return {label: Histogram} for every histogram in a .hist file"""
+    histograms = {}
+    current = None
+    label = None
+    with open(path, 'r') as file:
+        for line in file:
+            parts = line.split()
+            if not parts:
+                continue
+            if parts[0] == 'histogram':
+                label = parts[1]
+                fields = dict(p.split('=', 1) for p in parts[2:])
+                current = Histogram(int(fields['subBucketBits']))
+                current.count = int(fields['count'])
+                current.min = int(fields['min'])
+                current.max = int(fields['max'])
+                current.sum = int(fields['sum'])
+            elif parts[0] == 'end':
+                histograms[label] = current
+                current = None
+            elif current is not None:
+                current.counts[int(parts[0])] = int(parts[1])
+    return histograms
+
+
+def label_sort_key(label):
+    pattern, _, size = label.rpartition(':')
+    return (pattern, int(size) if size.isdigit() else 0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Merge benchmarkHead latency histograms')
+    parser.add_argument('files', nargs='+', help='.hist files to merge')
+    parser.add_argument('--out', help='Write the merged histograms to this .hist file')
+    parser.add_argument('--csv', help='Write per-label percentiles (ms) to this CSV file')
+    args = parser.parse_args()
+
+    merged = {}
+    for path in args.files:
+        for label, histogram in load_histograms(path).items():
+            if label in merged:
+                merged[label].merge(histogram)
+            else:
+                merged[label] = histogram
+
+    if not merged:
+        print("No histograms found")
+        return 1
+
+    header = ['Label', 'Count', 'MeanMs'] + [f'P{p:g}Ms' for p in PERCENTILES] + ['MaxMs']
+    rows = []
+    for label in sorted(merged, key=label_sort_key):
+        h = merged[label]
+        mean = h.sum / h.count / 1e6 if h.count else 0.0
+        rows.append([label, str(h.count), f"{mean:.6f}"] +
+                    [f"{h.value_at_percentile(p) / 1e6:.6f}" for p in PERCENTILES] +
+                    [f"{h.max / 1e6:.6f}"])
+
+    print(' '.join(f"{col:>14}" for col in header))
+    for row in rows:
+        print(' '.join(f"{col:>14}" for col in row))
+
+    if args.out:
+        with open(args.out, 'w') as out:
+            for label in sorted(merged, key=label_sort_key):
+                merged[label].write(out, label)
+        print(f"\nMerged histograms written to {args.out}")
+
+    if args.csv:
+        with open(args.csv, 'w') as out:
+            out.write(','.join(header) + '\n')
+            for row in rows:
+                out.write(','.join(row) + '\n')
+        print(f"Percentiles written to {args.csv}")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""
+Plot throughput-latency curves from benchmarkHead --concurrency sweeps.
+
+Usage:
+    python3 analysis/plot_concurrency_curves.py --csv-dir csvfiles --out-dir benchmark_plots
+
+Reads every csvfiles/concurrency_summary_<pattern><suffix>.csv and draws, per file, achieved
+throughput against p50 and p99 latency with one curve per payload size and each point labelled
+with its concurrency level. The knee is where the curve turns from flat (more throughput for
+free) to vertical (only more queueing).
+"""
+
+import argparse
+from pathlib import Path
+import pandas as pd
+import matplotlib.pyplot as plt
+
+
+def plot_curves(csv_path: Path, out_dir: Path):
+    df = pd.read_csv(csv_path)
+    name = csv_path.stem.replace('concurrency_summary_', '')
+
+    fig, axes = plt.subplots(1, 2, figsize=(16, 7), sharex=True)
+    for payload, group in df.groupby('PayloadSize'):
+        group = group.sort_values('Concurrency')
+        for ax, column in zip(axes, ['P50Ms', 'P99Ms']):
+            ax.plot(group['AchievedQps'], group[column], marker='o', label=f'{payload} B')
+            for _, row in group.iterrows():
+                ax.annotate(str(int(row['Concurrency'])), (row['AchievedQps'], row[column]),
+                            textcoords='offset points', xytext=(4, 4), fontsize=8)
+
+    for ax, label in zip(axes, ['p50', 'p99']):
+        ax.set_xlabel('Achieved throughput (req/s)')
+        ax.set_ylabel(f'{label} latency (ms)')
+        ax.set_title(f'{name}: throughput vs {label} latency')
+        ax.grid(True, alpha=0.3)
+        ax.legend(title='Payload')
+
+    out_dir.mkdir(parents=True, exist_ok=True)
+    out_path = out_dir / f'{name}_concurrency_curves.png'
+    fig.tight_layout()
+    fig.savefig(out_path, dpi=200)
+    plt.close(fig)
+    print(f'Saved {out_path}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--csv-dir', default='csvfiles', help='Directory holding concurrency_summary_*.csv')
+    parser.add_argument('--out-dir', default='benchmark_plots', help='Where to write the plots')
+    args = parser.parse_args()
+
+    files = sorted(Path(args.csv_dir).glob('concurrency_summary_*.csv'))
+    if not files:
+        print(f'No concurrency_summary_*.csv files in {args.csv_dir}')
+        return
+    for csv_path in files:
+        plot_curves(csv_path, Path(args.out_dir))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+"""
+Plot multicast tree latency against fan-out and depth from benchmarkHead --pattern tree runs.
+
+Usage:
+    python3 analysis/plot_tree_topology.py --csv csvfiles/tree_summary.csv --out-dir benchmark_plots
+
+Reads the tree_summary.csv that scripts/run_tree_topology.sh builds (one row per topology and
+payload size) and draws, per payload size, p50 and p99 latency against the number of workers
+reached, with one curve per fan-out and each point labelled with its depth. For a given cluster
+size, the lowest point at that worker count is the broadcast topology to pick.
+"""
+
+import argparse
+from pathlib import Path
+import pandas as pd
+import matplotlib.pyplot as plt
+
+
+def plot_payload(df: pd.DataFrame, payload: int, out_dir: Path):
+    fig, axes = plt.subplots(1, 2, figsize=(16, 7), sharex=True)
+    for fanout, group in df.groupby('Fanout'):
+        group = group.sort_values('Workers')
+        for ax, column in zip(axes, ['P50Ms', 'P99Ms']):
+            ax.plot(group['Workers'], group[column], marker='o', label=f'k = {fanout}')
+            for _, row in group.iterrows():
+                ax.annotate(f"d={int(row['Depth'])}", (row['Workers'], row[column]),
+                            textcoords='offset points', xytext=(4, 4), fontsize=8)
+
+    for ax, label in zip(axes, ['p50', 'p99']):
+        ax.set_xscale('log')
+        ax.set_xlabel('Workers reached')
+        ax.set_ylabel(f'{label} latency (ms)')
+        ax.set_title(f'Tree multicast, {payload} B: workers vs {label} latency')
+        ax.grid(True, alpha=0.3)
+        ax.legend(title='Fan-out')
+
+    out_dir.mkdir(parents=True, exist_ok=True)
+    out_path = out_dir / f'tree_topology_{payload}.png'
+    fig.tight_layout()
+    fig.savefig(out_path, dpi=200)
+    plt.close(fig)
+    print(f'Saved {out_path}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--csv', default='csvfiles/tree_summary.csv', help='tree_summary.csv to plot')
+    parser.add_argument('--out-dir', default='benchmark_plots', help='Where to write the plots')
+    args = parser.parse_args()
+
+    csv_path = Path(args.csv)
+    if not csv_path.exists():
+        print(f'No {csv_path}; run scripts/run_tree_topology.sh first')
+        return
+    df = pd.read_csv(csv_path)
+    # Single-request latency only; pipelined rows measure queueing as well
+    df = df[df['Mode'] == 'latency']
+    for payload, group in df.groupby('PayloadSize'):
+        plot_payload(group, payload, Path(args.out_dir))
+
+
+if __name__ == '__main__':
+    main()
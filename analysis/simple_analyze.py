@@ -8,16 +8,20 @@ import csv
 import os
 import statistics
 
-def load_pattern_data(pattern):
+# Output-file suffix of each head transport, as written by benchmarkHead
+TRANSPORTS = {'': 'gRPC unary', '_stream': 'gRPC stream', '_shm': 'Shared memory', '_tcp': 'Raw TCP'}
+
+def load_pattern_data(pattern, suffix='', quiet=False):
     """Load benchmark data for a specific pattern"""
     # Ensure csvfiles directory exists
     if not os.path.exists("csvfiles"):
         print(f"csvfiles directory not found - no benchmark data available")
         return None
         
-    filename = f"csvfiles/benchmark_results_{pattern}.csv"
+    filename = f"csvfiles/benchmark_results_{pattern}{suffix}.csv"
     if not os.path.exists(filename):
-        print(f"Warning: {filename} not found, skipping {pattern} pattern")
+        if not quiet:
+            print(f"Warning: {filename} not found, skipping {pattern} pattern")
         return None
     
     try:
@@ -32,7 +36,7 @@ def load_pattern_data(pattern):
                         'pattern': row.get('Pattern', pattern)
                     })
         
-        print(f"Loaded {len(measurements)} successful measurements for {pattern} pattern")
+        print(f"Loaded {len(measurements)} successful measurements for {pattern}{suffix} pattern")
         return measurements
     except Exception as e:
         print(f"Error loading {filename}: {e}")
@@ -193,6 +197,45 @@ def create_comparison_plot(pattern_stats, patterns):
     
     print(f"  Comparison plot saved: {filename}")
 
+def create_transport_plot(pattern):
+    """Plot every transport measured for a pattern on one chart, gRPC against the baselines"""
+    transport_stats = {}
+    for suffix, label in TRANSPORTS.items():
+        stats = calculate_stats(load_pattern_data(pattern, suffix, quiet=True))
+        if stats is not None:
+            transport_stats[label] = stats
+    if len(transport_stats) < 2:
+        return
+
+    try:
+        import matplotlib.pyplot as plt
+    except ImportError:
+        print("Matplotlib not available - skipping transport plot generation")
+        return
+
+    plt.figure(figsize=(14, 10))
+    for label, stats in transport_stats.items():
+        payload_sizes = sorted(stats.keys())
+        plt.plot(payload_sizes, [stats[size]['median'] for size in payload_sizes],
+                 marker='o', label=label, linewidth=2, markersize=6)
+
+    plt.xlabel('Payload Size (bytes)', fontsize=12)
+    plt.ylabel('Median Latency (milliseconds)', fontsize=12)
+    plt.title(f'{pattern.capitalize()} Pattern - Transport Comparison', fontsize=14, fontweight='bold')
+    plt.legend(fontsize=11)
+    plt.grid(True, alpha=0.3)
+
+    plots_dir = 'benchmark_plots'
+    if not os.path.exists(plots_dir):
+        os.makedirs(plots_dir)
+
+    filename = f'{plots_dir}/{pattern}_transport_comparison.png'
+    plt.tight_layout()
+    plt.savefig(filename, dpi=300, bbox_inches='tight')
+    plt.close()
+
+    print(f"  Transport comparison plot saved: {filename}")
+
 def main():
     print("=== Unified Communication Latency Benchmark Analysis ===")
     print()
@@ -220,6 +263,10 @@ def main():
     # Create comparison plot
     print(f"\nGenerating comparison plot...")
     create_comparison_plot(pattern_stats, patterns)
+
+    # gRPC against the shared-memory and raw TCP baselines, where measured
+    for pattern in patterns:
+        create_transport_plot(pattern)
     
     # Print comparison analysis
     print("\n" + "=" * 60)
@@ -0,0 +1,80 @@
+#!/bin/bash
+
+# Head-side connection pool scaling benchmark
+# Usage: ./run_channel_scaling.sh [channels] [window] [policy] [requests]
+# channels: comma-separated --channels-per-worker values to test (default: 1,2,4,8)
+# window:   closed-loop requests kept outstanding (default: 64)
+# policy:   round-robin or least-outstanding (default: round-robin)
+# requests: requests sent per configuration (default: 50000)
+
+if [ "$1" = "--help" ] || [ "$1" = "-h" ]; then
+    echo "=== Channel Pool Scaling Benchmark ==="
+    echo "Usage: $0 [channels] [window] [policy] [requests]"
+    echo
+    echo "Starts one async benchmarkWorker, drives it with a pipelined closed-loop"
+    echo "benchmarkHead for each pool size and records achieved requests/sec and"
+    echo "p50/p99 latency in csvfiles/channel_scaling.csv."
+    echo
+    echo "Examples:"
+    echo "  $0                                   # 1-8 channels, 64 outstanding"
+    echo "  $0 1,2,4,8,16 256 least-outstanding  # deeper window, least-outstanding"
+    echo
+    exit 0
+fi
+
+CHANNELS=${1:-1,2,4,8}
+WINDOW=${2:-64}
+POLICY=${3:-round-robin}
+REQUESTS=${4:-50000}
+PORT=50091
+PAYLOAD=64
+
+echo "=== Channel Pool Scaling Benchmark ==="
+echo "Channels per worker: $CHANNELS"
+echo "Window: $WINDOW outstanding requests, $POLICY selection"
+echo "Requests per configuration: $REQUESTS"
+echo
+
+echo "Building benchmark components..."
+make -s benchmark_head benchmark_worker
+
+if [ $? -ne 0 ]; then
+    echo "Build failed!"
+    exit 1
+fi
+
+mkdir -p csvfiles
+OUTPUT=csvfiles/channel_scaling.csv
+echo "Channels,Policy,Window,AchievedQps,P50Ms,P99Ms" > $OUTPUT
+
+./build/benchmarkWorker --port $PORT --server-mode async > channel_scaling.log 2>&1 &
+WORKER_PID=$!
+sleep 2
+
+IFS=',' read -ra CHANNEL_LIST <<< "$CHANNELS"
+
+for channels in "${CHANNEL_LIST[@]}"; do
+    echo "Testing $channels channel(s) per worker..."
+    ./build/benchmarkHead --pattern direct --workers localhost:$PORT --window $WINDOW \
+                          --channels-per-worker $channels --channel-policy $POLICY \
+                          --samples $REQUESTS --min-size $PAYLOAD --max-size $PAYLOAD > /dev/null
+
+    summary=csvfiles/closedloop_summary_direct.csv
+    if [ "$channels" -gt 1 ]; then
+        summary=csvfiles/closedloop_summary_direct_ch$channels.csv
+    fi
+
+    # Row layout: PayloadSize,OfferedQps,AchievedQps,MeanMs,P50Ms,P90Ms,P99Ms,...
+    tail -n 1 $summary | \
+        awk -F, -v channels=$channels -v policy=$POLICY -v window=$WINDOW \
+            '{ printf "%s,%s,%s,%s,%s,%s\n", channels, policy, window, $3, $5, $7 }' >> $OUTPUT
+    tail -n 1 $OUTPUT
+done
+
+kill $WORKER_PID 2>/dev/null
+wait $WORKER_PID 2>/dev/null
+rm -f channel_scaling.log
+
+echo
+echo "=== Channel Scaling Benchmark Complete ==="
+echo "Results saved to $OUTPUT"
@@ -0,0 +1,86 @@
+#!/bin/bash
+
+# Payload content x gRPC compression benchmark
+# Usage: ./run_compression_matrix.sh [payloads] [compressions] [size] [requests]
+# payloads:     comma-separated --payload kinds to test (default: repeat,text,protobuf,random)
+# compressions: comma-separated --compression algorithms (default: none,deflate,gzip)
+# size:         payload size in bytes (default: 16384)
+# requests:     requests sent per configuration (default: 5000)
+
+if [ "$1" = "--help" ] || [ "$1" = "-h" ]; then
+    echo "=== Compression Matrix Benchmark ==="
+    echo "Usage: $0 [payloads] [compressions] [size] [requests]"
+    echo
+    echo "Starts one async benchmarkWorker per compression setting (responses use the"
+    echo "same algorithm as requests), drives it with a pipelined closed-loop"
+    echo "benchmarkHead for every payload kind and records achieved requests/sec,"
+    echo "p50/p99 latency and head CPU per request in csvfiles/compression_matrix.csv."
+    echo
+    echo "Examples:"
+    echo "  $0                                        # 16 KB payloads, all kinds and algorithms"
+    echo "  $0 text,file:/path/to/sample.json gzip 65536"
+    echo
+    exit 0
+fi
+
+PAYLOADS=${1:-repeat,text,protobuf,random}
+COMPRESSIONS=${2:-none,deflate,gzip}
+SIZE=${3:-16384}
+REQUESTS=${4:-5000}
+WINDOW=8
+PORT=50092
+
+echo "=== Compression Matrix Benchmark ==="
+echo "Payloads: $PAYLOADS"
+echo "Compression: $COMPRESSIONS"
+echo "Payload size: $SIZE bytes, $REQUESTS requests per configuration"
+echo
+
+echo "Building benchmark components..."
+make -s benchmark_head benchmark_worker
+
+if [ $? -ne 0 ]; then
+    echo "Build failed!"
+    exit 1
+fi
+
+mkdir -p csvfiles
+OUTPUT=csvfiles/compression_matrix.csv
+echo "Payload,Compression,PayloadSize,AchievedQps,P50Ms,P99Ms,HeadCpuUsPerRequest" > $OUTPUT
+
+IFS=',' read -ra PAYLOAD_LIST <<< "$PAYLOADS"
+IFS=',' read -ra COMPRESSION_LIST <<< "$COMPRESSIONS"
+
+for compression in "${COMPRESSION_LIST[@]}"; do
+    ./build/benchmarkWorker --port $PORT --server-mode async --compression $compression > compression_matrix.log 2>&1 &
+    WORKER_PID=$!
+    sleep 2
+
+    for payload in "${PAYLOAD_LIST[@]}"; do
+        echo "Testing $payload payloads with $compression compression..."
+        ./build/benchmarkHead --pattern direct --workers localhost:$PORT --window $WINDOW \
+                              --payload $payload --compression $compression \
+                              --samples $REQUESTS --min-size $SIZE --max-size $SIZE > /dev/null
+
+        # Summary files carry _<payload> unless repeat and _<compression> unless none
+        label=${payload%%:*}
+        suffix=""
+        [ "$label" != "repeat" ] && suffix="${suffix}_$label"
+        [ "$compression" != "none" ] && suffix="${suffix}_$compression"
+        summary=csvfiles/closedloop_summary_direct$suffix.csv
+
+        # Row layout: PayloadSize,OfferedQps,AchievedQps,MeanMs,P50Ms,P90Ms,P99Ms,...,HeadCpuUsPerRequest
+        tail -n 1 $summary | \
+            awk -F, -v payload=$label -v compression=$compression \
+                '{ printf "%s,%s,%s,%s,%s,%s,%s\n", payload, compression, $1, $3, $5, $7, $21 }' >> $OUTPUT
+        tail -n 1 $OUTPUT
+    done
+
+    kill $WORKER_PID 2>/dev/null
+    wait $WORKER_PID 2>/dev/null
+done
+rm -f compression_matrix.log
+
+echo
+echo "=== Compression Matrix Benchmark Complete ==="
+echo "Results saved to $OUTPUT"
@@ -0,0 +1,102 @@
+#!/bin/bash
+
+# Hedged and tied request comparison
+# Usage: ./run_hedging_comparison.sh [delay-ms] [delay-fraction] [samples] [payload] [fixed-hedge-ms] [server-mode]
+# delay-ms:       injected delay of a slow request at each worker (default: 10)
+# delay-fraction: fraction of requests each worker delays (default: 0.02)
+# samples:        samples per variant (default: 2000)
+# payload:        payload size in bytes (default: 1024)
+# fixed-hedge-ms: hedge delay of the fixed-delay variant (default: 1)
+# server-mode:    worker engine, sync, callback or async (default: callback)
+
+if [ "$1" = "--help" ] || [ "$1" = "-h" ]; then
+    echo "=== Hedged and Tied Request Comparison ==="
+    echo "Usage: $0 [delay-ms] [delay-fraction] [samples] [payload] [fixed-hedge-ms] [server-mode]"
+    echo
+    echo "Starts two benchmarkWorkers that hold a random delay-fraction of their"
+    echo "requests for delay-ms, and runs benchmarkHead against them four times:"
+    echo "  baseline  --pattern hedged --hedge-delay none (no backups)"
+    echo "  fixed     --pattern hedged --hedge-delay <fixed-hedge-ms>"
+    echo "  p95       --pattern hedged --hedge-delay p95"
+    echo "  tied      --pattern tied"
+    echo "The per-variant hedging summaries are gathered into"
+    echo "csvfiles/hedging_comparison.csv: tail latency next to the extra load"
+    echo "(BackupRate) each variant paid for it."
+    echo
+    echo "Examples:"
+    echo "  $0                     # 10 ms stalls on 2% of requests"
+    echo "  $0 50 0.01 5000 4096   # rarer, longer stalls, 4 KiB payloads"
+    echo
+    exit 0
+fi
+
+DELAY_MS=${1:-10}
+DELAY_FRACTION=${2:-0.02}
+SAMPLES=${3:-2000}
+PAYLOAD=${4:-1024}
+FIXED_HEDGE_MS=${5:-1}
+SERVER_MODE=${6:-callback}
+PORT1=50300
+PORT2=50301
+WORKERS="localhost:$PORT1,localhost:$PORT2"
+
+echo "=== Hedged and Tied Request Comparison ==="
+echo "Slow requests: $DELAY_FRACTION of each worker's, held $DELAY_MS ms"
+echo "Payload: $PAYLOAD bytes, $SAMPLES samples per variant"
+echo "Worker engine: $SERVER_MODE"
+echo
+
+echo "Building benchmark components..."
+make -s benchmark_head benchmark_worker
+
+if [ $? -ne 0 ]; then
+    echo "Build failed!"
+    exit 1
+fi
+
+mkdir -p csvfiles
+OUTPUT=csvfiles/hedging_comparison.csv
+rm -f "$OUTPUT"
+
+./build/benchmarkWorker --port $PORT1 --server-mode $SERVER_MODE --delay-ms $DELAY_MS \
+                        --delay-fraction $DELAY_FRACTION > hedging_worker_1.log 2>&1 &
+WORKER1_PID=$!
+./build/benchmarkWorker --port $PORT2 --server-mode $SERVER_MODE --delay-ms $DELAY_MS \
+                        --delay-fraction $DELAY_FRACTION > hedging_worker_2.log 2>&1 &
+WORKER2_PID=$!
+sleep 2
+
+run_variant() {
+    local variant=$1
+    local pattern=$2
+    shift 2
+    echo "Testing $variant..."
+    ./build/benchmarkHead --pattern $pattern --workers $WORKERS --samples $SAMPLES \
+                          --min-size $PAYLOAD --max-size $PAYLOAD "$@" | grep -E "Testing payload|hedging:"
+
+    local summary=csvfiles/hedging_summary_$pattern.csv
+    if [ ! -f "$summary" ]; then
+        echo "  no $summary; skipping"
+        return
+    fi
+    if [ ! -f "$OUTPUT" ]; then
+        echo "Variant,$(head -1 "$summary")" > "$OUTPUT"
+    fi
+    tail -n +2 "$summary" | sed "s/^/$variant,/" >> "$OUTPUT"
+}
+
+run_variant baseline hedged --hedge-delay none
+run_variant fixed hedged --hedge-delay $FIXED_HEDGE_MS
+run_variant p95 hedged --hedge-delay p95
+run_variant tied tied
+
+kill $WORKER1_PID $WORKER2_PID 2>/dev/null
+wait $WORKER1_PID $WORKER2_PID 2>/dev/null
+rm -f hedging_worker_*.log
+
+echo
+echo "=== Hedging Comparison Complete ==="
+if [ -f "$OUTPUT" ]; then
+    cut -d, -f1,4,6,7,9,10,11 "$OUTPUT"
+    echo "Results saved to $OUTPUT"
+fi
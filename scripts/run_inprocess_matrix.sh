@@ -0,0 +1,88 @@
+#!/bin/bash
+
+# Pattern matrix against in-process workers (benchmarkHead --inprocess)
+# Usage: ./run_inprocess_matrix.sh [samples] [size]
+# samples: requests per configuration (default: 2000)
+# size:    payload size in bytes (default: 64)
+
+if [ "$1" = "--help" ] || [ "$1" = "-h" ]; then
+    echo "=== In-Process Pattern Matrix ==="
+    echo "Usage: $0 [samples] [size]"
+    echo
+    echo "Runs every pattern, and twohop chains of 2-4 workers, with the workers"
+    echo "inside the head process, once over gRPC's in-process transport and once"
+    echo "over loopback TCP. No worker processes, ports or sleeps are involved, so"
+    echo "the whole matrix takes seconds. p50/p99 latency per configuration goes to"
+    echo "csvfiles/inprocess_matrix.csv; the difference between chain lengths is"
+    echo "the stack's cost per hop."
+    echo
+    echo "Examples:"
+    echo "  $0               # 2000 requests of 64 bytes each"
+    echo "  $0 10000 4096    # more samples, 4 KB payloads"
+    echo
+    exit 0
+fi
+
+SAMPLES=${1:-2000}
+SIZE=${2:-64}
+
+echo "=== In-Process Pattern Matrix ==="
+echo "Samples per configuration: $SAMPLES"
+echo "Payload size: $SIZE bytes"
+echo
+
+echo "Building benchmark components..."
+make -s benchmark_head
+
+if [ $? -ne 0 ]; then
+    echo "Build failed!"
+    exit 1
+fi
+
+mkdir -p csvfiles
+OUTPUT=csvfiles/inprocess_matrix.csv
+echo "Pattern,Workers,Transport,InprocessTransport,PayloadSize,P50Ms,P99Ms" > $OUTPUT
+
+# pattern:workers:transport
+CONFIGS="direct:1:unary direct:1:stream sequential:2:unary twohop:2:unary twohop:3:unary twohop:4:unary
+         twohop:3:stream hedged:2:unary tied:2:unary"
+
+for inprocess_transport in channel tcp; do
+    for config in $CONFIGS; do
+        IFS=':' read -r pattern workers transport <<< "$config"
+        echo "Testing $pattern, $workers worker(s), $transport over $inprocess_transport..."
+        ./build/benchmarkHead --pattern $pattern --inprocess $workers --inprocess-transport $inprocess_transport \
+                              --transport $transport --samples $SAMPLES --min-size $SIZE --max-size $SIZE \
+                              > /dev/null
+        if [ $? -ne 0 ]; then
+            echo "  failed"
+            continue
+        fi
+
+        results=csvfiles/benchmark_results_$pattern
+        if [ "$transport" != "unary" ]; then
+            results=${results}_$transport
+        fi
+        results=${results}_inprocess
+        if [ "$inprocess_transport" = "tcp" ]; then
+            results=${results}_tcp
+        fi
+
+        # Row layout: PayloadSize,LatencyMs,Success,Pattern; percentiles of the successful samples
+        awk -F, 'NR > 1 && $3 == 1 { print $2 }' $results.csv | sort -g | \
+            awk -v pattern=$pattern -v workers=$workers -v transport=$transport \
+                -v inprocess=$inprocess_transport -v size=$SIZE \
+                '{ latency[NR] = $1 }
+                 END {
+                     if (NR == 0) exit
+                     p50 = latency[int((NR - 1) * 0.50) + 1]
+                     p99 = latency[int((NR - 1) * 0.99) + 1]
+                     printf "%s,%s,%s,%s,%s,%s,%s\n", pattern, workers, transport, inprocess, size, p50, p99
+                 }' >> $OUTPUT
+        tail -n 1 $OUTPUT
+    done
+done
+
+echo
+echo "=== In-Process Pattern Matrix Complete ==="
+echo "Results saved to $OUTPUT"
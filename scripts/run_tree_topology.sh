@@ -0,0 +1,102 @@
+#!/bin/bash
+
+# Multicast tree topology benchmark
+# Usage: ./run_tree_topology.sh [fanouts] [depths] [payload] [samples] [server-mode]
+# fanouts:     comma-separated children per worker to test (default: 2,4)
+# depths:      comma-separated tree depths (levels of workers) to test (default: 2,3)
+# payload:     payload size in bytes (default: 1024)
+# samples:     samples per topology (default: 1000)
+# server-mode: worker engine, sync, callback or async (default: callback)
+
+if [ "$1" = "--help" ] || [ "$1" = "-h" ]; then
+    echo "=== Multicast Tree Topology Benchmark ==="
+    echo "Usage: $0 [fanouts] [depths] [payload] [samples] [server-mode]"
+    echo
+    echo "For every fan-out k and depth d, starts a complete k-ary tree of"
+    echo "(k^d - 1) / (k - 1) local benchmarkWorkers, each started with --forward-to"
+    echo "its children, and runs benchmarkHead --pattern tree against the root."
+    echo "Each run appends to csvfiles/tree_summary.csv, which ends up holding"
+    echo "latency against fan-out and depth (plot it with"
+    echo "analysis/plot_tree_topology.py)."
+    echo
+    echo "Examples:"
+    echo "  $0                       # k = 2, 4 at depths 2 and 3"
+    echo "  $0 2,3,4,8 2,3 4096 500  # wider trees, 4 KiB payloads"
+    echo
+    exit 0
+fi
+
+FANOUTS=${1:-2,4}
+DEPTHS=${2:-2,3}
+PAYLOAD=${3:-1024}
+SAMPLES=${4:-1000}
+SERVER_MODE=${5:-callback}
+BASE_PORT=50200
+MAX_WORKERS=200
+
+echo "=== Multicast Tree Topology Benchmark ==="
+echo "Fan-outs: $FANOUTS"
+echo "Depths: $DEPTHS"
+echo "Payload: $PAYLOAD bytes, $SAMPLES samples per topology"
+echo "Worker engine: $SERVER_MODE"
+echo
+
+echo "Building benchmark components..."
+make -s benchmark_head benchmark_worker
+
+if [ $? -ne 0 ]; then
+    echo "Build failed!"
+    exit 1
+fi
+
+mkdir -p csvfiles
+rm -f csvfiles/tree_summary.csv
+
+IFS=',' read -ra FANOUT_LIST <<< "$FANOUTS"
+IFS=',' read -ra DEPTH_LIST <<< "$DEPTHS"
+
+for fanout in "${FANOUT_LIST[@]}"; do
+    for depth in "${DEPTH_LIST[@]}"; do
+        # Workers of a complete tree, numbered level by level: worker n's
+        # children are k*n+1 .. k*n+k
+        workers=0
+        level=1
+        for ((d = 0; d < depth; d++)); do
+            workers=$((workers + level))
+            level=$((level * fanout))
+        done
+        if [ "$workers" -gt "$MAX_WORKERS" ]; then
+            echo "Skipping fan-out $fanout, depth $depth: $workers workers (more than $MAX_WORKERS)"
+            continue
+        fi
+
+        echo "Testing fan-out $fanout, depth $depth ($workers workers)..."
+        PIDS=()
+        for ((n = workers - 1; n >= 0; n--)); do
+            children=""
+            for ((c = fanout * n + 1; c <= fanout * n + fanout && c < workers; c++)); do
+                children="$children${children:+,}localhost:$((BASE_PORT + c))"
+            done
+            if [ -n "$children" ]; then
+                ./build/benchmarkWorker --port $((BASE_PORT + n)) --server-mode $SERVER_MODE \
+                                        --forward-to $children > tree_worker_$n.log 2>&1 &
+            else
+                ./build/benchmarkWorker --port $((BASE_PORT + n)) --server-mode $SERVER_MODE \
+                                        > tree_worker_$n.log 2>&1 &
+            fi
+            PIDS+=($!)
+        done
+        sleep 2
+
+        ./build/benchmarkHead --pattern tree --workers localhost:$BASE_PORT --samples $SAMPLES \
+                              --min-size $PAYLOAD --max-size $PAYLOAD | grep -E "tree:|Testing payload"
+
+        kill "${PIDS[@]}" 2>/dev/null
+        wait "${PIDS[@]}" 2>/dev/null
+        rm -f tree_worker_*.log
+    done
+done
+
+echo
+echo "=== Tree Topology Benchmark Complete ==="
+echo "Results saved to csvfiles/tree_summary.csv"
@@ -0,0 +1,97 @@
+#!/bin/bash
+
+# Worker-side throughput scaling benchmark
+# Usage: ./run_worker_scaling.sh [modes] [threads] [rate] [requests]
+# modes:    comma-separated server modes to test (default: sync,callback,async)
+# threads:  comma-separated thread / completion-queue counts (default: 1,2,4,8)
+# rate:     offered open-loop load in requests/sec, set above saturation (default: 50000)
+# requests: requests sent per configuration (default: 100000)
+
+if [ "$1" = "--help" ] || [ "$1" = "-h" ]; then
+    echo "=== Worker Throughput Scaling Benchmark ==="
+    echo "Usage: $0 [modes] [threads] [rate] [requests]"
+    echo
+    echo "Starts one benchmarkWorker per (mode, thread count), drives it with an"
+    echo "open-loop benchmarkHead above its saturation point and records the"
+    echo "achieved requests/sec in csvfiles/worker_scaling.csv."
+    echo
+    echo "Examples:"
+    echo "  $0                           # all modes, 1-8 threads"
+    echo "  $0 async 1,2,4,8,16 100000   # async engine only, higher offered load"
+    echo
+    exit 0
+fi
+
+MODES=${1:-sync,callback,async}
+THREADS=${2:-1,2,4,8}
+RATE=${3:-50000}
+REQUESTS=${4:-100000}
+PORT=50090
+PAYLOAD=64
+
+echo "=== Worker Throughput Scaling Benchmark ==="
+echo "Modes: $MODES"
+echo "Threads: $THREADS"
+echo "Offered load: $RATE req/s, $REQUESTS requests per configuration"
+echo
+
+echo "Building benchmark components..."
+make -s benchmark_head benchmark_worker
+
+if [ $? -ne 0 ]; then
+    echo "Build failed!"
+    exit 1
+fi
+
+mkdir -p csvfiles
+OUTPUT=csvfiles/worker_scaling.csv
+echo "Mode,Threads,OfferedQps,AchievedQps,P50Ms,P99Ms" > $OUTPUT
+
+run_config() {
+    local mode=$1
+    local threads=$2
+    local extra_args=""
+
+    if [ "$mode" = "async" ]; then
+        extra_args="--pin-cpus"
+    fi
+    if [ "$threads" != "auto" ]; then
+        extra_args="$extra_args --threads $threads"
+    fi
+
+    echo "Testing $mode mode with $threads thread(s)..."
+    ./build/benchmarkWorker --port $PORT --server-mode $mode $extra_args > worker_scaling.log 2>&1 &
+    local worker_pid=$!
+    sleep 2
+
+    ./build/benchmarkHead --pattern direct --workers localhost:$PORT --mode openloop \
+                          --rate $RATE --samples $REQUESTS \
+                          --min-size $PAYLOAD --max-size $PAYLOAD > /dev/null
+
+    # Row layout: PayloadSize,OfferedQps,AchievedQps,MeanMs,P50Ms,P90Ms,P99Ms,...
+    tail -n 1 csvfiles/openloop_summary_direct.csv | \
+        awk -F, -v mode=$mode -v threads=$threads '{ printf "%s,%s,%s,%s,%s,%s\n", mode, threads, $2, $3, $5, $7 }' >> $OUTPUT
+    tail -n 1 $OUTPUT
+
+    kill $worker_pid 2>/dev/null
+    wait $worker_pid 2>/dev/null
+    rm -f worker_scaling.log
+}
+
+IFS=',' read -ra MODE_LIST <<< "$MODES"
+IFS=',' read -ra THREAD_LIST <<< "$THREADS"
+
+for mode in "${MODE_LIST[@]}"; do
+    if [ "$mode" = "callback" ]; then
+        # The callback executor is sized by gRPC itself
+        run_config $mode auto
+        continue
+    fi
+    for threads in "${THREAD_LIST[@]}"; do
+        run_config $mode $threads
+    done
+done
+
+echo
+echo "=== Scaling Benchmark Complete ==="
+echo "Results saved to $OUTPUT"
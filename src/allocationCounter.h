@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Counts C++ heap allocations (global operator new) made by the process, so the
+// benchmarks can report allocations per request. gRPC core allocates through
+// gpr_malloc and is not counted; what remains is the C++ wrapper, protobuf and
+// harness work that --reuse-buffers is meant to eliminate.
+//
+// This header replaces the global operator new/delete, so include it from
+// exactly one translation unit per executable.
+class AllocationCounter {
+public:
+    static uint64_t Count() { return count_.load(std::memory_order_relaxed); }
+    static void Add() { count_.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+    static inline std::atomic<uint64_t> count_{0};
+};
+
+void* operator new(std::size_t size) {
+    AllocationCounter::Add();
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
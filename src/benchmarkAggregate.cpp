@@ -0,0 +1,311 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <charconv>
+#include <sstream>
+#include <memory>
+
+#include "src/resultLog.h"
+
+// Offline aggregation of benchmarkHead --results-format binary logs (see
+// src/resultLog.h). The logs are mapped rather than read, and the scan walks
+// the status, payload size and latency columns of each block in order, so
+// grouping a run by payload size costs little more than streaming the file
+// through memory. Percentiles are exact: successful latencies of a size are
+// gathered and selected with nth_element, not estimated from buckets.
+
+namespace {
+
+struct SizeStats {
+    std::vector<int64_t> latencies;  // successful samples, ns
+    uint64_t failed = 0;
+};
+
+struct Options {
+    std::vector<std::string> inputs;
+    std::vector<double> percentiles = {50.0, 90.0, 99.0, 99.9};
+    std::string summaryPath;
+    std::string csvPath;
+    int worker = -1;  // only records completed by this worker; -1 = all
+};
+
+std::string PercentileLabel(double percentile) {
+    std::ostringstream label;
+    label << percentile;
+    std::string text = label.str();
+    text.erase(std::remove(text.begin(), text.end(), '.'), text.end());
+    return "P" + text;
+}
+
+// Same rank as LatencyHistogram::ValueAtPercentile, so the two agree up to
+// the histogram's bucket precision. Reorders latencies; percentiles ascending.
+std::vector<int64_t> SelectPercentiles(std::vector<int64_t>& latencies, const std::vector<double>& percentiles) {
+    std::vector<int64_t> values;
+    size_t total = latencies.size();
+    auto begin = latencies.begin();
+    for (double percentile : percentiles) {
+        size_t rank = static_cast<size_t>(percentile / 100.0 * total + 0.5);
+        rank = std::max<size_t>(1, std::min(rank, total));
+        auto nth = latencies.begin() + (rank - 1);
+        // Everything before the previous selection is already no larger
+        if (nth >= begin) {
+            std::nth_element(begin, nth, latencies.end());
+            begin = nth;
+        }
+        values.push_back(*nth);
+    }
+    return values;
+}
+
+// Appends "<ns / 1e6>" with six decimals, matching the head's CSV, without
+// going through floating point.
+char* AppendMs(char* out, char* end, int64_t ns) {
+    if (ns < 0) {
+        *out++ = '-';
+        ns = -ns;
+    }
+    out = std::to_chars(out, end, ns / 1000000).ptr;
+    *out++ = '.';
+    char fraction[6];
+    int64_t rest = ns % 1000000;
+    for (int i = 5; i >= 0; --i) {
+        fraction[i] = static_cast<char>('0' + rest % 10);
+        rest /= 10;
+    }
+    std::copy(fraction, fraction + 6, out);
+    return out + 6;
+}
+
+// Per-sample rows in the benchmark_results_*.csv layout, for the existing
+// analysis and plotting scripts.
+uint64_t ExportCsv(const ResultLogReader& log, std::ofstream& out, int worker) {
+    static constexpr size_t kFlushAt = (1 << 20) - 256;
+    std::vector<char> buffer(1 << 20);
+    char* end = buffer.data() + buffer.size();
+    char* cursor = buffer.data();
+    uint64_t rows = 0;
+
+    for (size_t b = 0; b < log.BlockCount(); ++b) {
+        size_t count = log.BlockRecords(b);
+        const int64_t* latency = log.LatencyNs(b);
+        const uint32_t* size = log.PayloadSize(b);
+        const uint16_t* workers = log.Worker(b);
+        const uint8_t* status = log.Status(b);
+        const uint8_t* pattern = log.Pattern(b);
+        for (size_t i = 0; i < count; ++i) {
+            if (worker >= 0 && workers[i] != worker) {
+                continue;
+            }
+            cursor = std::to_chars(cursor, end, size[i]).ptr;
+            *cursor++ = ',';
+            cursor = AppendMs(cursor, end, latency[i]);
+            *cursor++ = ',';
+            *cursor++ = status[i] == resultlog::kStatusOk ? '1' : '0';
+            *cursor++ = ',';
+            const std::string& name = pattern[i] < log.Patterns().size() ? log.Patterns()[pattern[i]] : "unknown";
+            cursor = std::copy(name.begin(), name.end(), cursor);
+            *cursor++ = '\n';
+            ++rows;
+            if (static_cast<size_t>(cursor - buffer.data()) >= kFlushAt) {
+                out.write(buffer.data(), cursor - buffer.data());
+                cursor = buffer.data();
+            }
+        }
+    }
+    out.write(buffer.data(), cursor - buffer.data());
+    return rows;
+}
+
+void PrintUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options] LOG.brlog [LOG.brlog ...]\n"
+              << "Per-payload-size latency percentiles from benchmarkHead --results-format binary logs.\n"
+              << "Options:\n"
+              << "  --percentiles P1,P2,...   Percentiles to report (default: 50,90,99,99.9)\n"
+              << "  --summary FILE            Also write the per-size table as CSV\n"
+              << "  --csv FILE                Export every sample as PayloadSize,LatencyMs,Success,Pattern\n"
+              << "                            (the benchmark_results_*.csv layout) for the analysis scripts\n"
+              << "  --worker INDEX            Only samples completed by this worker\n"
+              << "  --help                    Show this help\n"
+              << "\nExample:\n"
+              << "  " << program << " --csv csvfiles/benchmark_results_direct.csv csvfiles/benchmark_results_direct.brlog\n"
+              << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--percentiles" && i + 1 < argc) {
+            options.percentiles.clear();
+            std::stringstream list(argv[++i]);
+            std::string value;
+            while (std::getline(list, value, ',')) {
+                if (!value.empty()) {
+                    options.percentiles.push_back(std::stod(value));
+                }
+            }
+        } else if (arg == "--summary" && i + 1 < argc) {
+            options.summaryPath = argv[++i];
+        } else if (arg == "--csv" && i + 1 < argc) {
+            options.csvPath = argv[++i];
+        } else if (arg == "--worker" && i + 1 < argc) {
+            options.worker = std::stoi(argv[++i]);
+        } else if (arg == "--help" || arg == "-h") {
+            PrintUsage(argv[0]);
+            return 0;
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::cout << "Error: unknown option " << arg << std::endl;
+            return 1;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+
+    if (options.inputs.empty()) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    if (options.percentiles.empty() ||
+        std::any_of(options.percentiles.begin(), options.percentiles.end(),
+                    [](double p) { return p <= 0.0 || p > 100.0; })) {
+        std::cout << "Error: --percentiles must be in (0, 100]" << std::endl;
+        return 1;
+    }
+    std::sort(options.percentiles.begin(), options.percentiles.end());
+
+    std::ofstream csv;
+    if (!options.csvPath.empty()) {
+        csv.open(options.csvPath, std::ios::binary);
+        if (!csv) {
+            std::cout << "Error: cannot write " << options.csvPath << std::endl;
+            return 1;
+        }
+        csv << "PayloadSize,LatencyMs,Success,Pattern\n";
+    }
+
+    std::map<std::pair<std::string, uint32_t>, SizeStats> groups;  // (pattern, payload size)
+    uint64_t records = 0;
+    uint64_t bytes = 0;
+    uint64_t csvRows = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (const auto& input : options.inputs) {
+        std::unique_ptr<ResultLogReader> log;
+        try {
+            log = std::make_unique<ResultLogReader>(input);
+        } catch (const std::exception& e) {
+            std::cout << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        records += log->RecordCount();
+        bytes += log->BlockCount() * resultlog::kBlockBytes;
+
+        // Sizes arrive in long runs, so the group of the previous record is
+        // almost always the group of the next one
+        SizeStats* current = nullptr;
+        uint32_t currentSize = 0;
+        uint8_t currentPattern = 0;
+        for (size_t b = 0; b < log->BlockCount(); ++b) {
+            size_t count = log->BlockRecords(b);
+            const int64_t* latency = log->LatencyNs(b);
+            const uint32_t* size = log->PayloadSize(b);
+            const uint16_t* worker = log->Worker(b);
+            const uint8_t* status = log->Status(b);
+            const uint8_t* pattern = log->Pattern(b);
+            for (size_t i = 0; i < count; ++i) {
+                if (options.worker >= 0 && worker[i] != options.worker) {
+                    continue;
+                }
+                if (current == nullptr || size[i] != currentSize || pattern[i] != currentPattern) {
+                    currentSize = size[i];
+                    currentPattern = pattern[i];
+                    std::string name = currentPattern < log->Patterns().size() ? log->Patterns()[currentPattern]
+                                                                               : "unknown";
+                    current = &groups[{name, currentSize}];
+                }
+                if (status[i] == resultlog::kStatusOk) {
+                    current->latencies.push_back(latency[i]);
+                } else {
+                    ++current->failed;
+                }
+            }
+        }
+
+        if (csv.is_open()) {
+            csvRows += ExportCsv(*log, csv, options.worker);
+        }
+    }
+    double scanMs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count() / 1000.0;
+
+    std::ofstream summary;
+    if (!options.summaryPath.empty()) {
+        summary.open(options.summaryPath);
+        summary << "Pattern,PayloadSize,Samples,Failed,MeanMs";
+        for (double percentile : options.percentiles) {
+            summary << "," << PercentileLabel(percentile) << "Ms";
+        }
+        summary << ",MaxMs\n";
+    }
+
+    std::cout << std::left << std::setw(12) << "Pattern" << std::right << std::setw(10) << "Size"
+              << std::setw(10) << "Samples" << std::setw(8) << "Failed" << std::setw(11) << "MeanMs";
+    for (double percentile : options.percentiles) {
+        std::cout << std::setw(11) << PercentileLabel(percentile) + "Ms";
+    }
+    std::cout << std::setw(11) << "MaxMs" << std::endl;
+
+    for (auto& entry : groups) {
+        SizeStats& stats = entry.second;
+        double meanMs = 0.0;
+        std::vector<int64_t> values(options.percentiles.size(), 0);
+        int64_t maxNs = 0;
+        if (!stats.latencies.empty()) {
+            long double sum = 0;
+            for (int64_t latency : stats.latencies) {
+                sum += latency;
+                maxNs = std::max(maxNs, latency);
+            }
+            meanMs = static_cast<double>(sum / stats.latencies.size()) / 1e6;
+            values = SelectPercentiles(stats.latencies, options.percentiles);
+        }
+
+        std::cout << std::left << std::setw(12) << entry.first.first << std::right << std::setw(10)
+                  << entry.first.second << std::setw(10) << stats.latencies.size() << std::setw(8) << stats.failed
+                  << std::fixed << std::setprecision(3) << std::setw(11) << meanMs;
+        for (int64_t value : values) {
+            std::cout << std::setw(11) << value / 1e6;
+        }
+        std::cout << std::setw(11) << maxNs / 1e6 << std::endl;
+
+        if (summary.is_open()) {
+            summary << entry.first.first << "," << entry.first.second << "," << stats.latencies.size() << ","
+                    << stats.failed << "," << std::fixed << std::setprecision(6) << meanMs;
+            for (int64_t value : values) {
+                summary << "," << value / 1e6;
+            }
+            summary << "," << maxNs / 1e6 << "\n";
+        }
+    }
+
+    std::cout << "\nScanned " << records << " records (" << std::fixed << std::setprecision(1)
+              << bytes / 1048576.0 << " MB mapped) in " << std::setprecision(1) << scanMs << " ms";
+    if (scanMs > 0.0) {
+        std::cout << ", " << std::setprecision(0) << records / scanMs * 1000.0 << " records/s";
+    }
+    std::cout << std::endl;
+    if (summary.is_open()) {
+        std::cout << "Summary saved to " << options.summaryPath << std::endl;
+    }
+    if (csv.is_open()) {
+        std::cout << "Exported " << csvRows << " samples to " << options.csvPath << std::endl;
+    }
+    return 0;
+}
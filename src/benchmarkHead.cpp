@@ -11,54 +11,923 @@
 #include <sstream>
 #include <filesystem>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <random>
+#include <map>
+#include <functional>
+#include <optional>
+#include <array>
+#include <future>
+#include <climits>
+#include <cmath>
 
 #include <grpcpp/grpcpp.h>
+#include <grpcpp/alarm.h>
+#include <grpcpp/generic/generic_stub.h>
 #include "build/benchmark.pb.h"
 #include "build/benchmark.grpc.pb.h"
+#include "src/latencyHistogram.h"
+#include "src/allocationCounter.h"
+#include "src/benchmarkService.h"
+#include "src/clockSync.h"
+#include "src/cpuPlacement.h"
+#include "src/cpuTime.h"
+#include "src/payloadGenerator.h"
+#include "src/resultLog.h"
+#include "src/shmTransport.h"
+#include "src/tcpTransport.h"
+#include "src/tuningProfile.h"
 
+using grpc::ByteBuffer;
 using grpc::Channel;
+using grpc::ClientAsyncResponseReader;
 using grpc::ClientContext;
+using grpc::ClientReaderWriter;
+using grpc::CompletionQueue;
 using grpc::Status;
 using benchmark::BenchmarkService;
+using benchmark::BenchmarkChunk;
 using benchmark::BenchmarkRequest;
 using benchmark::BenchmarkResponse;
+using benchmark::HopTimestamps;
 
 struct LatencyMeasurement {
     int payloadSize;
     double latencyMs;
     bool success;
-    std::string pattern;  // Track which pattern was used
+    size_t worker = 0;  // worker whose response completed the request
 };
 
+// Per-worker view of direct broadcasts at one payload size: each worker's own
+// response latency, how often it was the last to answer, and the spread between
+// the first and last response of each broadcast.
+struct FanoutStats {
+    explicit FanoutStats(size_t workerCount) : slowestCount(workerCount) {
+        for (size_t i = 0; i < workerCount; ++i) {
+            perWorker.push_back(std::make_unique<LatencyHistogram>());
+        }
+    }
+
+    void RecordLeg(size_t workerIndex, uint64_t latencyNs) { perWorker[workerIndex]->Record(latencyNs); }
+
+    void RecordBroadcast(size_t slowestWorker, uint64_t spreadNs) {
+        slowestCount[slowestWorker].fetch_add(1, std::memory_order_relaxed);
+        spread.Record(spreadNs);
+    }
+
+    std::vector<std::unique_ptr<LatencyHistogram>> perWorker;
+    std::vector<std::atomic<uint64_t>> slowestCount;
+    LatencyHistogram spread;
+};
+
+// Hedged and tied requests at one payload size: how often the backup went
+// out, how often it answered first, and how many losing calls were cancelled
+// while still running. Only the sending thread touches it.
+struct HedgeStats {
+    uint64_t requests = 0;
+    uint64_t backups = 0;     // backup calls sent, i.e. the extra load
+    uint64_t backupWins = 0;  // requests the backup answered first
+    uint64_t cancelled = 0;   // losing calls that ended cancelled rather than answered
+    uint64_t delayed = 0;     // hedged requests that had a hedge delay in force
+    double delaySumMs = 0.0;
+
+    double Rate(uint64_t count) const { return requests == 0 ? 0.0 : static_cast<double>(count) / requests; }
+    double MeanDelayMs() const { return delayed == 0 ? 0.0 : delaySumMs / delayed; }
+};
+
+// One worker's GetStats answer for one payload size
+struct WorkerStatsSample {
+    int payloadSize;
+    size_t worker;
+    benchmark::WorkerStatsSnapshot stats;
+};
+
+// --hedge-delay: how long a hedged request waits for its primary before
+// sending the backup. A fixed delay in ms, pNN for that percentile of the
+// latencies seen so far at the payload size, or none for no backups at all.
+struct HedgeDelay {
+    bool never = false;
+    double fixedMs = -1.0;  // < 0: use the percentile
+    double percentile = 95.0;
+};
+
+// false for a malformed --hedge-delay.
+bool ParseHedgeDelay(const std::string& text, HedgeDelay* delay) {
+    try {
+        size_t used = 0;
+        if (text == "none") {
+            delay->never = true;
+        } else if (!text.empty() && text[0] == 'p') {
+            delay->percentile = std::stod(text.substr(1), &used);
+            return used == text.size() - 1 && delay->percentile > 0.0 && delay->percentile < 100.0;
+        } else {
+            delay->fixedMs = std::stod(text, &used);
+            return used == text.size() && delay->fixedMs >= 0.0;
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+// Tree pattern: the shape of the multicast tree behind the root over one
+// payload size, from the aggregated acknowledgements (treeWorkers, treeFanout
+// and the critical path's hops in benchmark.proto). Some responses counting
+// fewer workers than others means those broadcasts reached only part of the
+// tree.
+class TreeShape {
+public:
+    void Reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        samples_ = 0;
+        minWorkers_ = maxWorkers_ = fanout_ = depth_ = 0;
+    }
+
+    void Observe(const BenchmarkResponse& response) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int workers = response.treeworkers();
+        minWorkers_ = samples_ == 0 ? workers : std::min(minWorkers_, workers);
+        maxWorkers_ = std::max(maxWorkers_, workers);
+        fanout_ = std::max(fanout_, response.treefanout());
+        depth_ = std::max(depth_, response.hops_size());
+        ++samples_;
+    }
+
+    uint64_t Samples() const { std::lock_guard<std::mutex> lock(mutex_); return samples_; }
+    int MinWorkers() const { std::lock_guard<std::mutex> lock(mutex_); return minWorkers_; }
+    int MaxWorkers() const { std::lock_guard<std::mutex> lock(mutex_); return maxWorkers_; }
+    int Fanout() const { std::lock_guard<std::mutex> lock(mutex_); return fanout_; }
+    int Depth() const { std::lock_guard<std::mutex> lock(mutex_); return depth_; }
+
+private:
+    mutable std::mutex mutex_;
+    uint64_t samples_ = 0;
+    int minWorkers_ = 0;
+    int maxWorkers_ = 0;
+    int fanout_ = 0;
+    int depth_ = 0;  // workers on the critical path, root included
+};
+
+// Splits each sample into where its time went, from the hop timestamps workers
+// stamp into every response (HopTimestamps in benchmark.proto):
+//
+//   request one-way   head send -> receive at the worker the head called
+//   forwarding        per forwarding worker: its own residence minus the next
+//                     worker's, i.e. its relay work plus both trips to the next
+//   processing        receive -> send at the last worker of the chain
+//   response one-way  send at the worker the head called -> head receive
+//
+// The parts add up to the wall-clock round trip from building the request to
+// reading its response. Forwarding and processing are differences on a single
+// clock and need no correction; the one-way trips are corrected by the
+// head-to-worker ClockEstimator, so their error is bounded by half that link's
+// lowest round-trip delay. Every parsed response feeds the estimators (one per
+// link down each chain), as do the head's background clock probes.
+class LatencyBreakdown {
+public:
+    static constexpr size_t kMaxReportedHops = 8;
+
+    // Starts a results file; rows are only written once the first BeginSize
+    // is called, so warmup requests just feed the clock estimators.
+    void Open(const std::string& filename) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_.open(filename);
+        file_ << "PayloadSize,Worker,RequestId,TotalMs,RequestOneWayMs,ForwardingMs,ProcessingMs,ResponseOneWayMs,"
+              << "HopForwardingMs\n";
+        sizes_.clear();
+        recording_ = false;
+        rows_ = 0;
+    }
+
+    void BeginSize(int payloadSize) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& slot = sizes_[payloadSize];
+        if (!slot) {
+            slot = std::make_unique<SizeStats>();
+        }
+        recording_ = file_.is_open();
+    }
+
+    // Returns the number of rows written.
+    size_t Close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (file_.is_open()) {
+            file_.close();
+        }
+        recording_ = false;
+        return rows_;
+    }
+
+    // Feeds one exchange (t1 = request built, t4 = receivedNs on the head's
+    // clock) to the estimator of every link it crossed.
+    void Observe(size_t workerIndex, const BenchmarkResponse& response, int64_t receivedNs) {
+        int hops = response.hops_size();
+        if (hops == 0) {
+            return;
+        }
+        const HopTimestamps& first = Hop(response, 0);
+        Link(workerIndex, 0).AddExchange(response.requesttimestamp(), first.receivetimestamp(),
+                                         first.sendtimestamp(), receivedNs);
+        for (int depth = 1; depth < hops; ++depth) {
+            const HopTimestamps& upstream = Hop(response, depth - 1);
+            const HopTimestamps& hop = Hop(response, depth);
+            Link(workerIndex, depth).AddExchange(upstream.forwardsendtimestamp(), hop.receivetimestamp(),
+                                                 hop.sendtimestamp(), upstream.forwardreceivetimestamp());
+        }
+    }
+
+    void Record(int payloadSize, size_t workerIndex, const BenchmarkResponse& response, int64_t receivedNs) {
+        Observe(workerIndex, response, receivedNs);
+        int hops = response.hops_size();
+        if (hops == 0) {
+            return;
+        }
+
+        int64_t sentNs = response.requesttimestamp();
+        const HopTimestamps& first = Hop(response, 0);
+        double offset = Link(workerIndex, 0).OffsetAt(sentNs);
+        double requestNs = (first.receivetimestamp() - offset) - sentNs;
+        double responseNs = receivedNs - (first.sendtimestamp() - offset);
+
+        std::array<double, kMaxReportedHops> hopNs{};
+        double forwardingNs = 0.0;
+        for (int depth = 0; depth + 1 < hops; ++depth) {
+            double ns = Residence(Hop(response, depth)) - Residence(Hop(response, depth + 1));
+            forwardingNs += ns;
+            if (depth < static_cast<int>(kMaxReportedHops)) {
+                hopNs[depth] = ns;
+            }
+        }
+        double processingNs = Residence(Hop(response, hops - 1));
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = sizes_.find(payloadSize);
+        if (!recording_ || it == sizes_.end()) {
+            return;
+        }
+        SizeStats& stats = *it->second;
+        stats.request.Record(ClampNs(requestNs));
+        stats.forwarding.Record(ClampNs(forwardingNs));
+        stats.processing.Record(ClampNs(processingNs));
+        stats.response.Record(ClampNs(responseNs));
+        stats.forwarded = stats.forwarded || hops > 1;
+
+        file_ << payloadSize << ","
+              << workerIndex << ","
+              << response.requestid() << ","
+              << std::fixed << std::setprecision(6) << (receivedNs - sentNs) / 1e6 << ","
+              << requestNs / 1e6 << ","
+              << forwardingNs / 1e6 << ","
+              << processingNs / 1e6 << ","
+              << responseNs / 1e6 << ",";
+        for (int depth = 0; depth + 1 < hops && depth < static_cast<int>(kMaxReportedHops); ++depth) {
+            file_ << (depth > 0 ? ";" : "") << hopNs[depth] / 1e6;
+        }
+        file_ << "\n";
+        ++rows_;
+    }
+
+    void PrintSize(int payloadSize) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = sizes_.find(payloadSize);
+        if (it == sizes_.end() || it->second->processing.TotalCount() == 0) {
+            return;
+        }
+        const SizeStats& stats = *it->second;
+        auto part = [](const char* name, const LatencyHistogram& h) {
+            std::cout << name << " " << h.ValueAtPercentileMs(50.0) << "/" << h.ValueAtPercentileMs(99.0);
+        };
+        std::cout << std::fixed << std::setprecision(3) << "    breakdown p50/p99 (ms): ";
+        part("request", stats.request);
+        if (stats.forwarded) {
+            part(", forwarding", stats.forwarding);
+        }
+        part(", processing", stats.processing);
+        part(", response", stats.response);
+        std::cout << std::endl;
+    }
+
+    // Current offset of every estimated clock from the head's, accumulated
+    // down each chain, with its drift and error bound.
+    void PrintClocks(const std::vector<std::string>& addresses) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (links_.empty()) {
+            return;
+        }
+        std::cout << "Clock offsets (worker - head, lowest-delay exchange per second):" << std::endl;
+        int64_t now = WallClockNs();
+        double offset = 0.0;
+        for (const auto& entry : links_) {
+            size_t worker = entry.first.first;
+            size_t depth = entry.first.second;
+            const ClockEstimator& link = *entry.second;
+            offset = (depth == 0 ? 0.0 : offset) + link.OffsetAt(now);
+            std::cout << std::fixed << std::setprecision(3) << "  worker " << worker;
+            if (depth == 0) {
+                std::cout << " (" << addresses[worker] << ")";
+            } else {
+                std::cout << " hop " << depth;
+            }
+            std::cout << ": " << std::showpos << offset / 1e6 << std::noshowpos << "ms, drift "
+                      << std::setprecision(2) << link.DriftPpm() << " ppm, error <= "
+                      << std::setprecision(3) << link.MinDelayNs() / 2e6 << "ms, "
+                      << link.Exchanges() << " exchanges" << std::endl;
+        }
+    }
+
+private:
+    struct SizeStats {
+        LatencyHistogram request;
+        LatencyHistogram forwarding;
+        LatencyHistogram processing;
+        LatencyHistogram response;
+        bool forwarded = false;
+    };
+
+    // Hops are appended on the way back, so depth 0, the worker the head
+    // called, is the last entry.
+    static const HopTimestamps& Hop(const BenchmarkResponse& response, int depth) {
+        return response.hops(response.hops_size() - 1 - depth);
+    }
+
+    static double Residence(const HopTimestamps& hop) {
+        return static_cast<double>(hop.sendtimestamp() - hop.receivetimestamp());
+    }
+
+    static uint64_t ClampNs(double ns) { return ns <= 0.0 ? 0 : static_cast<uint64_t>(ns); }
+
+    // Estimator for the link into the depth-th worker of workerIndex's chain,
+    // relative to the clock of the one before it (the head for depth 0).
+    ClockEstimator& Link(size_t workerIndex, size_t depth) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& slot = links_[{workerIndex, depth}];
+        if (!slot) {
+            slot = std::make_unique<ClockEstimator>();
+        }
+        return *slot;
+    }
+
+    std::mutex mutex_;
+    std::map<std::pair<size_t, size_t>, std::unique_ptr<ClockEstimator>> links_;
+    std::ofstream file_;
+    std::map<int, std::unique_ptr<SizeStats>> sizes_;
+    bool recording_ = false;
+    size_t rows_ = 0;
+};
+
+// One request issued by the pipelined load engine. Latency is measured from
+// intendedStart: in open-loop mode the slot the arrival schedule assigned to
+// it, so time spent waiting behind a slow response is charged to the request
+// instead of silently skipped; in windowed closed-loop mode the moment a window
+// slot freed up. A null histogram marks a warmup request that is not recorded.
+struct PendingRequest {
+    int requestId;
+    int payloadSize;
+    LatencyHistogram* histogram;
+    std::chrono::steady_clock::time_point intendedStart;
+    std::atomic<size_t> pendingLegs{0};  // direct: outstanding worker calls
+    std::atomic<bool> success{true};
+
+    // direct: per-worker stats (null when not recorded) and the fastest and
+    // slowest successful leg seen so far
+    FanoutStats* fanout = nullptr;
+    std::mutex legMutex;
+    uint64_t fastestLegNs = UINT64_MAX;
+    uint64_t slowestLegNs = 0;
+    size_t slowestWorker = 0;
+};
+
+// Holds the response of one call. With --reuse-buffers the message is created
+// on an Arena whose first block lives inside the slot, so parsing the 512-byte
+// acknowledgement needs no heap allocation.
+class ResponseSlot {
+public:
+    void UseArena() {
+        arena_.emplace(block_, sizeof(block_));
+        message_ = google::protobuf::Arena::CreateMessage<BenchmarkResponse>(&*arena_);
+    }
+
+    BenchmarkResponse* get() { return message_; }
+    BenchmarkResponse* operator->() { return message_; }
+
+private:
+    alignas(8) char block_[2048];
+    std::optional<google::protobuf::Arena> arena_;
+    BenchmarkResponse heapMessage_;
+    BenchmarkResponse* message_ = &heapMessage_;
+};
+
+// Uploads one large request as a ProcessBenchmarkChunked client stream. Chunks
+// are cut straight from the payload and written one at a time, so the whole
+// request is never built as a single message. The reactor frees itself when
+// the call ends, after handing the status to onDone.
+class ChunkedUpload : public grpc::ClientWriteReactor<BenchmarkChunk> {
+public:
+    using DoneFn = std::function<void(const Status&)>;
+
+    // context and response must outlive the call.
+    ChunkedUpload(BenchmarkService::Stub* stub, ClientContext* context, BenchmarkResponse* response, int requestId,
+                  std::string_view payload, size_t chunkBytes, DoneFn onDone)
+        : payload_(payload), chunkBytes_(chunkBytes), onDone_(std::move(onDone)) {
+        chunk_.set_requestid(requestId);
+        chunk_.set_totalsize(static_cast<int64_t>(payload.size()));
+        stub->async()->ProcessBenchmarkChunked(context, response, this);
+        chunk_.set_timestamp(WallClockNs());
+        WriteNext();
+        StartCall();
+    }
+
+    void OnWriteDone(bool ok) override {
+        // A failed write ends the call; its status arrives through OnDone
+        if (ok && offset_ < payload_.size()) {
+            chunk_.clear_timestamp();
+            chunk_.clear_totalsize();
+            WriteNext();
+        }
+    }
+
+    void OnDone(const Status& status) override {
+        DoneFn onDone = std::move(onDone_);
+        delete this;
+        onDone(status);
+    }
+
+private:
+    void WriteNext() {
+        size_t length = std::min(chunkBytes_, payload_.size() - offset_);
+        chunk_.mutable_data()->assign(payload_.data() + offset_, length);
+        offset_ += length;
+        if (offset_ == payload_.size()) {
+            StartWriteLast(&chunk_, grpc::WriteOptions());
+        } else {
+            StartWrite(&chunk_);
+        }
+    }
+
+    std::string_view payload_;
+    size_t chunkBytes_;
+    size_t offset_ = 0;
+    BenchmarkChunk chunk_;
+    DoneFn onDone_;
+};
+
+// A single unary RPC issued on behalf of a PendingRequest; its address is the
+// CompletionQueue tag.
+struct UnaryLeg {
+    PendingRequest* owner;
+    size_t workerIndex;
+    ClientContext context;
+    ResponseSlot response;
+    Status status;
+    std::unique_ptr<ClientAsyncResponseReader<BenchmarkResponse>> reader;
+
+    // --codec raw: the response stays serialized and only the status is checked
+    bool raw = false;
+    ByteBuffer rawResponse;
+    std::unique_ptr<grpc::GenericClientAsyncResponseReader> rawReader;
+
+    // Chunked uploads complete on a reactor thread, which posts the leg to
+    // its CompletionQueue through this alarm
+    grpc::Alarm chunkedDone;
+
+    // Outstanding-call count of the pool channel the call went out on
+    std::atomic<int>* channelOutstanding = nullptr;
+
+    ~UnaryLeg() {
+        if (channelOutstanding != nullptr) {
+            channelOutstanding->fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    bool Succeeded(bool ok) { return ok && status.ok() && (raw || response->success()); }
+};
+
+// How each BenchmarkClient builds and sends requests.
+class InProcessCluster;
+
+struct ClientOptions {
+    bool reuseBuffers = false;
+    std::string codec = "proto";  // proto | raw
+    ShmWait shmWait = ShmWait::kFutex;
+    int channelsPerWorker = 1;
+    std::string channelPolicy = "round-robin";  // round-robin | least-outstanding
+    int clockSyncMs = 200;  // background clock probe interval, 0 = off
+    std::string compression = "none";     // none | deflate | gzip
+    std::string compressionScope = "channel";  // channel: channel default; call: set on every ClientContext
+    std::string resultsFormat = "csv";  // per-sample results: csv | binary (.brlog, see src/resultLog.h)
+    size_t chunkThresholdBytes = 1 << 20;  // unary payloads above this go out chunked; 0 = never
+    size_t chunkBytes = 1 << 20;
+    int maxMessageMb = 0;  // gRPC message size limit in both directions; 0 = gRPC defaults
+    std::string hedgeDelay = "p95";  // hedged pattern, see ParseHedgeDelay
+    TuningProfile tuning;            // --tuning, see src/tuningProfile.h
+    CpuPlacement placement;          // --cpu-affinity / --numa-node, already applied by main
+    const InProcessCluster* inprocess = nullptr;  // --inprocess workers, channels to "inprocess:<i>"
+    std::string inprocessTransport = "channel";   // channel | tcp
+};
+
+// --compression names to gRPC algorithms; false for an unknown name.
+bool ParseCompression(const std::string& name, grpc_compression_algorithm* algorithm) {
+    if (name == "none") {
+        *algorithm = GRPC_COMPRESS_NONE;
+    } else if (name == "deflate") {
+        *algorithm = GRPC_COMPRESS_DEFLATE;
+    } else if (name == "gzip") {
+        *algorithm = GRPC_COMPRESS_GZIP;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Index of the pool member the next call should use: the next in turn, or the
+// one with the fewest calls in flight, scanning from the next in turn so ties
+// still rotate.
+template <typename Outstanding>
+size_t PickFromPool(size_t size, bool leastOutstanding, std::atomic<size_t>& next, Outstanding outstanding) {
+    if (size == 1) {
+        return 0;
+    }
+    size_t start = next.fetch_add(1, std::memory_order_relaxed) % size;
+    if (!leastOutstanding) {
+        return start;
+    }
+    size_t best = start;
+    int bestCount = outstanding(start);
+    for (size_t i = 1; i < size && bestCount > 0; ++i) {
+        size_t candidate = (start + i) % size;
+        int count = outstanding(candidate);
+        if (count < bestCount) {
+            best = candidate;
+            bestCount = count;
+        }
+    }
+    return best;
+}
+
+struct LoadOptions {
+    std::string mode = "closedloop";  // closedloop | openloop
+    std::string transport = "unary";  // unary | stream | shm | tcp
+    double rateQps = 1000.0;
+    std::string arrival = "poisson";
+    int maxInFlight = 16384;
+    int window = 1;
+    std::vector<int> concurrency;  // closed-loop levels swept by RunConcurrencySweep
+};
+
+// Payload sizes a sweep visits: minSize, minSize + increment, ... up to maxSize
+// (linear), or a geometric series with sizesPerOctave sizes per doubling (log),
+// which covers bytes to hundreds of megabytes in a few dozen points.
+struct SizeSchedule {
+    std::vector<int> sizes;
+    std::string description;
+};
+
+SizeSchedule BuildSizeSchedule(int minSize, int maxSize, int increment, const std::string& kind, int sizesPerOctave) {
+    SizeSchedule schedule;
+    if (kind == "log") {
+        for (int step = 0;; ++step) {
+            long long size = std::llround(minSize * std::pow(2.0, static_cast<double>(step) / sizesPerOctave));
+            if (size > maxSize) {
+                break;
+            }
+            if (schedule.sizes.empty() || size != schedule.sizes.back()) {
+                schedule.sizes.push_back(static_cast<int>(size));
+            }
+        }
+        schedule.description = std::to_string(sizesPerOctave) + " per octave";
+    } else {
+        for (int size = minSize; size <= maxSize; size += increment) {
+            schedule.sizes.push_back(size);
+        }
+        schedule.description = "+" + std::to_string(increment) + " bytes";
+    }
+    return schedule;
+}
+
+// Byte counts with an optional K, M or G (binary) suffix: 512, 64K, 256M.
+// Throws std::invalid_argument or std::out_of_range like std::stoll.
+long long ParseByteSize(const std::string& text) {
+    size_t end = 0;
+    long long value = std::stoll(text, &end);
+    std::string suffix = text.substr(end);
+    int shift = 0;
+    if (suffix == "K" || suffix == "k") {
+        shift = 10;
+    } else if (suffix == "M" || suffix == "m") {
+        shift = 20;
+    } else if (suffix == "G" || suffix == "g") {
+        shift = 30;
+    } else if (!suffix.empty()) {
+        throw std::invalid_argument("bad size suffix in '" + text + "'");
+    }
+    if (value > (LLONG_MAX >> shift) || value < (LLONG_MIN >> shift)) {
+        throw std::out_of_range("size '" + text + "' out of range");
+    }
+    return value * (1LL << shift);
+}
+
+// A size option's value into *value; prints the usual error and returns false
+// if it does not parse or falls outside [lowest, highest]
+template <typename T>
+bool ParseSizeOption(const std::string& option, const std::string& text, long long lowest, long long highest,
+                     T* value) {
+    try {
+        long long size = ParseByteSize(text);
+        if (size >= lowest && size <= highest) {
+            *value = static_cast<T>(size);
+            return true;
+        }
+    } catch (const std::exception&) {
+    }
+    std::cout << "Error: " << option << " must be a byte count between " << lowest << " and " << highest
+              << ", got '" << text << "'" << std::endl;
+    return false;
+}
+
+// Payload content shared by every request builder; main installs the
+// configured generator before the first request is built.
+PayloadGenerator& Payloads() {
+    static PayloadGenerator generator;
+    return generator;
+}
+
+// The calling thread's request template, allocated on a thread-local Arena. Its
+// payload is only rebuilt when the size changes, so a sweep pays for building
+// the payload once per size per thread rather than once per call.
+BenchmarkRequest& PrebuiltRequest(int payloadSize) {
+    thread_local google::protobuf::Arena arena;
+    thread_local BenchmarkRequest* request = google::protobuf::Arena::CreateMessage<BenchmarkRequest>(&arena);
+    if (request->payload().size() != static_cast<size_t>(payloadSize)) {
+        std::string_view payload = Payloads().Payload(payloadSize, 0);
+        request->mutable_payload()->assign(payload.data(), payload.size());
+    }
+    return *request;
+}
+
+// Fills in the request for one call: the pre-built template with --reuse-buffers,
+// otherwise scratch with a freshly built and copied payload.
+BenchmarkRequest& PrepareRequest(BenchmarkRequest& scratch, int requestId, int payloadSize, bool reuseBuffers) {
+    BenchmarkRequest& request = reuseBuffers ? PrebuiltRequest(payloadSize) : scratch;
+    request.set_requestid(requestId);
+    if (!reuseBuffers) {
+        std::string_view payload = Payloads().Payload(payloadSize, requestId);
+        request.mutable_payload()->assign(payload.data(), payload.size());
+    }
+    request.set_timestamp(WallClockNs());
+    return request;
+}
+
+// The calling thread's pre-serialized request for payloadSize, for --codec raw.
+// It carries only the payload, so it still parses as a BenchmarkRequest, and
+// copying a ByteBuffer just takes a reference to its slice.
+const ByteBuffer& RawRequest(int payloadSize) {
+    thread_local ByteBuffer buffer;
+    thread_local int bufferSize = -1;
+    if (bufferSize != payloadSize) {
+        BenchmarkRequest request;
+        request.set_payload(std::string(Payloads().Payload(payloadSize, 0)));
+        grpc::Slice slice(request.SerializeAsString());
+        buffer = ByteBuffer(&slice, 1);
+        bufferSize = payloadSize;
+    }
+    return buffer;
+}
+
+struct LoadSummary {
+    int payloadSize;
+    double offeredQps;
+    double achievedQps;
+    double meanMs;
+    double p50Ms;
+    double p90Ms;
+    double p99Ms;
+    double p999Ms;
+    double maxMs;
+    double maxSendLagMs;
+    double allocsPerRequest;
+    double cpuUsPerRequest;  // head process CPU, all threads
+    double throughputGBps;   // payload bytes sent per second at the achieved rate
+    int successCount;
+    int totalCount;
+};
+
+// --inprocess N: N workers served from inside the head process, so a pattern
+// runs without benchmarkWorker processes, fixed ports or startup sleeps, and
+// without their scheduling and network noise. Each is the worker's own
+// BenchmarkCore behind its sync engine. For twohop they form a chain, worker
+// i forwarding to worker i + 1, and the head calls the first; for the other
+// patterns they are independent. Over "channel" every hop, the head's
+// included, is a Server::InProcessChannel: gRPC's in-process transport, no
+// sockets and no HTTP/2. Over "tcp" each worker listens on an ephemeral
+// loopback port and every hop is an ordinary TCP channel, which adds the
+// kernel and HTTP/2 framing but still no other process.
+class InProcessCluster {
+public:
+    InProcessCluster(int count, bool chain, const ClientOptions& options)
+        : tcp_(options.inprocessTransport == "tcp"), maxMessageMb_(options.maxMessageMb), tuning_(options.tuning) {
+        workers_.resize(count);
+        // From the end of the chain, so each worker's next one is already serving
+        for (int i = count - 1; i >= 0; --i) {
+            auto worker = std::make_unique<Worker>();
+            worker->core = std::make_unique<BenchmarkCore>("", false, GRPC_COMPRESS_NONE, maxMessageMb_, tuning_);
+            worker->core->SetProgressLog(false);
+            if (chain && i + 1 < count) {
+                const Worker& next = *workers_[i + 1];
+                worker->core->ForwardThrough(OpenChannel(next.address, ChannelArgs()), next.address);
+            }
+            worker->service = std::make_unique<BenchmarkServiceImpl>(*worker->core);
+
+            grpc::ServerBuilder builder;
+            int port = 0;
+            if (tcp_) {
+                builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+            }
+            tuning_.Apply(&builder);
+            if (maxMessageMb_ > 0) {
+                builder.SetMaxReceiveMessageSize(maxMessageMb_ * 1024 * 1024);
+                builder.SetMaxSendMessageSize(maxMessageMb_ * 1024 * 1024);
+            }
+            builder.RegisterService(worker->service.get());
+            worker->server = builder.BuildAndStart();
+            if (!worker->server || (tcp_ && port == 0)) {
+                throw std::runtime_error("cannot start in-process worker " + std::to_string(i));
+            }
+            worker->address = tcp_ ? "127.0.0.1:" + std::to_string(port) : "inprocess:" + std::to_string(i);
+            workers_[i] = std::move(worker);
+        }
+    }
+
+    // The head-facing worker first, so no worker is shut down under a forwarding call
+    ~InProcessCluster() {
+        for (auto& worker : workers_) {
+            worker->server->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+        }
+    }
+
+    InProcessCluster(const InProcessCluster&) = delete;
+    InProcessCluster& operator=(const InProcessCluster&) = delete;
+
+    std::vector<std::string> Addresses() const {
+        std::vector<std::string> addresses;
+        for (const auto& worker : workers_) {
+            addresses.push_back(worker->address);
+        }
+        return addresses;
+    }
+
+    // A channel to one of the workers; over tcp, and for any other address, an ordinary one
+    std::shared_ptr<Channel> OpenChannel(const std::string& address, const grpc::ChannelArguments& args) const {
+        if (!tcp_) {
+            for (const auto& worker : workers_) {
+                if (worker && worker->address == address) {
+                    return worker->server->InProcessChannel(args);
+                }
+            }
+        }
+        return grpc::CreateCustomChannel(address, grpc::InsecureChannelCredentials(), args);
+    }
+
+private:
+    struct Worker {
+        std::unique_ptr<BenchmarkCore> core;
+        std::unique_ptr<BenchmarkServiceImpl> service;
+        std::unique_ptr<grpc::Server> server;
+        std::string address;
+    };
+
+    // What a worker's own forwarding channel gets from its flags
+    grpc::ChannelArguments ChannelArgs() const {
+        grpc::ChannelArguments args;
+        tuning_.Apply(&args);
+        if (maxMessageMb_ > 0) {
+            args.SetMaxReceiveMessageSize(maxMessageMb_ * 1024 * 1024);
+            args.SetMaxSendMessageSize(maxMessageMb_ * 1024 * 1024);
+        }
+        return args;
+    }
+
+    bool tcp_;
+    int maxMessageMb_;
+    TuningProfile tuning_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+};
+
+// All calls to one worker. With --channels-per-worker N > 1 the client holds a
+// pool of N channels, each with its own local subchannel pool and therefore its
+// own TCP connection and HTTP/2 session, and spreads calls across them.
+// --compression is set either as every channel's default algorithm or on each
+// call's ClientContext (--compression-scope); the two differ in where gRPC
+// picks the algorithm, not in what goes on the wire.
 class BenchmarkClient {
 public:
-    BenchmarkClient(std::shared_ptr<Channel> channel)
-        : stub_(BenchmarkService::NewStub(channel)) {}
+    BenchmarkClient(const std::string& address, const ClientOptions& options = ClientOptions())
+        : reuseBuffers_(options.reuseBuffers), raw_(options.codec == "raw"),
+          leastOutstanding_(options.channelPolicy == "least-outstanding"),
+          chunkThresholdBytes_(options.chunkThresholdBytes), chunkBytes_(options.chunkBytes),
+          busyPoll_(options.tuning.busyPollCq) {
+        grpc_compression_algorithm compression = GRPC_COMPRESS_NONE;
+        ParseCompression(options.compression, &compression);
+        if (options.compressionScope == "call") {
+            callCompression_ = compression;
+        }
+        for (int i = 0; i < options.channelsPerWorker; ++i) {
+            grpc::ChannelArguments args;
+            options.tuning.Apply(&args);
+            if (options.compressionScope == "channel" && compression != GRPC_COMPRESS_NONE) {
+                args.SetCompressionAlgorithm(compression);
+            }
+            if (options.maxMessageMb > 0) {
+                args.SetMaxSendMessageSize(options.maxMessageMb * 1024 * 1024);
+                args.SetMaxReceiveMessageSize(options.maxMessageMb * 1024 * 1024);
+            }
+            if (options.channelsPerWorker > 1) {
+                // Channels with identical args would share one global subchannel,
+                // i.e. one connection; a local pool plus a distinct arg keeps them apart
+                args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+                args.SetInt("benchmark.channel_index", i);
+            }
+            channels_.push_back(std::make_unique<PooledChannel>(
+                options.inprocess != nullptr
+                    ? options.inprocess->OpenChannel(address, args)
+                    : grpc::CreateCustomChannel(address, grpc::InsecureChannelCredentials(), args)));
+        }
+    }
 
-    LatencyMeasurement RunBenchmark(int requestId, int payloadSize) {
+    ~BenchmarkClient() {
+        rawCq_.Shutdown();
+        void* tag;
+        bool ok;
+        while (rawCq_.Next(&tag, &ok)) {
+        }
+    }
+
+    static const std::string& ProcessBenchmarkMethod() {
+        static const std::string method = BenchmarkMethodPath("ProcessBenchmark");
+        return method;
+    }
+
+    // Clock probes are told apart from benchmark requests by their id.
+    static constexpr int kClockProbeRequestId = -1;
+
+    // Called with every successful RunBenchmark response and the head's wall
+    // clock when it arrived.
+    using ResponseObserver = std::function<void(int payloadSize, const BenchmarkResponse&, int64_t receivedNs)>;
+    void SetResponseObserver(ResponseObserver observer) { observer_ = std::move(observer); }
+
+    // One clock-sync exchange: an empty ProcessBenchmark call whose response
+    // carries the worker's hop timestamps. Returns false if it went unanswered.
+    bool Probe(BenchmarkResponse* response, int64_t* receivedNs) {
         BenchmarkRequest request;
-        request.set_requestid(requestId);
-        
-        // Generate payload of specified size
-        std::string payload(payloadSize, 'X');
-        request.set_payload(payload);
-        
-        // Set timestamp (still used by protocol, just not stored in CSV)
-        auto requestTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
-            std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-        request.set_timestamp(requestTime);
+        request.set_requestid(kClockProbeRequestId);
+        ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(1));
+        request.set_timestamp(WallClockNs());
+        Status status = channels_[0]->stub->ProcessBenchmark(&context, request, response);
+        *receivedNs = WallClockNs();
+        return status.ok() && response->success();
+    }
 
-        BenchmarkResponse response;
+    // The worker's own counters and stage latencies. Returns false if the
+    // worker did not answer, e.g. one built before GetStats existed.
+    bool GetStats(bool reset, benchmark::WorkerStatsSnapshot* stats) {
+        benchmark::StatsRequest request;
+        request.set_reset(reset);
+        ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(2));
+        return channels_[0]->stub->GetStats(&context, request, stats).ok();
+    }
+
+    LatencyMeasurement RunBenchmark(int requestId, int payloadSize) {
+        if (raw_) {
+            return RunRawBenchmark(requestId, payloadSize);
+        }
+        if (Chunked(payloadSize)) {
+            return RunChunkedBenchmark(requestId, payloadSize);
+        }
+
+        BenchmarkRequest scratch;
+        const BenchmarkRequest& request = PrepareRequest(scratch, requestId, payloadSize, reuseBuffers_);
+
+        ResponseSlot response;
+        if (reuseBuffers_) {
+            response.UseArena();
+        }
         ClientContext context;
 
         // Set timeout for the request
         std::chrono::system_clock::time_point deadline =
             std::chrono::system_clock::now() + std::chrono::seconds(30);
         context.set_deadline(deadline);
+        ApplyCallCompression(&context);
 
+        PooledChannel& channel = PickChannel();
+        channel.outstanding.fetch_add(1, std::memory_order_relaxed);
         auto start = std::chrono::high_resolution_clock::now();
-        Status status = stub_->ProcessBenchmark(&context, request, &response);
+        Status status = channel.stub->ProcessBenchmark(&context, request, response.get());
         auto end = std::chrono::high_resolution_clock::now();
+        int64_t receivedNs = WallClockNs();
+        channel.outstanding.fetch_sub(1, std::memory_order_relaxed);
 
         auto latencyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
         double latencyMs = latencyNs / 1000000.0;
@@ -66,39 +935,486 @@ public:
         LatencyMeasurement measurement;
         measurement.payloadSize = payloadSize;
         measurement.latencyMs = latencyMs;
-        measurement.success = status.ok() && response.success();
+        measurement.success = status.ok() && response->success();
 
         if (!measurement.success) {
             std::cout << "Request " << requestId << " failed: " << status.error_message() << std::endl;
+        } else if (observer_) {
+            observer_(payloadSize, *response.get(), receivedNs);
+        }
+
+        return measurement;
+    }
+
+    // Starts a non-blocking ProcessBenchmark call whose completion is delivered to cq with tag leg.
+    // The request is serialized before AsyncProcessBenchmark returns, so a
+    // shared request template can be reused for the next call right away.
+    void StartAsyncBenchmark(UnaryLeg* leg, int requestId, int payloadSize, CompletionQueue* cq) {
+        PooledChannel& channel = PickChannel();
+        channel.outstanding.fetch_add(1, std::memory_order_relaxed);
+        leg->channelOutstanding = &channel.outstanding;
+
+        ApplyCallCompression(&leg->context);
+        if (raw_) {
+            leg->raw = true;
+            leg->context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(30));
+            leg->rawReader = channel.genericStub.PrepareUnaryCall(&leg->context, ProcessBenchmarkMethod(),
+                                                                  RawRequest(payloadSize), cq);
+            leg->rawReader->StartCall();
+            leg->rawReader->Finish(&leg->rawResponse, &leg->status, leg);
+            return;
+        }
+
+        if (Chunked(payloadSize)) {
+            leg->context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(30));
+            new ChunkedUpload(channel.stub.get(), &leg->context, leg->response.get(), requestId,
+                              Payloads().Payload(payloadSize, requestId), chunkBytes_,
+                              [leg, cq](const Status& status) {
+                                  leg->status = status;
+                                  leg->chunkedDone.Set(cq, gpr_now(GPR_CLOCK_MONOTONIC), leg);
+                              });
+            return;
+        }
+
+        BenchmarkRequest scratch;
+        const BenchmarkRequest& request = PrepareRequest(scratch, requestId, payloadSize, reuseBuffers_);
+        if (reuseBuffers_) {
+            leg->response.UseArena();
+        }
+
+        leg->context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(30));
+        leg->reader = channel.stub->AsyncProcessBenchmark(&leg->context, request, cq);
+        leg->reader->Finish(leg->response.get(), &leg->status, leg);
+    }
+
+    // Raw calls are never chunked: the generic stub sends the pre-serialized request as is
+    bool Chunked(int payloadSize) const {
+        return !raw_ && chunkThresholdBytes_ > 0 && static_cast<size_t>(payloadSize) > chunkThresholdBytes_;
+    }
+
+    BenchmarkService::Stub* stub(size_t channel) { return channels_[channel]->stub.get(); }
+    size_t channelCount() const { return channels_.size(); }
+    bool reuseBuffers() const { return reuseBuffers_; }
+
+    // --compression-scope call: every call, stream included, asks for the algorithm itself
+    void ApplyCallCompression(ClientContext* context) const {
+        if (callCompression_ != GRPC_COMPRESS_NONE) {
+            context->set_compression_algorithm(callCompression_);
+        }
+    }
+
+private:
+    struct PooledChannel {
+        explicit PooledChannel(std::shared_ptr<Channel> channel)
+            : stub(BenchmarkService::NewStub(channel)), genericStub(channel) {}
+
+        std::unique_ptr<BenchmarkService::Stub> stub;
+        grpc::GenericStub genericStub;
+        std::atomic<int> outstanding{0};
+    };
+
+    PooledChannel& PickChannel() {
+        size_t index = PickFromPool(channels_.size(), leastOutstanding_, nextChannel_, [this](size_t i) {
+            return channels_[i]->outstanding.load(std::memory_order_relaxed);
+        });
+        return *channels_[index];
+    }
+
+    // Raw codec: the pre-serialized request goes out through the GenericStub
+    // and the serialized response is never parsed. The generic stub has no
+    // blocking unary call, so the call completes on this client's own queue.
+    LatencyMeasurement RunRawBenchmark(int requestId, int payloadSize) {
+        ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(30));
+        ApplyCallCompression(&context);
+        ByteBuffer response;
+        Status status;
+
+        PooledChannel& channel = PickChannel();
+        channel.outstanding.fetch_add(1, std::memory_order_relaxed);
+        auto start = std::chrono::high_resolution_clock::now();
+        auto reader = channel.genericStub.PrepareUnaryCall(&context, ProcessBenchmarkMethod(), RawRequest(payloadSize),
+                                                           &rawCq_);
+        reader->StartCall();
+        reader->Finish(&response, &status, &response);
+        void* tag;
+        bool ok = false;
+        NextCompletion(&rawCq_, busyPoll_, &tag, &ok);
+        auto end = std::chrono::high_resolution_clock::now();
+        channel.outstanding.fetch_sub(1, std::memory_order_relaxed);
+
+        LatencyMeasurement measurement;
+        measurement.payloadSize = payloadSize;
+        measurement.latencyMs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1000000.0;
+        measurement.success = ok && status.ok();
+
+        if (!measurement.success) {
+            std::cout << "Request " << requestId << " failed: " << status.error_message() << std::endl;
+        }
+
+        return measurement;
+    }
+
+    // Blocking form of a chunked upload for the one-request-at-a-time paths.
+    LatencyMeasurement RunChunkedBenchmark(int requestId, int payloadSize) {
+        ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(30));
+        ApplyCallCompression(&context);
+        BenchmarkResponse response;
+        std::promise<Status> done;
+
+        PooledChannel& channel = PickChannel();
+        channel.outstanding.fetch_add(1, std::memory_order_relaxed);
+        auto start = std::chrono::high_resolution_clock::now();
+        new ChunkedUpload(channel.stub.get(), &context, &response, requestId,
+                          Payloads().Payload(payloadSize, requestId), chunkBytes_,
+                          [&done](const Status& status) { done.set_value(status); });
+        Status status = done.get_future().get();
+        auto end = std::chrono::high_resolution_clock::now();
+        int64_t receivedNs = WallClockNs();
+        channel.outstanding.fetch_sub(1, std::memory_order_relaxed);
+
+        LatencyMeasurement measurement;
+        measurement.payloadSize = payloadSize;
+        measurement.latencyMs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1000000.0;
+        measurement.success = status.ok() && response.success();
+
+        if (!measurement.success) {
+            std::cout << "Chunked request " << requestId << " failed: "
+                      << (status.ok() ? "worker saw a short upload" : status.error_message()) << std::endl;
+        } else if (observer_) {
+            observer_(payloadSize, response, receivedNs);
         }
 
         return measurement;
     }
 
+    std::vector<std::unique_ptr<PooledChannel>> channels_;
+    std::atomic<size_t> nextChannel_{0};
+    CompletionQueue rawCq_;
+    ResponseObserver observer_;
+    grpc_compression_algorithm callCompression_ = GRPC_COMPRESS_NONE;
+    bool reuseBuffers_;
+    bool raw_;
+    bool leastOutstanding_;
+    size_t chunkThresholdBytes_;
+    size_t chunkBytes_;
+    bool busyPoll_;
+};
+
+// A long-lived connection to one worker on which requests are pipelined. Any
+// thread may Send; a dedicated reader thread matches responses to outstanding
+// requests by requestId and hands them to onDone. Subclasses provide the wire.
+class RequestPipe {
+public:
+    // response is null when the request failed without one
+    using CompletionFn = std::function<void(PendingRequest*, size_t workerIndex, bool ok,
+                                            const BenchmarkResponse* response)>;
+
+    virtual ~RequestPipe() = default;
+
+    virtual void Send(PendingRequest* request) = 0;
+
+    int Outstanding() {
+        std::lock_guard<std::mutex> lock(pendingMutex_);
+        return static_cast<int>(pending_.size());
+    }
+
+protected:
+    RequestPipe(size_t workerIndex, CompletionFn onDone) : workerIndex_(workerIndex), onDone_(std::move(onDone)) {}
+
+    // Registers request as outstanding. If the pipe already broke the request
+    // is failed instead and false is returned.
+    bool Track(PendingRequest* request) {
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex_);
+            if (!broken_) {
+                pending_[request->requestId] = request;
+                return true;
+            }
+        }
+        onDone_(request, workerIndex_, false, nullptr);
+        return false;
+    }
+
+    // Fails a tracked request whose send did not go through.
+    void Fail(PendingRequest* request) {
+        if (TakePending(request->requestId) != nullptr) {
+            onDone_(request, workerIndex_, false, nullptr);
+        }
+    }
+
+    void Deliver(const BenchmarkResponse& response) {
+        PendingRequest* request = TakePending(response.requestid());
+        if (request != nullptr) {
+            onDone_(request, workerIndex_, response.success(), &response);
+        }
+    }
+
+    // The connection is gone; fail whatever is still outstanding on it.
+    void Break() {
+        std::map<int, PendingRequest*> orphaned;
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex_);
+            broken_ = true;
+            orphaned.swap(pending_);
+        }
+        for (const auto& entry : orphaned) {
+            onDone_(entry.second, workerIndex_, false, nullptr);
+        }
+    }
+
+    size_t workerIndex_;
+
+private:
+    PendingRequest* TakePending(int requestId) {
+        std::lock_guard<std::mutex> lock(pendingMutex_);
+        auto it = pending_.find(requestId);
+        if (it == pending_.end()) {
+            return nullptr;
+        }
+        PendingRequest* request = it->second;
+        pending_.erase(it);
+        return request;
+    }
+
+    CompletionFn onDone_;
+    std::mutex pendingMutex_;
+    std::map<int, PendingRequest*> pending_;
+    bool broken_ = false;
+};
+
+// A long-lived ProcessBenchmarkStream call to one worker, so a whole window of
+// requests is pipelined on one HTTP/2 stream with no per-request call setup.
+class BenchmarkStream : public RequestPipe {
+public:
+    BenchmarkStream(BenchmarkClient& client, size_t channel, size_t workerIndex, CompletionFn onDone)
+        : RequestPipe(workerIndex, std::move(onDone)), reuseBuffers_(client.reuseBuffers()) {
+        client.ApplyCallCompression(&context_);
+        stream_ = client.stub(channel)->ProcessBenchmarkStream(&context_);
+        reader_ = std::thread([this]() { ReadResponses(); });
+    }
+
+    ~BenchmarkStream() override { Close(); }
+
+    void Send(PendingRequest* request) override {
+        BenchmarkRequest scratch;
+        const BenchmarkRequest& message = PrepareRequest(scratch, request->requestId, request->payloadSize,
+                                                         reuseBuffers_);
+        if (!Track(request)) {
+            return;
+        }
+
+        bool written;
+        {
+            std::lock_guard<std::mutex> lock(writeMutex_);
+            written = stream_->Write(message);
+        }
+        if (!written) {
+            Fail(request);
+        }
+    }
+
+    // Half-closes the stream and waits for the worker to finish it. Callers
+    // drain all outstanding requests first.
+    void Close() {
+        if (!reader_.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(writeMutex_);
+            stream_->WritesDone();
+        }
+        reader_.join();
+        Status status = stream_->Finish();
+        if (!status.ok()) {
+            std::cout << "Stream to worker " << workerIndex_ << " ended with error: "
+                      << status.error_message() << std::endl;
+        }
+    }
+
 private:
-    std::unique_ptr<BenchmarkService::Stub> stub_;
+    void ReadResponses() {
+        BenchmarkResponse response;
+        while (stream_->Read(&response)) {
+            Deliver(response);
+        }
+        Break();
+    }
+
+    bool reuseBuffers_;
+    ClientContext context_;
+    std::unique_ptr<ClientReaderWriter<BenchmarkRequest, BenchmarkResponse>> stream_;
+    std::thread reader_;
+    std::mutex writeMutex_;
+};
+
+// One slot in a co-located worker's shared-memory segment. Requests are
+// serialized straight into the slot's request ring and responses parsed out of
+// its response ring, with no sockets, HTTP/2 or gRPC in between, which makes
+// it the lower bound the gRPC transports are measured against.
+class ShmPipe : public RequestPipe {
+public:
+    ShmPipe(const std::string& address, ShmWait wait, size_t workerIndex, bool reuseBuffers, CompletionFn onDone)
+        : RequestPipe(workerIndex, std::move(onDone)), connection_(address, wait), reuseBuffers_(reuseBuffers) {
+        reader_ = std::thread([this]() { ReadResponses(); });
+    }
+
+    // Callers drain all outstanding requests first.
+    ~ShmPipe() override {
+        stopping_ = true;
+        reader_.join();
+    }
+
+    void Send(PendingRequest* request) override {
+        BenchmarkRequest scratch;
+        const BenchmarkRequest& message = PrepareRequest(scratch, request->requestId, request->payloadSize,
+                                                         reuseBuffers_);
+        if (!Track(request)) {
+            return;
+        }
+
+        bool sent;
+        {
+            std::lock_guard<std::mutex> lock(writeMutex_);
+            sent = connection_.Send(message);
+        }
+        if (!sent) {
+            Fail(request);
+        }
+    }
+
+private:
+    void ReadResponses() {
+        static constexpr int kPollTimeoutMs = 100;
+        BenchmarkResponse response;
+        while (!stopping_) {
+            if (connection_.Receive(&response, kPollTimeoutMs)) {
+                Deliver(response);
+            } else if (!connection_.Intact()) {
+                std::cout << "Shared-memory connection to worker " << workerIndex_ << " broke on a malformed message"
+                          << std::endl;
+                break;
+            } else if (!connection_.WorkerAlive()) {
+                std::cout << "Shared-memory worker " << workerIndex_ << " exited" << std::endl;
+                break;
+            }
+        }
+        Break();
+    }
+
+    ShmConnection connection_;
+    bool reuseBuffers_;
+    std::thread reader_;
+    std::mutex writeMutex_;
+    std::atomic<bool> stopping_{false};
+};
+
+// A raw TCP connection to a worker started with --transport tcp: length-prefixed
+// protobuf frames with no HTTP/2 or gRPC, the baseline the RPC framework's
+// overhead is measured against.
+class TcpPipe : public RequestPipe {
+public:
+    TcpPipe(const std::string& address, size_t workerIndex, bool reuseBuffers, CompletionFn onDone)
+        : RequestPipe(workerIndex, std::move(onDone)), connection_(address), reuseBuffers_(reuseBuffers) {
+        reader_ = std::thread([this]() { ReadResponses(); });
+    }
+
+    // Callers drain all outstanding requests first; the worker closes its end
+    // once it sees EOF, which ends the reader.
+    ~TcpPipe() override {
+        connection_.CloseWrite();
+        reader_.join();
+    }
+
+    void Send(PendingRequest* request) override {
+        BenchmarkRequest scratch;
+        const BenchmarkRequest& message = PrepareRequest(scratch, request->requestId, request->payloadSize,
+                                                         reuseBuffers_);
+        if (!Track(request)) {
+            return;
+        }
+
+        bool sent;
+        {
+            std::lock_guard<std::mutex> lock(writeMutex_);
+            sent = connection_.Send(message);
+        }
+        if (!sent) {
+            Fail(request);
+        }
+    }
+
+private:
+    void ReadResponses() {
+        BenchmarkResponse response;
+        while (connection_.Receive(&response)) {
+            Deliver(response);
+        }
+        Break();
+    }
+
+    TcpConnection connection_;
+    bool reuseBuffers_;
+    std::thread reader_;
+    std::mutex writeMutex_;
 };
 
 class BenchmarkHead {
 public:
-    BenchmarkHead(const std::vector<std::string>& workerAddresses, const std::string& pattern = "direct") 
-        : pattern_(pattern) {
+    BenchmarkHead(const std::vector<std::string>& workerAddresses, const std::string& pattern = "direct",
+                  const ClientOptions& clientOptions = ClientOptions())
+        : pattern_(pattern), codec_(clientOptions.codec),
+          fileSuffix_(FileSuffix(clientOptions)), payload_(Payloads().Label()), compression_(clientOptions.compression),
+          shmWait_(clientOptions.shmWait), channelsPerWorker_(clientOptions.channelsPerWorker),
+          leastOutstanding_(clientOptions.channelPolicy == "least-outstanding"),
+          clockSyncMs_(clientOptions.clockSyncMs), binaryResults_(clientOptions.resultsFormat == "binary"),
+          tuning_(clientOptions.tuning), placement_(clientOptions.placement) {
+        ParseHedgeDelay(clientOptions.hedgeDelay, &hedgeDelay_);
+        hedgeDelayLabel_ = clientOptions.hedgeDelay;
         for (const auto& address : workerAddresses) {
-            auto channel = grpc::CreateChannel(address, grpc::InsecureChannelCredentials());
-            clients_.push_back(std::make_unique<BenchmarkClient>(channel));
+            size_t workerIndex = clients_.size();
+            clients_.push_back(std::make_unique<BenchmarkClient>(address, clientOptions));
+            clients_.back()->SetResponseObserver(
+                [this, workerIndex](int payloadSize, const BenchmarkResponse& response, int64_t receivedNs) {
+                    breakdown_.Record(payloadSize, workerIndex, response, receivedNs);
+                    treeShape_.Observe(response);
+                });
             workerAddresses_.push_back(address);
         }
         std::cout << "Connected to " << clients_.size() << " workers using " << pattern_ << " pattern" << std::endl;
+        if (channelsPerWorker_ > 1) {
+            std::cout << "  " << channelsPerWorker_ << " channels per worker, "
+                      << (leastOutstanding_ ? "least-outstanding" : "round-robin") << " selection" << std::endl;
+        }
         for (const auto& addr : workerAddresses_) {
             std::cout << "  Worker: " << addr << std::endl;
         }
+        if (clockSyncMs_ > 0) {
+            clockProbe_ = std::thread([this]() { ProbeClocks(); });
+        }
     }
 
-    void RunLatencyBenchmark(int minSize = 16, int maxSize = 8192, int increment = 16, int samplesPerSize = 100) {
+    ~BenchmarkHead() {
+        if (clockProbe_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(clockProbeMutex_);
+                stopClockProbe_ = true;
+            }
+            clockProbeCv_.notify_all();
+            clockProbe_.join();
+        }
+        fanoutCq_.Shutdown();
+        void* tag;
+        bool ok;
+        while (fanoutCq_.Next(&tag, &ok)) {
+        }
+    }
+
+    void RunLatencyBenchmark(const SizeSchedule& schedule, int samplesPerSize = 100) {
         std::cout << "\n=== Starting Communication Latency Benchmark ===" << std::endl;
         std::cout << "Pattern: " << GetPatternDescription() << std::endl;
-        std::cout << "Payload size range: " << minSize << " to " << maxSize << " bytes" << std::endl;
-        std::cout << "Increment: " << increment << " bytes" << std::endl;
+        PrintSchedule(schedule);
         std::cout << "Samples per size: " << samplesPerSize << std::endl;
         std::cout << "Fixed acknowledgement size: 512 bytes\n" << std::endl;
 
@@ -107,7 +1423,7 @@ public:
             return;
         }
 
-        std::vector<LatencyMeasurement> allMeasurements;
+        OpenResults(fileSuffix_);
         int requestId = 1;
 
         // Warmup phase
@@ -116,43 +1432,590 @@ public:
             RunPatternRequest(requestId++, 1024);
         }
         std::cout << "Warmup complete.\n" << std::endl;
+        ResetWorkerStats(true);
 
         // Main benchmark
-        for (int payloadSize = minSize; payloadSize <= maxSize; payloadSize += increment) {
+        for (int payloadSize : schedule.sizes) {
             std::cout << "Testing payload size: " << payloadSize << " bytes... ";
             std::cout.flush();
 
-            std::vector<double> latencies;
+            LatencyHistogram& histogram = HistogramFor(payloadSize);
+            FanoutStats* fanout = FanoutStatsFor(payloadSize);
+            HedgeStats* hedge = HedgeStatsFor(payloadSize);
+            breakdown_.BeginSize(payloadSize);
+            treeShape_.Reset();
             int successCount = 0;
+            uint64_t allocationsBefore = AllocationCounter::Count();
+            uint64_t cpuBefore = ProcessCpuNs();
 
             for (int sample = 0; sample < samplesPerSize; ++sample) {
-                auto measurement = RunPatternRequest(requestId++, payloadSize);
-                allMeasurements.push_back(measurement);
+                auto measurement = RunPatternRequest(requestId++, payloadSize, fanout, hedge);
+                RecordResult(measurement, histogram);
                 
                 if (measurement.success) {
-                    latencies.push_back(measurement.latencyMs);
                     successCount++;
                 }
             }
 
-            if (!latencies.empty()) {
-                double mean = std::accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
-                std::cout << "Mean: " << std::fixed << std::setprecision(3) << mean << "ms, "
-                          << "Success: " << successCount << "/" << samplesPerSize << std::endl;
-            } else {
-                std::cout << "All requests failed!" << std::endl;
-            }
+            PrintPercentiles(histogram, successCount, samplesPerSize);
+            PrintBandwidth(payloadSize, histogram);
+            PrintAllocations(AllocationCounter::Count() - allocationsBefore, samplesPerSize);
+            PrintCpu(ProcessCpuNs() - cpuBefore, samplesPerSize);
+            PrintFanout(fanout);
+            PrintHedging(hedge);
+            RecordTreeShape(payloadSize, histogram, "latency", 1);
+            breakdown_.PrintSize(payloadSize);
+            CollectWorkerStats(payloadSize);
         }
 
-        // Save detailed results
-        SaveResults(allMeasurements);
+        CloseResults();
+        SaveHistograms(fileSuffix_);
+        SaveFanoutStats(fileSuffix_);
+        SaveHedgeStats(fileSuffix_);
+        SaveWorkerStats(fileSuffix_);
+        size_t breakdownRows = breakdown_.Close();
         
         std::cout << "\n=== Benchmark Complete ===" << std::endl;
-        std::cout << "Total measurements: " << allMeasurements.size() << std::endl;
-        std::cout << "Results saved to csvfiles/benchmark_results_" << pattern_ << ".csv" << std::endl;
+        std::cout << "Total measurements: " << totalMeasurements_ << std::endl;
+        std::cout << "Results saved to " << ResultsPath(fileSuffix_) << std::endl;
+        std::cout << "Histograms saved to csvfiles/latency_histograms_" << pattern_ << fileSuffix_ << ".hist" << std::endl;
+        if (!fanoutStats_.empty()) {
+            std::cout << "Per-worker stats saved to csvfiles/direct_worker_stats" << fileSuffix_ << ".csv" << std::endl;
+        }
+        if (!hedgeStats_.empty()) {
+            std::cout << "Hedging stats saved to csvfiles/hedging_summary_" << pattern_ << fileSuffix_ << ".csv"
+                      << std::endl;
+        }
+        PrintWorkerStatsSummary(fileSuffix_);
+        PrintBreakdownSummary(breakdownRows, fileSuffix_);
+    }
+
+    // Pipelined variant of the sweep. In open-loop mode requests are issued on a
+    // precomputed arrival schedule at rateQps regardless of whether earlier
+    // requests have completed, so the curve shows how latency degrades as offered
+    // load approaches saturation. In closed-loop mode up to `window` requests are
+    // kept outstanding and a new one is sent as soon as any completes. Either mode
+    // runs over unary calls, one long-lived stream per worker, or one
+    // shared-memory ring pair per co-located worker.
+    // sweepSuffix is appended to every output file name. Returns the per-size summaries.
+    std::vector<LoadSummary> RunLoadBenchmark(const SizeSchedule& schedule, int samplesPerSize,
+                                              const LoadOptions& options, const std::string& sweepSuffix = "") {
+        bool openLoop = options.mode == "openloop";
+        bool unary = options.transport == "unary";
+
+        std::cout << "\n=== Starting " << (openLoop ? "Open-Loop" : "Pipelined Closed-Loop")
+                  << " Latency Benchmark ===" << std::endl;
+        std::cout << "Pattern: " << GetPatternDescription() << std::endl;
+        std::cout << "Transport: " << TransportDescription(options.transport) << std::endl;
+        PrintSchedule(schedule);
+        std::cout << "Requests per size: " << samplesPerSize << std::endl;
+        if (openLoop) {
+            std::cout << "Offered rate: " << options.rateQps << " req/s (" << options.arrival << " arrivals)" << std::endl;
+            std::cout << "Max in-flight requests: " << options.maxInFlight << "\n" << std::endl;
+        } else {
+            std::cout << "Window: " << options.window << " outstanding request(s)\n" << std::endl;
+        }
+
+        if (!ValidatePattern()) {
+            return {};
+        }
+
+        maxInFlight_ = openLoop ? options.maxInFlight : options.window;
+        std::thread poller;
+        if (unary) {
+            // A shut-down queue cannot be reused, so every run gets its own
+            cq_ = std::make_unique<CompletionQueue>();
+            poller = std::thread([this]() { PollUnaryCompletions(); });
+        } else {
+            OpenPipes(options.transport);
+        }
+
+        int requestId = 1;
+
+        std::cout << "Warmup phase..." << std::endl;
+        DriveRequests(10, 1024, nullptr, nullptr, nullptr, requestId);
+        std::cout << "Warmup complete.\n" << std::endl;
+        // A --transport tcp worker serves no gRPC, so it has nobody to answer GetStats
+        ResetWorkerStats(options.transport != "tcp");
+
+        std::string transportSuffix = (unary ? "" : "_" + options.transport) + fileSuffix_ + sweepSuffix;
+        std::string suffix = (openLoop ? "_openloop" : "") + transportSuffix;
+        OpenResults(suffix);
+
+        std::mt19937_64 rng(42);
+        std::vector<LoadSummary> summaries;
+
+        for (int payloadSize : schedule.sizes) {
+            std::cout << "Testing payload size: " << payloadSize << " bytes... ";
+            std::cout.flush();
+
+            std::vector<std::chrono::nanoseconds> arrivals;
+            if (openLoop) {
+                arrivals = BuildArrivalSchedule(samplesPerSize, options.rateQps, options.arrival, rng);
+            }
+            LatencyHistogram& histogram = HistogramFor(payloadSize);
+            breakdown_.BeginSize(payloadSize);
+            treeShape_.Reset();
+            {
+                std::lock_guard<std::mutex> lock(loadMutex_);
+                loadSuccessCount_ = 0;
+                lastCompletion_ = std::chrono::steady_clock::now();
+            }
+
+            auto base = std::chrono::steady_clock::now();
+            FanoutStats* fanout = FanoutStatsFor(payloadSize);
+            uint64_t allocationsBefore = AllocationCounter::Count();
+            uint64_t cpuBefore = ProcessCpuNs();
+            double maxSendLagMs = DriveRequests(samplesPerSize, payloadSize, &histogram, fanout,
+                                                openLoop ? &arrivals : nullptr, requestId);
+
+            std::lock_guard<std::mutex> lock(loadMutex_);
+            LoadSummary summary = SummarizeLoad(histogram, payloadSize, openLoop ? options.rateQps : 0.0,
+                                                samplesPerSize, base);
+            summary.maxSendLagMs = maxSendLagMs;
+            summary.allocsPerRequest = static_cast<double>(AllocationCounter::Count() - allocationsBefore) / samplesPerSize;
+            summary.cpuUsPerRequest = (ProcessCpuNs() - cpuBefore) / 1000.0 / samplesPerSize;
+            summary.throughputGBps = summary.achievedQps * BytesPerRequest(payloadSize) / 1e9;
+            summaries.push_back(summary);
+
+            std::cout << "Achieved: " << std::fixed << std::setprecision(1) << summary.achievedQps << " req/s, ";
+            PrintPercentiles(histogram, summary.successCount, samplesPerSize);
+            PrintBandwidth(payloadSize, histogram, summary.throughputGBps);
+            PrintAllocations(AllocationCounter::Count() - allocationsBefore, samplesPerSize);
+            PrintCpu(static_cast<uint64_t>(summary.cpuUsPerRequest * 1000.0 * samplesPerSize), samplesPerSize);
+            PrintFanout(fanout);
+            RecordTreeShape(payloadSize, histogram, options.mode, maxInFlight_);
+            breakdown_.PrintSize(payloadSize);
+            CollectWorkerStats(payloadSize);
+        }
+
+        if (unary) {
+            cq_->Shutdown();
+            poller.join();
+        } else {
+            pipes_.clear();
+        }
+
+        CloseResults();
+        SaveHistograms(suffix);
+        SaveFanoutStats(suffix);
+        SaveWorkerStats(suffix);
+        size_t breakdownRows = breakdown_.Close();
+        std::string summaryFile = "csvfiles/" + options.mode + "_summary_" + pattern_ + transportSuffix + ".csv";
+        SaveLoadSummary(summaries, summaryFile, options);
+
+        std::cout << "\n=== " << (openLoop ? "Open-Loop" : "Pipelined Closed-Loop") << " Benchmark Complete ===" << std::endl;
+        std::cout << "Total measurements: " << totalMeasurements_ << std::endl;
+        std::cout << "Results saved to " << ResultsPath(suffix) << std::endl;
+        std::cout << "Histograms saved to csvfiles/latency_histograms_" << pattern_ << suffix << ".hist" << std::endl;
+        std::cout << "Throughput/latency summary saved to " << summaryFile << std::endl;
+        if (!fanoutStats_.empty()) {
+            std::cout << "Per-worker stats saved to csvfiles/direct_worker_stats" << suffix << ".csv" << std::endl;
+        }
+        PrintWorkerStatsSummary(suffix);
+        PrintBreakdownSummary(breakdownRows, suffix);
+        return summaries;
+    }
+
+    // Adds concurrency as a second sweep dimension: a full pipelined closed-loop
+    // payload sweep at each level, keeping that many requests in flight, then one
+    // throughput-latency table over every (payload size, concurrency) point with
+    // the knee of each curve: the lowest level reaching 90% of the best throughput.
+    void RunConcurrencySweep(const SizeSchedule& schedule, int samplesPerSize, const LoadOptions& options) {
+        std::map<int, std::vector<std::pair<int, LoadSummary>>> curves;  // payload size -> (level, summary)
+        for (int level : options.concurrency) {
+            std::cout << "\n##### Concurrency " << level << " #####" << std::endl;
+            LoadOptions levelOptions = options;
+            levelOptions.window = level;
+            for (const auto& summary : RunLoadBenchmark(schedule, samplesPerSize, levelOptions,
+                                                        "_c" + std::to_string(level))) {
+                curves[summary.payloadSize].emplace_back(level, summary);
+            }
+        }
+        if (curves.empty()) {
+            return;
+        }
+
+        std::string transportSuffix = (options.transport == "unary" ? "" : "_" + options.transport) + fileSuffix_;
+        std::string filename = "csvfiles/concurrency_summary_" + pattern_ + transportSuffix + ".csv";
+        std::ofstream file(filename);
+        file << "PayloadSize,Concurrency,AchievedQps,MeanMs,P50Ms,P90Ms,P99Ms,P999Ms,MaxMs,Success,Total,Pattern,Transport,"
+             << "HeadCpuUsPerRequest,ThroughputGBps\n";
+
+        std::cout << "\n=== Throughput-Latency Curves ===" << std::endl;
+        for (const auto& curve : curves) {
+            std::cout << "Payload " << curve.first << " bytes:" << std::endl;
+            double bestQps = 0.0;
+            for (const auto& point : curve.second) {
+                const LoadSummary& s = point.second;
+                bestQps = std::max(bestQps, s.achievedQps);
+                file << s.payloadSize << ","
+                     << point.first << ","
+                     << std::fixed << std::setprecision(3) << s.achievedQps << ","
+                     << std::setprecision(6) << s.meanMs << ","
+                     << s.p50Ms << ","
+                     << s.p90Ms << ","
+                     << s.p99Ms << ","
+                     << s.p999Ms << ","
+                     << s.maxMs << ","
+                     << s.successCount << ","
+                     << s.totalCount << ","
+                     << pattern_ << ","
+                     << options.transport << ","
+                     << std::setprecision(1) << s.cpuUsPerRequest << ","
+                     << std::setprecision(6) << s.throughputGBps << "\n";
+                std::cout << "  concurrency " << std::setw(4) << point.first << ": "
+                          << std::fixed << std::setprecision(1) << s.achievedQps << " req/s, p50: "
+                          << std::setprecision(3) << s.p50Ms << "ms, p99: " << s.p99Ms << "ms, "
+                          << s.throughputGBps << " GB/s" << std::endl;
+            }
+            for (const auto& point : curve.second) {
+                if (point.second.achievedQps >= 0.9 * bestQps) {
+                    std::cout << "  knee: concurrency " << point.first << " ("
+                              << std::setprecision(1) << point.second.achievedQps << " req/s, p99: "
+                              << std::setprecision(3) << point.second.p99Ms << "ms)" << std::endl;
+                    break;
+                }
+            }
+        }
+        file.close();
+        std::cout << "Throughput-latency table saved to " << filename << std::endl;
     }
 
 private:
+    // Appended to every output file name so runs that differ in these options
+    // never overwrite each other: _<payload> unless repeat, _<compression>
+    // unless none, _raw for --codec raw, _ch<N> for channel pools, _<tuning>
+    // unless default, _inprocess or _inprocess_tcp for --inprocess.
+    static std::string FileSuffix(const ClientOptions& options) {
+        std::string suffix;
+        if (Payloads().kind() != "repeat") {
+            suffix += "_" + Payloads().Label();
+        }
+        if (options.compression != "none") {
+            suffix += "_" + options.compression;
+        }
+        if (options.codec == "raw") {
+            suffix += "_raw";
+        }
+        if (options.channelsPerWorker > 1) {
+            suffix += "_ch" + std::to_string(options.channelsPerWorker);
+        }
+        if (options.tuning.name != "default") {
+            suffix += "_" + options.tuning.name;
+        }
+        if (options.inprocess != nullptr) {
+            suffix += options.inprocessTransport == "tcp" ? "_inprocess_tcp" : "_inprocess";
+        }
+        return suffix;
+    }
+
+    // twohop and tree only ever call the first worker, the head of the chain
+    // or the root of the tree; the workers behind it are wired with --forward-to
+    bool CallsRootOnly() const { return pattern_ == "twohop" || pattern_ == "tree"; }
+
+    // hedged and tied send each request to two workers, but either copy is
+    // the request: only one of them has to be answered
+    bool Hedged() const { return pattern_ == "hedged" || pattern_ == "tied"; }
+
+    // Background NTP-style exchanges with every worker the pattern calls, so
+    // the clock estimates stay fresh at low request rates and between runs.
+    void ProbeClocks() {
+        size_t count = CallsRootOnly() ? 1 : clients_.size();
+        std::unique_lock<std::mutex> lock(clockProbeMutex_);
+        while (!clockProbeCv_.wait_for(lock, std::chrono::milliseconds(clockSyncMs_),
+                                       [this]() { return stopClockProbe_; })) {
+            lock.unlock();
+            for (size_t i = 0; i < count; ++i) {
+                BenchmarkResponse response;
+                int64_t receivedNs;
+                if (clients_[i]->Probe(&response, &receivedNs)) {
+                    breakdown_.Observe(i, response, receivedNs);
+                }
+            }
+            lock.lock();
+        }
+    }
+
+    void PrintBreakdownSummary(size_t rows, const std::string& suffix) {
+        if (rows > 0) {
+            std::cout << "Latency breakdown saved to csvfiles/latency_breakdown_" << pattern_ << suffix << ".csv"
+                      << std::endl;
+        }
+        breakdown_.PrintClocks(workerAddresses_);
+    }
+
+    // Offsets from the start of a payload-size step at which each request is due.
+    std::vector<std::chrono::nanoseconds> BuildArrivalSchedule(int count, double rateQps, const std::string& arrival,
+                                                               std::mt19937_64& rng) {
+        std::vector<std::chrono::nanoseconds> schedule;
+        schedule.reserve(count);
+        std::exponential_distribution<double> interArrival(rateQps);
+        double offsetSec = 0.0;
+        for (int i = 0; i < count; ++i) {
+            schedule.push_back(std::chrono::nanoseconds(static_cast<int64_t>(offsetSec * 1e9)));
+            offsetSec += (arrival == "poisson") ? interArrival(rng) : 1.0 / rateQps;
+        }
+        return schedule;
+    }
+
+    // Issues count requests, never more than maxInFlight_ at once, either on the
+    // given arrival schedule or as fast as slots free up, and waits for all of
+    // them to complete. Returns how far the worst send fell behind its slot.
+    double DriveRequests(int count, int payloadSize, LatencyHistogram* histogram, FanoutStats* fanout,
+                         const std::vector<std::chrono::nanoseconds>* schedule, int& requestId) {
+        double maxSendLagMs = 0.0;
+        auto base = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; ++i) {
+            {
+                std::unique_lock<std::mutex> lock(loadMutex_);
+                loadCv_.wait(lock, [this]() { return inFlight_ < maxInFlight_; });
+                ++inFlight_;
+            }
+
+            auto intended = std::chrono::steady_clock::now();
+            if (schedule != nullptr) {
+                intended = base + (*schedule)[i];
+                std::this_thread::sleep_until(intended);
+            }
+
+            auto* request = new PendingRequest();
+            request->requestId = requestId++;
+            request->payloadSize = payloadSize;
+            request->histogram = histogram;
+            request->fanout = fanout;
+            request->intendedStart = intended;
+            IssueRequest(request);
+
+            double lagMs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - intended).count() / 1000000.0;
+            maxSendLagMs = std::max(maxSendLagMs, lagMs);
+        }
+
+        std::unique_lock<std::mutex> lock(loadMutex_);
+        loadCv_.wait(lock, [this]() { return inFlight_ == 0; });
+        return maxSendLagMs;
+    }
+
+    static std::string TransportDescription(const std::string& transport) {
+        if (transport == "stream") {
+            return "bidi stream per worker";
+        } else if (transport == "shm") {
+            return "shared-memory rings per worker";
+        } else if (transport == "tcp") {
+            return "raw TCP connection per worker";
+        }
+        return "unary RPC per request";
+    }
+
+    // Opens --channels-per-worker stream, shared-memory or TCP pipes to each
+    // worker the pattern talks to (a stream per pool channel); twohop and tree
+    // only ever talk to the first worker.
+    void OpenPipes(const std::string& transport) {
+        size_t count = CallsRootOnly() ? 1 : clients_.size();
+        auto onDone = [this](PendingRequest* request, size_t workerIndex, bool ok, const BenchmarkResponse* response) {
+            OnLegDone(request, workerIndex, ok, response);
+        };
+        for (size_t i = 0; i < count; ++i) {
+            auto pool = std::make_unique<PipePool>();
+            for (int c = 0; c < channelsPerWorker_; ++c) {
+                if (transport == "shm") {
+                    pool->pipes.push_back(std::make_unique<ShmPipe>(workerAddresses_[i], shmWait_, i,
+                                                                    clients_[i]->reuseBuffers(), onDone));
+                } else if (transport == "tcp") {
+                    pool->pipes.push_back(std::make_unique<TcpPipe>(workerAddresses_[i], i,
+                                                                    clients_[i]->reuseBuffers(), onDone));
+                } else {
+                    pool->pipes.push_back(std::make_unique<BenchmarkStream>(
+                        *clients_[i], c % clients_[i]->channelCount(), i, onDone));
+                }
+            }
+            pipes_.push_back(std::move(pool));
+        }
+    }
+
+    void IssueRequest(PendingRequest* request) {
+        if (pattern_ == "direct") {
+            request->pendingLegs = clients_.size();
+            for (size_t i = 0; i < clients_.size(); ++i) {
+                IssueLeg(request, i);
+            }
+        } else {
+            // sequential starts at worker 0 and continues from OnLegDone;
+            // twohop and tree only ever talk to the first worker
+            request->pendingLegs = 1;
+            IssueLeg(request, 0);
+        }
+    }
+
+    void IssueLeg(PendingRequest* request, size_t workerIndex) {
+        if (!pipes_.empty()) {
+            PipePool& pool = *pipes_[workerIndex];
+            size_t index = PickFromPool(pool.pipes.size(), leastOutstanding_, pool.next, [&pool](size_t i) {
+                return pool.pipes[i]->Outstanding();
+            });
+            pool.pipes[index]->Send(request);
+            return;
+        }
+        auto* leg = new UnaryLeg();
+        leg->owner = request;
+        leg->workerIndex = workerIndex;
+        clients_[workerIndex]->StartAsyncBenchmark(leg, request->requestId, request->payloadSize, cq_.get());
+    }
+
+    // The sending thread has the placement's first CPU, this one the second
+    void PollUnaryCompletions() {
+        if (placement_.Active()) {
+            PinThreadToCpu(1);
+        }
+        void* tag;
+        bool ok;
+        while (NextCompletion(cq_.get(), tuning_.busyPollCq, &tag, &ok)) {
+            std::unique_ptr<UnaryLeg> leg(static_cast<UnaryLeg*>(tag));
+            OnLegDone(leg->owner, leg->workerIndex, leg->Succeeded(ok), leg->raw ? nullptr : leg->response.get());
+        }
+    }
+
+    // Called from the CQ poller (unary) or a pipe reader thread (stream, shm, tcp).
+    // response is null for failed and raw-codec legs.
+    void OnLegDone(PendingRequest* request, size_t workerIndex, bool ok, const BenchmarkResponse* response) {
+        if (ok && response != nullptr) {
+            if (request->histogram != nullptr) {
+                breakdown_.Record(request->payloadSize, workerIndex, *response, WallClockNs());
+                treeShape_.Observe(*response);
+            } else {
+                breakdown_.Observe(workerIndex, *response, WallClockNs());
+            }
+        }
+        if (!ok) {
+            request->success = false;
+        } else if (request->fanout != nullptr) {
+            uint64_t legNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - request->intendedStart).count();
+            request->fanout->RecordLeg(workerIndex, legNs);
+
+            std::lock_guard<std::mutex> lock(request->legMutex);
+            request->fastestLegNs = std::min(request->fastestLegNs, legNs);
+            if (legNs >= request->slowestLegNs) {
+                request->slowestLegNs = legNs;
+                request->slowestWorker = workerIndex;
+            }
+        }
+        if (pattern_ == "sequential" && workerIndex + 1 < clients_.size()) {
+            IssueLeg(request, workerIndex + 1);
+            return;
+        }
+        if (--request->pendingLegs > 0) {
+            return;
+        }
+        CompleteRequest(request, workerIndex);
+    }
+
+    void CompleteRequest(PendingRequest* request, size_t lastWorker) {
+        auto now = std::chrono::steady_clock::now();
+        LatencyMeasurement measurement;
+        measurement.payloadSize = request->payloadSize;
+        measurement.worker = lastWorker;
+        measurement.latencyMs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            now - request->intendedStart).count() / 1000000.0;
+        measurement.success = request->success;
+        LatencyHistogram* histogram = request->histogram;
+
+        if (request->fanout != nullptr && measurement.success) {
+            request->fanout->RecordBroadcast(request->slowestWorker, request->slowestLegNs - request->fastestLegNs);
+        }
+
+        if (!measurement.success) {
+            std::cout << "Request " << request->requestId << " failed" << std::endl;
+        }
+        delete request;
+
+        // Pipe transports complete requests from several reader threads, so the
+        // results file is written under the same lock as the counters
+        std::lock_guard<std::mutex> lock(loadMutex_);
+        if (histogram != nullptr) {
+            RecordResult(measurement, *histogram);
+            if (measurement.success) {
+                loadSuccessCount_++;
+            }
+            lastCompletion_ = now;
+        }
+        --inFlight_;
+        loadCv_.notify_all();
+    }
+
+    // Caller holds loadMutex_.
+    LoadSummary SummarizeLoad(const LatencyHistogram& histogram, int payloadSize, double rateQps,
+                              int totalCount, std::chrono::steady_clock::time_point base) {
+        LoadSummary summary{};
+        summary.payloadSize = payloadSize;
+        summary.offeredQps = rateQps;
+        summary.successCount = loadSuccessCount_;
+        summary.totalCount = totalCount;
+
+        double elapsedSec = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            lastCompletion_ - base).count() / 1e9;
+        summary.achievedQps = elapsedSec > 0.0 ? loadSuccessCount_ / elapsedSec : 0.0;
+
+        summary.meanMs = histogram.MeanMs();
+        summary.p50Ms = histogram.ValueAtPercentileMs(50.0);
+        summary.p90Ms = histogram.ValueAtPercentileMs(90.0);
+        summary.p99Ms = histogram.ValueAtPercentileMs(99.0);
+        summary.p999Ms = histogram.ValueAtPercentileMs(99.9);
+        summary.maxMs = histogram.MaxMs();
+        return summary;
+    }
+
+    // OfferedQps is 0 for closed-loop runs, which have no fixed offered rate.
+    void SaveLoadSummary(const std::vector<LoadSummary>& summaries, const std::string& filename,
+                         const LoadOptions& options) {
+        std::filesystem::create_directories("csvfiles");
+
+        std::ofstream file(filename);
+        file << "PayloadSize,OfferedQps,AchievedQps,MeanMs,P50Ms,P90Ms,P99Ms,P999Ms,MaxMs,MaxSendLagMs,Success,Total,"
+             << "Pattern,Transport,Window,AllocsPerRequest,Codec,Channels,Payload,Compression,HeadCpuUsPerRequest,"
+             << "ThroughputGBps,Tuning,HeadCpus,HeadNumaNode\n";
+
+        for (const auto& s : summaries) {
+            file << s.payloadSize << ","
+                 << std::fixed << std::setprecision(3) << s.offeredQps << ","
+                 << s.achievedQps << ","
+                 << std::setprecision(6) << s.meanMs << ","
+                 << s.p50Ms << ","
+                 << s.p90Ms << ","
+                 << s.p99Ms << ","
+                 << s.p999Ms << ","
+                 << s.maxMs << ","
+                 << s.maxSendLagMs << ","
+                 << s.successCount << ","
+                 << s.totalCount << ","
+                 << pattern_ << ","
+                 << options.transport << ","
+                 << (options.mode == "openloop" ? options.maxInFlight : options.window) << ","
+                 << std::setprecision(2) << s.allocsPerRequest << ","
+                 << codec_ << ","
+                 << channelsPerWorker_ << ","
+                 << payload_ << ","
+                 << compression_ << ","
+                 << std::setprecision(1) << s.cpuUsPerRequest << ","
+                 << std::setprecision(6) << s.throughputGBps << ","
+                 << tuning_.name << ","
+                 << CpusColumn() << ","
+                 << placement_.numaNode << "\n";
+        }
+
+        file.close();
+    }
+
+    // The head's CPU list for a CSV cell: ';'-separated, "all" without a placement
+    std::string CpusColumn() const {
+        if (placement_.cpus.empty()) {
+            return "all";
+        }
+        std::string cpus = FormatCpuList(placement_.cpus);
+        std::replace(cpus.begin(), cpus.end(), ',', ';');
+        return cpus;
+    }
     std::string GetPatternDescription() {
         if (pattern_ == "direct") {
             return "head -> broadcast to all " + std::to_string(clients_.size()) + " worker(s) and wait";
@@ -160,6 +2023,13 @@ private:
             return "head -> worker1 -> ack -> head -> worker2 -> ack -> head ... (" + std::to_string(clients_.size()) + " workers)";
         } else if (pattern_ == "twohop") {
             return "head -> worker1 -> worker2 -> ... -> worker" + std::to_string(clients_.size()) + " -> ack -> head";
+        } else if (pattern_ == "tree") {
+            return "head -> root -> k children each -> ... -> leaves -> aggregated acks -> root -> head";
+        } else if (pattern_ == "hedged") {
+            return "head -> primary worker, backup to the next worker after " + hedgeDelayLabel_ +
+                   " -> first ack -> head";
+        } else if (pattern_ == "tied") {
+            return "head -> primary and backup worker at once -> first ack -> head, loser cancelled";
         }
         return "unknown pattern";
     }
@@ -176,30 +2046,48 @@ private:
             std::cout << "Sequential pattern: Contacting all " << clients_.size() << " worker(s) in sequence" << std::endl;
         } else if (pattern_ == "twohop") {
             std::cout << "Two-hop pattern: Using " << clients_.size() << "-worker forwarding chain" << std::endl;
+        } else if (pattern_ == "tree") {
+            std::cout << "Tree pattern: multicasting through the tree rooted at " << workerAddresses_[0] << std::endl;
+            if (clients_.size() > 1) {
+                std::cout << "  (only the root is called; the other --workers addresses are ignored)" << std::endl;
+            }
+        } else if (Hedged()) {
+            if (clients_.size() < 2) {
+                std::cout << "Error: the " << pattern_ << " pattern needs at least 2 workers" << std::endl;
+                return false;
+            }
+            std::cout << (pattern_ == "tied" ? "Tied" : "Hedged") << " pattern: primaries rotate over "
+                      << clients_.size() << " workers, each backed up by the next" << std::endl;
         }
         
         return true;
     }
 
-    LatencyMeasurement RunPatternRequest(int requestId, int payloadSize) {
+    LatencyMeasurement RunPatternRequest(int requestId, int payloadSize, FanoutStats* fanout = nullptr,
+                                         HedgeStats* hedge = nullptr) {
         if (pattern_ == "direct") {
-            return RunDirectRequest(requestId, payloadSize);
+            return RunDirectRequest(requestId, payloadSize, fanout);
         } else if (pattern_ == "sequential") {
             return RunSequentialRequest(requestId, payloadSize);
-        } else if (pattern_ == "twohop") {
+        } else if (pattern_ == "twohop" || pattern_ == "tree") {
             return RunTwoHopRequest(requestId, payloadSize);
+        } else if (Hedged()) {
+            return RunHedgedRequest(requestId, payloadSize, hedge);
         }
         
         LatencyMeasurement failed;
+        failed.payloadSize = payloadSize;
+        failed.latencyMs = 0.0;
         failed.success = false;
-        failed.pattern = pattern_;
         return failed;
     }
 
-    LatencyMeasurement RunDirectRequest(int requestId, int payloadSize) {
+    // Broadcasts one request to every worker as async calls on fanoutCq_ and
+    // drains the completions on the calling thread, so no threads are created
+    // per sample and each worker's own response time is observed.
+    LatencyMeasurement RunDirectRequest(int requestId, int payloadSize, FanoutStats* fanout) {
         LatencyMeasurement result;
         result.payloadSize = payloadSize;
-        result.pattern = "direct";
         result.success = true;
 
         if (clients_.empty()) {
@@ -208,32 +2096,71 @@ private:
             return result;
         }
 
-        auto overallStart = std::chrono::high_resolution_clock::now();
-
-        std::vector<LatencyMeasurement> workerMeasurements(clients_.size());
-        std::vector<std::thread> workers;
-        workers.reserve(clients_.size());
+        auto overallStart = std::chrono::steady_clock::now();
 
+        std::vector<UnaryLeg> legs(clients_.size());
         for (size_t i = 0; i < clients_.size(); ++i) {
+            legs[i].workerIndex = i;
             int workerRequestId = requestId + static_cast<int>(i) * 1000000;
-            workers.emplace_back([this, i, workerRequestId, payloadSize, &workerMeasurements]() {
-                workerMeasurements[i] = clients_[i]->RunBenchmark(workerRequestId, payloadSize);
-            });
+            clients_[i]->StartAsyncBenchmark(&legs[i], workerRequestId, payloadSize, &fanoutCq_);
         }
 
-        for (auto& worker : workers) {
-            if (worker.joinable()) {
-                worker.join();
+        uint64_t fastestNs = UINT64_MAX;
+        uint64_t slowestNs = 0;
+        size_t slowestWorker = 0;
+        std::vector<bool> finished(legs.size(), false);
+        size_t done = 0;
+        for (; done < legs.size(); ++done) {
+            void* tag;
+            bool ok;
+            if (!NextCompletion(&fanoutCq_, tuning_.busyPollCq, &tag, &ok)) {
+                result.success = false;
+                break;
+            }
+            auto* leg = static_cast<UnaryLeg*>(tag);
+            finished[leg - legs.data()] = true;
+            uint64_t legNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - overallStart).count();
+
+            if (!leg->Succeeded(ok)) {
+                result.success = false;
+                continue;
+            }
+            if (!leg->raw) {
+                breakdown_.Record(payloadSize, leg->workerIndex, *leg->response.get(), WallClockNs());
+            }
+            if (fanout != nullptr) {
+                fanout->RecordLeg(leg->workerIndex, legNs);
+            }
+            fastestNs = std::min(fastestNs, legNs);
+            if (legNs >= slowestNs) {
+                slowestNs = legNs;
+                slowestWorker = leg->workerIndex;
+            }
+        }
+        auto overallEnd = std::chrono::steady_clock::now();
+
+        // The legs own the calls still in flight, and their tags are still due on
+        // fanoutCq_; cancel those calls and wait them out before legs goes away
+        if (done < legs.size()) {
+            for (size_t i = 0; i < legs.size(); ++i) {
+                if (!finished[i]) {
+                    legs[i].context.TryCancel();
+                }
+            }
+            for (void* tag; done < legs.size(); ++done) {
+                bool ok;
+                if (!NextCompletion(&fanoutCq_, tuning_.busyPollCq, &tag, &ok)) {
+                    break;
+                }
             }
         }
 
-        auto overallEnd = std::chrono::high_resolution_clock::now();
         result.latencyMs = std::chrono::duration_cast<std::chrono::nanoseconds>(overallEnd - overallStart).count() / 1000000.0;
 
-        for (const auto& measurement : workerMeasurements) {
-            if (!measurement.success) {
-                result.success = false;
-            }
+        result.worker = slowestWorker;
+        if (result.success && fanout != nullptr) {
+            fanout->RecordBroadcast(slowestWorker, slowestNs - fastestNs);
         }
 
         if (!result.success) {
@@ -243,10 +2170,121 @@ private:
         return result;
     }
 
+    // Hedged and tied requests ("The Tail at Scale"): each request goes to a
+    // primary worker, rotating, with the next worker as its backup. hedged
+    // sends the backup only once the primary has been outstanding for the
+    // hedge delay, or has failed; tied sends both at once. The first success is
+    // the result and the other call is cancelled, then drained from fanoutCq_
+    // before the next request.
+    LatencyMeasurement RunHedgedRequest(int requestId, int payloadSize, HedgeStats* stats) {
+        LatencyMeasurement result;
+        result.payloadSize = payloadSize;
+        result.latencyMs = 0.0;
+        result.success = false;
+
+        bool tied = pattern_ == "tied";
+        double delayMs = tied ? 0.0 : HedgeDelayMs(payloadSize);
+        bool hedging = tied || delayMs >= 0.0;
+
+        auto start = std::chrono::steady_clock::now();
+        auto hedgeAt = std::chrono::system_clock::now() +
+                       std::chrono::microseconds(static_cast<int64_t>(std::max(delayMs, 0.0) * 1000.0));
+        UnaryLeg legs[2];
+        bool sent[2] = {false, false};
+        legs[0].workerIndex = nextPrimary_++ % clients_.size();
+        legs[1].workerIndex = (legs[0].workerIndex + 1) % clients_.size();
+        int outstanding = 0;
+        auto send = [&](int copy) {
+            clients_[legs[copy].workerIndex]->StartAsyncBenchmark(&legs[copy], requestId + copy * 1000000,
+                                                                  payloadSize, &fanoutCq_);
+            sent[copy] = true;
+            ++outstanding;
+        };
+        send(0);
+        if (tied) {
+            send(1);
+        }
+
+        UnaryLeg* winner = nullptr;
+        uint64_t cancelled = 0;
+        while (outstanding > 0) {
+            void* tag;
+            bool ok;
+            if (hedging && !sent[1]) {
+                auto status = fanoutCq_.AsyncNext(&tag, &ok, hedgeAt);
+                if (status == CompletionQueue::TIMEOUT) {
+                    send(1);
+                    continue;
+                }
+                if (status == CompletionQueue::SHUTDOWN) {
+                    break;
+                }
+            } else if (!NextCompletion(&fanoutCq_, tuning_.busyPollCq, &tag, &ok)) {
+                break;
+            }
+            --outstanding;
+            auto* leg = static_cast<UnaryLeg*>(tag);
+
+            if (winner != nullptr) {
+                if (leg->status.error_code() == grpc::StatusCode::CANCELLED) {
+                    ++cancelled;
+                }
+            } else if (leg->Succeeded(ok)) {
+                winner = leg;
+                result.latencyMs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count() / 1000000.0;
+                for (int copy = 0; copy < 2; ++copy) {
+                    if (sent[copy] && &legs[copy] != leg) {
+                        legs[copy].context.TryCancel();
+                    }
+                }
+            } else if (hedging && !sent[1]) {
+                // The primary failed before the hedge delay; no point waiting
+                send(1);
+            }
+        }
+
+        if (winner != nullptr) {
+            result.success = true;
+            result.worker = winner->workerIndex;
+            if (!winner->raw) {
+                breakdown_.Record(payloadSize, winner->workerIndex, *winner->response.get(), WallClockNs());
+            }
+        } else {
+            std::cout << (tied ? "Tied" : "Hedged") << " request " << requestId << " failed on every worker tried"
+                      << std::endl;
+        }
+        if (stats != nullptr) {
+            ++stats->requests;
+            stats->backups += sent[1] ? 1 : 0;
+            stats->backupWins += winner == &legs[1] ? 1 : 0;
+            stats->cancelled += cancelled;
+            if (!tied && hedging) {
+                ++stats->delayed;
+                stats->delaySumMs += delayMs;
+            }
+        }
+        return result;
+    }
+
+    // The hedge delay in force for the next request at this size, or -1 for
+    // none. pNN needs a few samples of the size first; until then requests go
+    // out unhedged.
+    double HedgeDelayMs(int payloadSize) {
+        static constexpr uint64_t kMinSamples = 20;
+        if (hedgeDelay_.never) {
+            return -1.0;
+        }
+        if (hedgeDelay_.fixedMs >= 0.0) {
+            return hedgeDelay_.fixedMs;
+        }
+        const LatencyHistogram& histogram = HistogramFor(payloadSize);
+        return histogram.TotalCount() < kMinSamples ? -1.0 : histogram.ValueAtPercentileMs(hedgeDelay_.percentile);
+    }
+
     LatencyMeasurement RunSequentialRequest(int requestId, int payloadSize) {
         LatencyMeasurement result;
         result.payloadSize = payloadSize;
-        result.pattern = "sequential";
         result.success = true;  // Start optimistic
 
         auto overallStart = std::chrono::high_resolution_clock::now();
@@ -259,6 +2297,7 @@ private:
                 // Continue to other workers even if one fails
             }
         }
+        result.worker = clients_.size() - 1;
         
         auto overallEnd = std::chrono::high_resolution_clock::now();
         result.latencyMs = std::chrono::duration_cast<std::chrono::nanoseconds>(
@@ -268,39 +2307,425 @@ private:
     }
 
     LatencyMeasurement RunTwoHopRequest(int requestId, int payloadSize) {
-        // For two-hop, we just send to the first worker, which forwards automatically
+        // For two-hop and tree, we just send to the first worker, which forwards automatically
         auto measurement = clients_[0]->RunBenchmark(requestId, payloadSize);
         
         LatencyMeasurement result;
         result.payloadSize = measurement.payloadSize;
         result.latencyMs = measurement.latencyMs;
         result.success = measurement.success;
-        result.pattern = "twohop";
         
         return result;
     }
 
-    void SaveResults(const std::vector<LatencyMeasurement>& measurements) {
+    std::string ResultsPath(const std::string& suffix) const {
+        return "csvfiles/benchmark_results_" + pattern_ + suffix + (binaryResults_ ? ".brlog" : ".csv");
+    }
+
+    // Per-sample rows are streamed to disk as they are measured rather than
+    // buffered, so memory stays flat no matter how long the sweep runs.
+    void OpenResults(const std::string& suffix) {
         // Create csvfiles directory if it doesn't exist
         std::filesystem::create_directories("csvfiles");
         
-        std::string filename = "csvfiles/benchmark_results_" + pattern_ + ".csv";
+        if (binaryResults_) {
+            resultsLog_.Open(ResultsPath(suffix), {pattern_}, workerAddresses_);
+        } else {
+            resultsFile_.open(ResultsPath(suffix));
+            resultsFile_ << "PayloadSize,LatencyMs,Success,Pattern\n";
+        }
+        // Raw-codec responses are never parsed, so they carry no timestamps to break down
+        if (codec_ != "raw") {
+            breakdown_.Open("csvfiles/latency_breakdown_" + pattern_ + suffix + ".csv");
+        }
+        totalMeasurements_ = 0;
+        histograms_.clear();
+        fanoutStats_.clear();
+    }
+
+    void RecordResult(const LatencyMeasurement& m, LatencyHistogram& histogram) {
+        if (m.success) {
+            histogram.RecordMs(m.latencyMs);
+        }
+        totalMeasurements_++;
+        if (binaryResults_) {
+            resultsLog_.Append(static_cast<uint32_t>(m.payloadSize), std::llround(m.latencyMs * 1e6), m.success,
+                               static_cast<uint16_t>(m.worker));
+            return;
+        }
+        resultsFile_ << m.payloadSize << "," 
+                     << std::fixed << std::setprecision(6) << m.latencyMs << ","
+                     << (m.success ? "1" : "0") << ","
+                     << pattern_ << "\n";
+    }
+
+    void CloseResults() {
+        resultsFile_.close();
+        resultsLog_.Close();
+    }
+
+    // Histograms are created before a payload size starts, so senders only ever
+    // record into an existing one.
+    LatencyHistogram& HistogramFor(int payloadSize) {
+        auto& slot = histograms_[payloadSize];
+        if (!slot) {
+            slot = std::make_unique<LatencyHistogram>();
+        }
+        return *slot;
+    }
+
+    HedgeStats* HedgeStatsFor(int payloadSize) {
+        return Hedged() ? &hedgeStats_[payloadSize] : nullptr;
+    }
+
+    // Only direct broadcasts to more than one worker have stragglers to report.
+    FanoutStats* FanoutStatsFor(int payloadSize) {
+        if (pattern_ != "direct" || clients_.size() < 2) {
+            return nullptr;
+        }
+        auto& slot = fanoutStats_[payloadSize];
+        if (!slot) {
+            slot = std::make_unique<FanoutStats>(clients_.size());
+        }
+        return slot.get();
+    }
+
+    void PrintPercentiles(const LatencyHistogram& histogram, int successCount, int samplesPerSize) {
+        if (histogram.TotalCount() == 0) {
+            std::cout << "All requests failed!" << std::endl;
+            return;
+        }
+        std::cout << std::fixed << std::setprecision(3)
+                  << "p50: " << histogram.ValueAtPercentileMs(50.0) << "ms, "
+                  << "p90: " << histogram.ValueAtPercentileMs(90.0) << "ms, "
+                  << "p99: " << histogram.ValueAtPercentileMs(99.0) << "ms, "
+                  << "p99.9: " << histogram.ValueAtPercentileMs(99.9) << "ms, "
+                  << "p99.99: " << histogram.ValueAtPercentileMs(99.99) << "ms, "
+                  << "max: " << histogram.MaxMs() << "ms, "
+                  << "Success: " << successCount << "/" << samplesPerSize << std::endl;
+    }
+
+    // C++ heap allocations per request over a payload size, including the
+    // head's own bookkeeping (see src/allocationCounter.h)
+    void PrintAllocations(uint64_t allocations, int requests) {
+        std::cout << "    allocations: " << std::fixed << std::setprecision(1)
+                  << static_cast<double>(allocations) / requests << " per request" << std::endl;
+    }
+
+    // Head process CPU per request over a payload size, counting every thread,
+    // so serialization and compression on gRPC's threads are included
+    void PrintCpu(uint64_t cpuNs, int requests) {
+        std::cout << "    head cpu: " << std::fixed << std::setprecision(1)
+                  << cpuNs / 1000.0 / requests << " us per request" << std::endl;
+    }
+
+    // Payload bytes the head sends per request: one copy to every worker it calls
+    double BytesPerRequest(int payloadSize) const {
+        return static_cast<double>(payloadSize) * (CallsRootOnly() || Hedged() ? 1 : clients_.size());
+    }
+
+    // Single-request goodput at the median and the tail, and for pipelined
+    // runs the aggregate rate (GB = 10^9 bytes)
+    void PrintBandwidth(int payloadSize, const LatencyHistogram& histogram, double achievedGBps = -1.0) {
+        if (histogram.TotalCount() == 0) {
+            return;
+        }
+        double bytes = BytesPerRequest(payloadSize);
+        std::cout << "    bandwidth: " << std::fixed << std::setprecision(3)
+                  << bytes / (histogram.ValueAtPercentileMs(50.0) * 1e6) << " GB/s at p50, "
+                  << bytes / (histogram.ValueAtPercentileMs(99.0) * 1e6) << " GB/s at p99";
+        if (achievedGBps >= 0.0) {
+            std::cout << ", " << achievedGBps << " GB/s achieved";
+        }
+        std::cout << std::endl;
+    }
+
+    // Tree pattern: prints the tree the root reported for this payload size and
+    // appends a row to csvfiles/tree_summary.csv. The file accumulates across
+    // runs, so sweeping topologies with one head run each builds a table of
+    // latency against fan-out and depth.
+    void RecordTreeShape(int payloadSize, const LatencyHistogram& histogram, const std::string& mode, int window) {
+        if (pattern_ != "tree" || treeShape_.Samples() == 0) {
+            return;
+        }
+        std::cout << "    tree: " << treeShape_.MaxWorkers() << " workers, fan-out " << treeShape_.Fanout()
+                  << ", depth " << treeShape_.Depth();
+        if (treeShape_.MinWorkers() < treeShape_.MaxWorkers()) {
+            std::cout << " (some broadcasts reached only " << treeShape_.MinWorkers() << " workers)";
+        }
+        std::cout << std::endl;
+
+        std::filesystem::create_directories("csvfiles");
+        std::string filename = "csvfiles/tree_summary.csv";
+        bool exists = std::filesystem::exists(filename);
+        std::ofstream file(filename, std::ios::app);
+        if (!exists) {
+            file << "Fanout,Depth,Workers,PayloadSize,Samples,Mode,Window,MeanMs,P50Ms,P90Ms,P99Ms,P999Ms,MaxMs,"
+                 << "MinWorkers\n";
+        }
+        file << treeShape_.Fanout() << ","
+             << treeShape_.Depth() << ","
+             << treeShape_.MaxWorkers() << ","
+             << payloadSize << ","
+             << histogram.TotalCount() << ","
+             << mode << ","
+             << window << ","
+             << std::fixed << std::setprecision(6) << histogram.MeanNs() / 1e6 << ","
+             << histogram.ValueAtPercentileMs(50.0) << ","
+             << histogram.ValueAtPercentileMs(90.0) << ","
+             << histogram.ValueAtPercentileMs(99.0) << ","
+             << histogram.ValueAtPercentileMs(99.9) << ","
+             << histogram.MaxMs() << ","
+             << treeShape_.MinWorkers() << "\n";
+    }
+
+    void PrintSchedule(const SizeSchedule& schedule) {
+        std::cout << "Payload sizes: " << schedule.sizes.size() << " from " << schedule.sizes.front() << " to "
+                  << schedule.sizes.back() << " bytes (" << schedule.description << ")" << std::endl;
+    }
+
+    void PrintFanout(const FanoutStats* fanout) {
+        if (fanout == nullptr || fanout->spread.TotalCount() == 0) {
+            return;
+        }
+        auto straggler = std::max_element(fanout->slowestCount.begin(), fanout->slowestCount.end(),
+            [](const std::atomic<uint64_t>& a, const std::atomic<uint64_t>& b) { return a.load() < b.load(); });
+        size_t worker = straggler - fanout->slowestCount.begin();
+        std::cout << std::fixed << std::setprecision(3)
+                  << "    straggler: worker " << worker << " (" << workerAddresses_[worker] << ") slowest in "
+                  << std::setprecision(1) << 100.0 * straggler->load() / fanout->spread.TotalCount() << "% of broadcasts, "
+                  << std::setprecision(3)
+                  << "first-to-last spread p50: " << fanout->spread.ValueAtPercentileMs(50.0) << "ms, "
+                  << "p99: " << fanout->spread.ValueAtPercentileMs(99.0) << "ms" << std::endl;
+    }
+
+    void PrintHedging(const HedgeStats* hedge) {
+        if (hedge == nullptr || hedge->requests == 0) {
+            return;
+        }
+        std::cout << std::fixed << std::setprecision(1) << "    hedging: backup sent for "
+                  << 100.0 * hedge->Rate(hedge->backups) << "% of requests, answered first in "
+                  << 100.0 * hedge->Rate(hedge->backupWins) << "%, " << hedge->cancelled << " calls cancelled";
+        if (hedge->delayed > 0 && pattern_ == "hedged") {
+            std::cout << ", mean hedge delay " << std::setprecision(3) << hedge->MeanDelayMs() << "ms";
+        }
+        std::cout << std::endl;
+    }
+
+    // Worker-side stats (GetStats) are reset once warmup is done and then read
+    // and reset after every payload size, so each size gets the workers' own
+    // view of exactly its requests. Every worker address is asked, including
+    // the ones the pattern reaches only through forwarding.
+    void ResetWorkerStats(bool enabled) {
+        workerStats_.clear();
+        collectWorkerStats_ = enabled;
+        if (!enabled) {
+            return;
+        }
+        benchmark::WorkerStatsSnapshot ignored;
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            if (!clients_[i]->GetStats(true, &ignored)) {
+                std::cout << "Worker " << workerAddresses_[i] << " did not answer GetStats; "
+                          << "worker-side stats are off for this run" << std::endl;
+                collectWorkerStats_ = false;
+                return;
+            }
+        }
+    }
+
+    void CollectWorkerStats(int payloadSize) {
+        if (!collectWorkerStats_) {
+            return;
+        }
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            WorkerStatsSample sample{payloadSize, i, {}};
+            if (!clients_[i]->GetStats(true, &sample.stats)) {
+                std::cout << "    worker " << workerAddresses_[i] << ": GetStats failed" << std::endl;
+                continue;
+            }
+            PrintWorkerStats(sample);
+            workerStats_.push_back(std::move(sample));
+        }
+    }
+
+    void PrintWorkerStats(const WorkerStatsSample& sample) {
+        const benchmark::WorkerStatsSnapshot& stats = sample.stats;
+        std::cout << "    worker " << workerAddresses_[sample.worker] << ": " << stats.requests() << " answered";
+        if (stats.forwarded() > 0) {
+            std::cout << ", " << stats.forwarded() << " forwarded";
+        }
+        std::cout << std::fixed << std::setprecision(1);
+        for (const auto& stage : stats.stages()) {
+            if (stage.count() > 0) {
+                std::cout << ", " << stage.stage() << " p50/p99 " << stage.p50us() << "/" << stage.p99us() << "us";
+            }
+        }
+        if (stats.logdropped() > 0) {
+            std::cout << " (" << stats.logdropped() << " log lines dropped)";
+        }
+        std::cout << std::endl;
+    }
+
+    // One row per (payload size, worker, stage)
+    void SaveWorkerStats(const std::string& suffix) {
+        if (workerStats_.empty()) {
+            return;
+        }
+        std::string filename = "csvfiles/worker_stats_" + pattern_ + suffix + ".csv";
         std::ofstream file(filename);
-        file << "PayloadSize,LatencyMs,Success,Pattern\n";
-        
-        for (const auto& m : measurements) {
-            file << m.payloadSize << "," 
-                 << std::fixed << std::setprecision(6) << m.latencyMs << ","
-                 << (m.success ? "1" : "0") << ","
-                 << m.pattern << "\n";
+        file << "PayloadSize,Worker,Address,Requests,Forwarded,IntervalSec,Stage,Count,MeanUs,P50Us,P90Us,P99Us,MaxUs\n";
+
+        for (const auto& sample : workerStats_) {
+            const benchmark::WorkerStatsSnapshot& stats = sample.stats;
+            for (const auto& stage : stats.stages()) {
+                file << sample.payloadSize << ","
+                     << sample.worker << ","
+                     << workerAddresses_[sample.worker] << ","
+                     << stats.requests() << ","
+                     << stats.forwarded() << ","
+                     << std::fixed << std::setprecision(3) << stats.intervalsec() << ","
+                     << stage.stage() << ","
+                     << stage.count() << ","
+                     << stage.meanus() << ","
+                     << stage.p50us() << ","
+                     << stage.p90us() << ","
+                     << stage.p99us() << ","
+                     << stage.maxus() << "\n";
+            }
+        }
+
+        file.close();
+    }
+
+    void PrintWorkerStatsSummary(const std::string& suffix) {
+        if (!workerStats_.empty()) {
+            std::cout << "Worker-side stats saved to csvfiles/worker_stats_" << pattern_ << suffix << ".csv"
+                      << std::endl;
+        }
+    }
+
+    // One row per payload size: how much extra load hedging cost and what it
+    // bought, next to the tail it produced.
+    void SaveHedgeStats(const std::string& suffix) {
+        if (hedgeStats_.empty()) {
+            return;
+        }
+        std::string filename = "csvfiles/hedging_summary_" + pattern_ + suffix + ".csv";
+        std::ofstream file(filename);
+        file << "PayloadSize,Samples,HedgeDelay,MeanHedgeDelayMs,BackupRate,BackupWinRate,CancelledRate,"
+             << "MeanMs,P50Ms,P99Ms,P999Ms,MaxMs\n";
+
+        for (const auto& entry : hedgeStats_) {
+            const HedgeStats& stats = entry.second;
+            const LatencyHistogram& histogram = HistogramFor(entry.first);
+            file << entry.first << ","
+                 << histogram.TotalCount() << ","
+                 << (pattern_ == "tied" ? "tied" : hedgeDelayLabel_) << ","
+                 << std::fixed << std::setprecision(6) << stats.MeanDelayMs() << ","
+                 << stats.Rate(stats.backups) << ","
+                 << stats.Rate(stats.backupWins) << ","
+                 << stats.Rate(stats.cancelled) << ","
+                 << histogram.MeanMs() << ","
+                 << histogram.ValueAtPercentileMs(50.0) << ","
+                 << histogram.ValueAtPercentileMs(99.0) << ","
+                 << histogram.ValueAtPercentileMs(99.9) << ","
+                 << histogram.MaxMs() << "\n";
+        }
+
+        file.close();
+    }
+
+    // One row per (payload size, worker) with that worker's own latency and how
+    // often it was the straggler, plus the broadcast spread for the size.
+    void SaveFanoutStats(const std::string& suffix) {
+        if (fanoutStats_.empty()) {
+            return;
+        }
+        std::string filename = "csvfiles/direct_worker_stats" + suffix + ".csv";
+        std::ofstream file(filename);
+        file << "PayloadSize,Worker,Address,Samples,MeanMs,P50Ms,P99Ms,MaxMs,SlowestCount,SpreadP50Ms,SpreadP99Ms\n";
+
+        for (const auto& entry : fanoutStats_) {
+            const FanoutStats& stats = *entry.second;
+            for (size_t i = 0; i < stats.perWorker.size(); ++i) {
+                const LatencyHistogram& worker = *stats.perWorker[i];
+                file << entry.first << ","
+                     << i << ","
+                     << workerAddresses_[i] << ","
+                     << worker.TotalCount() << ","
+                     << std::fixed << std::setprecision(6) << worker.MeanMs() << ","
+                     << worker.ValueAtPercentileMs(50.0) << ","
+                     << worker.ValueAtPercentileMs(99.0) << ","
+                     << worker.MaxMs() << ","
+                     << stats.slowestCount[i].load() << ","
+                     << stats.spread.ValueAtPercentileMs(50.0) << ","
+                     << stats.spread.ValueAtPercentileMs(99.0) << "\n";
+            }
+        }
+
+        file.close();
+    }
+
+    void SaveHistograms(const std::string& suffix) {
+        std::string filename = "csvfiles/latency_histograms_" + pattern_ + suffix + ".hist";
+        std::ofstream file(filename);
+        for (const auto& entry : histograms_) {
+            entry.second->Write(file, pattern_ + ":" + std::to_string(entry.first));
         }
-        
         file.close();
     }
 
     std::vector<std::unique_ptr<BenchmarkClient>> clients_;
     std::vector<std::string> workerAddresses_;
     std::string pattern_;
+    std::string codec_;
+    std::string fileSuffix_;  // see FileSuffix
+    std::string payload_;
+    std::string compression_;
+    ShmWait shmWait_;
+    int channelsPerWorker_;
+    bool leastOutstanding_;
+    int clockSyncMs_;
+    bool binaryResults_;
+    TuningProfile tuning_;
+    CpuPlacement placement_;
+
+    LatencyBreakdown breakdown_;
+    TreeShape treeShape_;
+    std::thread clockProbe_;
+    std::mutex clockProbeMutex_;
+    std::condition_variable clockProbeCv_;
+    bool stopClockProbe_ = false;
+
+    std::ofstream resultsFile_;
+    ResultLogWriter resultsLog_;
+    size_t totalMeasurements_ = 0;
+    std::map<int, std::unique_ptr<LatencyHistogram>> histograms_;
+    std::map<int, std::unique_ptr<FanoutStats>> fanoutStats_;
+    std::map<int, HedgeStats> hedgeStats_;
+    std::vector<WorkerStatsSample> workerStats_;
+    bool collectWorkerStats_ = false;
+    HedgeDelay hedgeDelay_;
+    std::string hedgeDelayLabel_;
+    size_t nextPrimary_ = 0;
+
+    // Closed-loop direct broadcasts and hedged requests: async calls drained by the sender
+    CompletionQueue fanoutCq_;
+
+    // Pipelined load state: the sending thread and the completion side (the
+    // unary CompletionQueue poller or the pipe reader threads) meet here
+    std::unique_ptr<CompletionQueue> cq_;
+    struct PipePool {
+        std::vector<std::unique_ptr<RequestPipe>> pipes;
+        std::atomic<size_t> next{0};
+    };
+    std::vector<std::unique_ptr<PipePool>> pipes_;
+    std::mutex loadMutex_;
+    std::condition_variable loadCv_;
+    int inFlight_ = 0;
+    int maxInFlight_ = 0;
+    int loadSuccessCount_ = 0;
+    std::chrono::steady_clock::time_point lastCompletion_;
 };
 
 int main(int argc, char** argv) {
@@ -309,7 +2734,13 @@ int main(int argc, char** argv) {
     int minSize = 16;
     int maxSize = 8192;
     int increment = 16;
+    std::string sizeSchedule = "linear";
+    int sizesPerOctave = 1;
     int samplesPerSize = 100;
+    LoadOptions load;
+    ClientOptions clientOptions;
+    std::string payloadKind = "repeat";
+    int inprocessWorkers = 0;
     
     // Parse command line arguments
     for (int i = 1; i < argc; ++i) {
@@ -327,49 +2758,391 @@ int main(int argc, char** argv) {
                 }
             }
         } else if (arg == "--min-size" && i + 1 < argc) {
-            minSize = std::stoi(argv[++i]);
+            if (!ParseSizeOption(arg, argv[++i], 0, INT_MAX, &minSize)) {
+                return 1;
+            }
         } else if (arg == "--max-size" && i + 1 < argc) {
-            maxSize = std::stoi(argv[++i]);
+            if (!ParseSizeOption(arg, argv[++i], 0, INT_MAX, &maxSize)) {
+                return 1;
+            }
         } else if (arg == "--increment" && i + 1 < argc) {
-            increment = std::stoi(argv[++i]);
+            if (!ParseSizeOption(arg, argv[++i], 1, INT_MAX, &increment)) {
+                return 1;
+            }
+        } else if (arg == "--size-schedule" && i + 1 < argc) {
+            sizeSchedule = argv[++i];
+        } else if (arg == "--sizes-per-octave" && i + 1 < argc) {
+            sizesPerOctave = std::stoi(argv[++i]);
+        } else if (arg == "--chunk-threshold" && i + 1 < argc) {
+            // Payload sizes are ints, so nothing above INT_MAX could be chunked
+            if (!ParseSizeOption(arg, argv[++i], 0, INT_MAX, &clientOptions.chunkThresholdBytes)) {
+                return 1;
+            }
+        } else if (arg == "--chunk-size" && i + 1 < argc) {
+            // Every chunk has to fit the largest gRPC message --max-message-mb allows
+            if (!ParseSizeOption(arg, argv[++i], 1, 2047LL << 20, &clientOptions.chunkBytes)) {
+                return 1;
+            }
+        } else if (arg == "--max-message-mb" && i + 1 < argc) {
+            clientOptions.maxMessageMb = std::stoi(argv[++i]);
         } else if (arg == "--samples" && i + 1 < argc) {
             samplesPerSize = std::stoi(argv[++i]);
+        } else if (arg == "--mode" && i + 1 < argc) {
+            load.mode = argv[++i];
+        } else if (arg == "--rate" && i + 1 < argc) {
+            load.rateQps = std::stod(argv[++i]);
+        } else if (arg == "--arrival" && i + 1 < argc) {
+            load.arrival = argv[++i];
+        } else if (arg == "--max-inflight" && i + 1 < argc) {
+            load.maxInFlight = std::stoi(argv[++i]);
+        } else if (arg == "--transport" && i + 1 < argc) {
+            load.transport = argv[++i];
+        } else if (arg == "--window" && i + 1 < argc) {
+            load.window = std::stoi(argv[++i]);
+        } else if (arg == "--concurrency" && i + 1 < argc) {
+            std::stringstream levels(argv[++i]);
+            std::string level;
+            while (std::getline(levels, level, ',')) {
+                if (!level.empty()) {
+                    load.concurrency.push_back(std::stoi(level));
+                }
+            }
+        } else if (arg == "--reuse-buffers") {
+            clientOptions.reuseBuffers = true;
+        } else if (arg == "--codec" && i + 1 < argc) {
+            clientOptions.codec = argv[++i];
+        } else if (arg == "--channels-per-worker" && i + 1 < argc) {
+            clientOptions.channelsPerWorker = std::stoi(argv[++i]);
+        } else if (arg == "--channel-policy" && i + 1 < argc) {
+            clientOptions.channelPolicy = argv[++i];
+        } else if (arg == "--payload" && i + 1 < argc) {
+            payloadKind = argv[++i];
+        } else if (arg == "--compression" && i + 1 < argc) {
+            clientOptions.compression = argv[++i];
+        } else if (arg == "--compression-scope" && i + 1 < argc) {
+            clientOptions.compressionScope = argv[++i];
+        } else if (arg == "--results-format" && i + 1 < argc) {
+            clientOptions.resultsFormat = argv[++i];
+        } else if (arg == "--hedge-delay" && i + 1 < argc) {
+            clientOptions.hedgeDelay = argv[++i];
+        } else if (arg == "--clock-sync-ms" && i + 1 < argc) {
+            clientOptions.clockSyncMs = std::stoi(argv[++i]);
+        } else if (arg == "--shm-wait" && i + 1 < argc) {
+            std::string wait = argv[++i];
+            if (wait != "spin" && wait != "futex") {
+                std::cout << "Error: --shm-wait must be 'spin' or 'futex'" << std::endl;
+                return 1;
+            }
+            clientOptions.shmWait = wait == "spin" ? ShmWait::kSpin : ShmWait::kFutex;
+        } else if (arg == "--cpu-affinity" && i + 1 < argc) {
+            if (!ParseCpuList(argv[++i], &clientOptions.placement.cpus)) {
+                std::cout << "Error: --cpu-affinity takes a CPU list such as 0-3,8" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--numa-node" && i + 1 < argc) {
+            clientOptions.placement.numaNode = std::stoi(argv[++i]);
+        } else if (arg == "--tuning" && i + 1 < argc) {
+            if (!ParseTuningProfile(argv[++i], &clientOptions.tuning)) {
+                std::cout << "Error: --tuning must be 'default', 'low-latency' or 'throughput'" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--inprocess" && i + 1 < argc) {
+            inprocessWorkers = std::stoi(argv[++i]);
+        } else if (arg == "--inprocess-transport" && i + 1 < argc) {
+            clientOptions.inprocessTransport = argv[++i];
         } else if (arg == "--help") {
             std::cout << "Usage: " << argv[0] << " [options]\n"
                       << "Options:\n"
-                      << "  --pattern <direct|sequential|twohop>  Communication pattern (default: direct)\n"
+                      << "  --pattern <direct|sequential|twohop|tree|hedged|tied>\n"
+                      << "                                        Communication pattern (default: direct)\n"
                       << "  --workers <addr1,addr2,...>           Comma-separated worker addresses\n"
-                      << "  --min-size SIZE                       Minimum payload size in bytes (default: 16)\n"
+                      << "  --min-size SIZE                       Minimum payload size in bytes; sizes take K, M and G\n"
+                      << "                                        suffixes (default: 16)\n"
                       << "  --max-size SIZE                       Maximum payload size in bytes (default: 8192)\n"
                       << "  --increment SIZE                      Payload size increment in bytes (default: 16)\n"
+                      << "  --size-schedule <linear|log>          linear: add --increment; log: geometric sizes from\n"
+                      << "                                        --min-size to --max-size (default: linear)\n"
+                      << "  --sizes-per-octave N                  log: sizes per doubling (default: 1)\n"
+                      << "  --chunk-threshold SIZE                Unary payloads above this are uploaded as a client\n"
+                      << "                                        stream of chunks; 0 = never (default: 1M)\n"
+                      << "  --chunk-size SIZE                     Bytes per chunk (default: 1M)\n"
+                      << "  --max-message-mb MB                   gRPC message size limit in both directions, for\n"
+                      << "                                        unchunked payloads above 4 MB (default: gRPC's)\n"
                       << "  --samples COUNT                       Number of samples per payload size (default: 100)\n"
+                      << "  --mode <closedloop|openloop>          Load generation mode (default: closedloop)\n"
+                      << "  --rate QPS                            Open-loop offered rate in requests/sec (default: 1000)\n"
+                      << "  --arrival <poisson|constant>          Open-loop inter-arrival distribution (default: poisson)\n"
+                      << "  --max-inflight COUNT                  Open-loop cap on outstanding requests (default: 16384)\n"
+                      << "  --transport <unary|stream|shm|tcp>    unary: one RPC per request; stream: pipeline requests\n"
+                      << "                                        on one long-lived bidi stream per worker; shm: pipeline\n"
+                      << "                                        over shared-memory rings to co-located workers started\n"
+                      << "                                        with --shm; tcp: pipeline length-prefixed frames over raw\n"
+                      << "                                        TCP to workers started with --transport tcp (default: unary)\n"
+                      << "  --window COUNT                        Closed-loop requests kept outstanding (default: 1)\n"
+                      << "  --concurrency N1,N2,...               Closed-loop concurrency sweep: repeat the payload sweep\n"
+                      << "                                        with each number of requests in flight and report\n"
+                      << "                                        throughput-latency curves and their knee\n"
+                      << "  --reuse-buffers                       Send from pre-built per-size request templates and parse\n"
+                      << "                                        responses into stack Arenas instead of allocating per call\n"
+                      << "  --codec <proto|raw>                   proto: protobuf messages; raw: pre-serialized ByteBuffers\n"
+                      << "                                        through a GenericStub, responses never parsed (default: proto)\n"
+                      << "  --channels-per-worker N               Channels (TCP connections) per worker; calls, streams and\n"
+                      << "                                        shm/tcp pipes are spread across them (default: 1)\n"
+                      << "  --channel-policy <round-robin|least-outstanding>\n"
+                      << "                                        How a call picks its channel (default: round-robin)\n"
+                      << "  --shm-wait <spin|futex>               How shm readers wait for responses: spin keeps polling,\n"
+                      << "                                        futex sleeps after a short spin (default: futex)\n"
+                      << "  --payload KIND                        Payload content, generated once at startup: repeat ('X'\n"
+                      << "                                        repeated), random, text, protobuf, mixed, or file:PATH\n"
+                      << "                                        for the bytes of a sample file (default: repeat)\n"
+                      << "  --compression <none|deflate|gzip>     gRPC message compression for requests (default: none)\n"
+                      << "  --compression-scope <channel|call>    Set it as the channels' default or on every call's\n"
+                      << "                                        ClientContext (default: channel)\n"
+                      << "  --clock-sync-ms MS                    Interval of the background clock-offset probes behind\n"
+                      << "                                        the per-hop latency breakdown; 0 = estimate from the\n"
+                      << "                                        benchmark responses alone (default: 200)\n"
+                      << "  --results-format <csv|binary>         Per-sample results as CSV, or as a memory-mapped columnar\n"
+                      << "                                        .brlog for benchmarkAggregate (default: csv)\n"
+                      << "  --hedge-delay <MS|pNN|none>           hedged: send the backup after MS milliseconds, after\n"
+                      << "                                        the size's pNN latency so far, or never (default: p95)\n"
+                      << "  --cpu-affinity LIST                   Run on these CPUs, e.g. 0-3,8; the sender and the\n"
+                      << "                                        completion poller get the first two (default: any)\n"
+                      << "  --numa-node N                         Allocate memory on NUMA node N, and run on its CPUs\n"
+                      << "                                        unless --cpu-affinity is given (default: none)\n"
+                      << "  --tuning <default|low-latency|throughput>\n"
+                      << "                                        Named set of gRPC channel, socket and polling settings\n"
+                      << "                                        (default: default)\n"
+                      << "  --inprocess N                         Serve N workers inside this process instead of\n"
+                      << "                                        --workers: a chain for twohop, independent otherwise\n"
+                      << "  --inprocess-transport <channel|tcp>   channel: gRPC's in-process transport, no sockets;\n"
+                      << "                                        tcp: loopback TCP between them (default: channel)\n"
                       << "  --help                                Show this help\n"
                       << "\nPatterns:\n"
                       << "  direct:     head -> worker -> ack -> head\n"
                       << "  sequential: head -> worker1 -> ack -> head -> worker2 -> ack -> head\n"
                       << "  twohop:     head -> worker1 -> worker2 -> ack -> head\n"
+                      << "  tree:       head -> root -> children -> ... -> aggregated ack -> head (workers started\n"
+                      << "              with --forward-to child1,child2,...)\n"
+                      << "  hedged:     head -> worker i, and worker i+1 if i has not answered within the hedge\n"
+                      << "              delay -> first ack -> head, the other call cancelled\n"
+                      << "  tied:       head -> workers i and i+1 at once -> first ack -> head, the other cancelled\n"
                       << "\nExamples:\n"
                       << "  Direct:     " << argv[0] << " --pattern direct --workers localhost:50051\n"
                       << "  Sequential: " << argv[0] << " --pattern sequential --workers localhost:50051,localhost:50052\n"
                       << "  Two-hop:    " << argv[0] << " --pattern twohop --workers localhost:50051\n"
+                      << "  Tree:       " << argv[0] << " --pattern tree --workers localhost:50051\n"
+                      << "  Hedged:     " << argv[0] << " --pattern hedged --hedge-delay p95 --workers localhost:50051,localhost:50052\n"
+                      << "  Open-loop:  " << argv[0] << " --pattern direct --mode openloop --rate 5000 --workers localhost:50051\n"
+                      << "  Streaming:  " << argv[0] << " --pattern direct --transport stream --window 8 --workers localhost:50051\n"
+                      << "  Capacity:   " << argv[0] << " --pattern twohop --concurrency 1,2,4,8,16,32,64,128,256 --workers localhost:50051\n"
+                      << "  Shm:        " << argv[0] << " --pattern direct --transport shm --workers localhost:50051\n"
+                      << "  Raw TCP:    " << argv[0] << " --pattern direct --transport tcp --workers localhost:50051\n"
+                      << "  In-process: " << argv[0] << " --pattern twohop --inprocess 2\n"
                       << std::endl;
             return 0;
         }
     }
     
+    if (inprocessWorkers < 0 ||
+        (clientOptions.inprocessTransport != "channel" && clientOptions.inprocessTransport != "tcp")) {
+        std::cout << "Error: --inprocess must be >= 0 and --inprocess-transport 'channel' or 'tcp'" << std::endl;
+        return 1;
+    }
+
     // Default worker if none provided
     if (workerAddresses.empty()) {
         workerAddresses.push_back("localhost:50051");
     }
     
+    if (minSize < 0 || maxSize < minSize || (sizeSchedule != "linear" && sizeSchedule != "log") ||
+        (sizeSchedule == "linear" && increment <= 0) || (sizeSchedule == "log" && (minSize < 1 || sizesPerOctave < 1))) {
+        std::cout << "Error: need 0 <= --min-size <= --max-size, --size-schedule 'linear' with --increment > 0, or "
+                  << "'log' with --min-size >= 1 and --sizes-per-octave >= 1" << std::endl;
+        return 1;
+    }
+    SizeSchedule schedule = BuildSizeSchedule(minSize, maxSize, increment, sizeSchedule, sizesPerOctave);
+
+    if (clientOptions.chunkBytes == 0 || clientOptions.maxMessageMb < 0 || clientOptions.maxMessageMb > 2047) {
+        std::cout << "Error: --chunk-size must be > 0 and --max-message-mb between 0 and 2047" << std::endl;
+        return 1;
+    }
+
     // Validate pattern
-    if (pattern != "direct" && pattern != "sequential" && pattern != "twohop") {
-        std::cout << "Error: Invalid pattern. Must be 'direct', 'sequential', or 'twohop'" << std::endl;
+    if (pattern != "direct" && pattern != "sequential" && pattern != "twohop" && pattern != "tree" &&
+        pattern != "hedged" && pattern != "tied") {
+        std::cout << "Error: Invalid pattern. Must be 'direct', 'sequential', 'twohop', 'tree', 'hedged' or 'tied'"
+                  << std::endl;
+        return 1;
+    }
+
+    HedgeDelay hedgeDelay;
+    if (!ParseHedgeDelay(clientOptions.hedgeDelay, &hedgeDelay)) {
+        std::cout << "Error: --hedge-delay must be milliseconds >= 0, pNN with 0 < NN < 100, or 'none'" << std::endl;
+        return 1;
+    }
+
+    if (load.mode != "closedloop" && load.mode != "openloop") {
+        std::cout << "Error: Invalid mode. Must be 'closedloop' or 'openloop'" << std::endl;
+        return 1;
+    }
+
+    if (load.mode == "openloop" &&
+        (load.rateQps <= 0.0 || load.maxInFlight <= 0 || (load.arrival != "poisson" && load.arrival != "constant"))) {
+        std::cout << "Error: Open-loop mode needs --rate > 0, --max-inflight > 0 and --arrival poisson|constant" << std::endl;
+        return 1;
+    }
+
+    if ((load.transport != "unary" && load.transport != "stream" && load.transport != "shm" &&
+         load.transport != "tcp") || load.window <= 0) {
+        std::cout << "Error: --transport must be 'unary', 'stream', 'shm' or 'tcp' and --window must be > 0" << std::endl;
+        return 1;
+    }
+
+    if (!load.concurrency.empty() &&
+        (load.mode != "closedloop" ||
+         std::any_of(load.concurrency.begin(), load.concurrency.end(), [](int level) { return level <= 0; }))) {
+        std::cout << "Error: --concurrency needs closed-loop mode and levels > 0" << std::endl;
+        return 1;
+    }
+
+    if (clientOptions.channelsPerWorker <= 0 ||
+        (clientOptions.channelPolicy != "round-robin" && clientOptions.channelPolicy != "least-outstanding")) {
+        std::cout << "Error: --channels-per-worker must be > 0 and --channel-policy 'round-robin' or 'least-outstanding'"
+                  << std::endl;
+        return 1;
+    }
+
+    if (clientOptions.resultsFormat != "csv" && clientOptions.resultsFormat != "binary") {
+        std::cout << "Error: --results-format must be 'csv' or 'binary'" << std::endl;
+        return 1;
+    }
+
+    if (clientOptions.codec != "proto" && clientOptions.codec != "raw") {
+        std::cout << "Error: Invalid codec. Must be 'proto' or 'raw'" << std::endl;
+        return 1;
+    }
+
+    grpc_compression_algorithm compression;
+    if (!ParseCompression(clientOptions.compression, &compression) ||
+        (clientOptions.compressionScope != "channel" && clientOptions.compressionScope != "call")) {
+        std::cout << "Error: --compression must be 'none', 'deflate' or 'gzip' and --compression-scope 'channel' or 'call'"
+                  << std::endl;
+        return 1;
+    }
+
+    if (compression != GRPC_COMPRESS_NONE && (load.transport == "shm" || load.transport == "tcp")) {
+        std::cout << "Error: --compression applies to the gRPC transports (unary, stream) only" << std::endl;
+        return 1;
+    }
+
+    if (!PayloadGenerator::IsKnownKind(payloadKind)) {
+        std::cout << "Error: --payload must be 'repeat', 'random', 'text', 'protobuf', 'mixed' or 'file:PATH'"
+                  << std::endl;
+        return 1;
+    }
+    try {
+        // Warmup always sends 1 KB payloads
+        Payloads() = PayloadGenerator(payloadKind, static_cast<size_t>(std::max(maxSize, 1024)));
+    } catch (const std::exception& e) {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Tree workers multicast over gRPC only, and only whole requests
+    if (pattern == "tree") {
+        if (load.transport == "shm" || load.transport == "tcp") {
+            std::cout << "Error: --pattern tree runs over the unary or stream transport" << std::endl;
+            return 1;
+        }
+        clientOptions.chunkThresholdBytes = 0;
+    }
+
+    // In-process workers speak gRPC only, and form chains rather than trees
+    if (inprocessWorkers > 0) {
+        if (load.transport != "unary" && load.transport != "stream") {
+            std::cout << "Error: --inprocess runs over the unary or stream transport" << std::endl;
+            return 1;
+        }
+        if (pattern == "tree") {
+            std::cout << "Error: --pattern tree needs workers started with --forward-to; it has no --inprocess form"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    // Hedging decides per request when to send the backup, which only the
+    // one-request-at-a-time latency path does
+    if ((pattern == "hedged" || pattern == "tied") &&
+        (load.mode != "closedloop" || load.transport != "unary" || load.window != 1 || !load.concurrency.empty())) {
+        std::cout << "Error: --pattern " << pattern << " runs closed-loop over unary calls with --window 1 and no "
+                  << "--concurrency sweep" << std::endl;
+        return 1;
+    }
+
+    if (load.transport == "tcp" && static_cast<size_t>(maxSize) + 64 > kTcpMaxFrameBytes) {
+        std::cout << "Error: --transport tcp frames are limited to " << (kTcpMaxFrameBytes >> 20) << " MB" << std::endl;
+        return 1;
+    }
+
+    // Raw TCP workers speak no gRPC, so their clocks are estimated from the benchmark frames alone
+    if (load.transport == "tcp") {
+        clientOptions.clockSyncMs = 0;
+    }
+
+    // Raw responses are never parsed, so stream responses could not be matched to requests
+    if (clientOptions.codec == "raw" && load.transport != "unary") {
+        std::cout << "Error: --codec raw supports only --transport unary" << std::endl;
+        return 1;
+    }
+
+    // Before the first thread is started, so all of them inherit it
+    try {
+        ApplyCpuPlacement(clientOptions.placement);
+    } catch (const std::exception& e) {
+        std::cout << "Error: " << e.what() << std::endl;
         return 1;
     }
+    if (clientOptions.placement.Active()) {
+        PinThreadToCpu(0);
+    }
+    TcpBusyPollUs() = clientOptions.tuning.socketBusyPollUs;
+
+    // Outlives the head, whose clients hold channels into it
+    std::unique_ptr<InProcessCluster> cluster;
+    if (inprocessWorkers > 0) {
+        try {
+            cluster = std::make_unique<InProcessCluster>(inprocessWorkers, pattern == "twohop", clientOptions);
+        } catch (const std::exception& e) {
+            std::cout << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        clientOptions.inprocess = cluster.get();
+        workerAddresses = cluster->Addresses();
+    }
     
     std::cout << "Benchmark Head Node Starting..." << std::endl;
     std::cout << "Pattern: " << pattern << std::endl;
+    std::cout << "Mode: " << load.mode << " (" << load.transport << " transport)" << std::endl;
+    std::cout << "Codec: " << clientOptions.codec << std::endl;
+    std::cout << "Payload: " << payloadKind << " (" << std::fixed << std::setprecision(2)
+              << Payloads().EntropyBitsPerByte() << " bits/byte)" << std::endl;
+    std::cout << "Compression: " << clientOptions.compression;
+    if (compression != GRPC_COMPRESS_NONE) {
+        std::cout << " (per " << clientOptions.compressionScope << ")";
+        if (payloadKind == "repeat") {
+            std::cout << " - note: 'repeat' payloads compress to almost nothing, use --payload for realistic data";
+        }
+    }
+    std::cout << std::endl;
+    std::cout << "Channels per worker: " << clientOptions.channelsPerWorker << " (" << clientOptions.channelPolicy
+              << ")" << std::endl;
+    std::cout << "Buffers: " << (clientOptions.reuseBuffers ? "reused" : "allocated per request") << std::endl;
+    std::cout << "CPU placement: " << DescribePlacement(clientOptions.placement) << std::endl;
+    std::cout << "Tuning: " << clientOptions.tuning.Describe() << std::endl;
+    if (cluster) {
+        std::cout << "In-process workers: " << inprocessWorkers << " over " << clientOptions.inprocessTransport
+                  << (pattern == "twohop" ? ", chained" : "") << std::endl;
+    }
     std::cout << "Workers: ";
     for (size_t i = 0; i < workerAddresses.size(); ++i) {
         std::cout << workerAddresses[i];
@@ -377,16 +3150,35 @@ int main(int argc, char** argv) {
     }
     std::cout << std::endl;
     std::cout << "Payload size range: " << minSize << " - " << maxSize << " bytes" << std::endl;
-    std::cout << "Increment: " << increment << " bytes" << std::endl;
+    std::cout << "Size schedule: " << sizeSchedule << ", " << schedule.sizes.size() << " sizes ("
+              << schedule.description << ")" << std::endl;
     std::cout << "Samples per size: " << samplesPerSize << std::endl;
+    if (load.transport == "unary" && clientOptions.codec == "proto" && clientOptions.chunkThresholdBytes > 0 &&
+        static_cast<size_t>(maxSize) > clientOptions.chunkThresholdBytes) {
+        std::cout << "Chunked uploads: payloads above " << clientOptions.chunkThresholdBytes << " bytes in "
+                  << clientOptions.chunkBytes << "-byte chunks" << std::endl;
+    } else if (maxSize > (4 << 20) - 1024 && clientOptions.maxMessageMb == 0) {
+        std::cout << "Note: payloads near or above 4 MB exceed gRPC's default message limit; start the workers "
+                  << "with --max-message-mb, or use unary chunked uploads" << std::endl;
+    }
 
     try {
-        BenchmarkHead head(workerAddresses, pattern);
+        BenchmarkHead head(workerAddresses, pattern, clientOptions);
         
-        // Wait a moment for connections to establish
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        // Wait a moment for connections to establish; in-process workers are serving already
+        if (!cluster) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        }
         
-        head.RunLatencyBenchmark(minSize, maxSize, increment, samplesPerSize);
+        // Plain closed-loop unary runs keep the original one-request-at-a-time
+        // path so their results stay comparable with earlier sweeps
+        if (!load.concurrency.empty()) {
+            head.RunConcurrencySweep(schedule, samplesPerSize, load);
+        } else if (load.mode == "closedloop" && load.transport == "unary" && load.window == 1) {
+            head.RunLatencyBenchmark(schedule, samplesPerSize);
+        } else {
+            head.RunLoadBenchmark(schedule, samplesPerSize, load);
+        }
         
         std::cout << "\nBenchmark completed successfully!" << std::endl;
         return 0;
@@ -0,0 +1,621 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/generic/generic_stub.h>
+#include "build/benchmark.pb.h"
+#include "build/benchmark.grpc.pb.h"
+#include "src/clockSync.h"
+#include "src/serviceTime.h"
+#include "src/tuningProfile.h"
+#include "src/workerStats.h"
+
+// The worker's request handling: the forwarding and multicast clients, the
+// BenchmarkCore state every server engine shares, and the synchronous engine.
+// benchmarkWorker serves it over the network; benchmarkHead --inprocess runs
+// a chain of them inside the head process.
+
+// A BenchmarkService method's path as generic stubs and services see it, built
+// from the generated service's name so it cannot drift from the proto
+inline std::string BenchmarkMethodPath(const char* method) {
+    return std::string("/") + benchmark::BenchmarkService::service_full_name() + "/" + method;
+}
+
+class ForwardingClient {
+public:
+    ForwardingClient(std::shared_ptr<grpc::Channel> channel)
+        : stub_(benchmark::BenchmarkService::NewStub(channel)), genericStub_(channel) {}
+
+    // The next worker's answer is parsed straight into response
+    void ForwardRequest(const benchmark::BenchmarkRequest& request, benchmark::BenchmarkResponse* response) {
+        grpc::ClientContext context;
+
+        // Set timeout for the request
+        std::chrono::system_clock::time_point deadline =
+            std::chrono::system_clock::now() + std::chrono::seconds(30);
+        context.set_deadline(deadline);
+
+        grpc::Status status = stub_->ProcessBenchmark(&context, request, response);
+
+        if (!status.ok()) {
+            response->set_success(false);
+        }
+    }
+
+    benchmark::BenchmarkService::Stub* stub() { return stub_.get(); }
+    grpc::GenericStub* genericStub() { return &genericStub_; }
+
+private:
+    std::unique_ptr<benchmark::BenchmarkService::Stub> stub_;
+    grpc::GenericStub genericStub_;
+};
+
+// Tree pattern: a worker given several --forward-to children sends every
+// request to all of them at once with the callback stub API and answers its
+// parent with one aggregated acknowledgement once the last child has replied.
+// The aggregate keeps the hops of the slowest child, so the head's breakdown
+// follows the critical path, and adds up the children's treeWorkers so the
+// head can tell whether the whole subtree was reached.
+class TreeMulticast {
+public:
+    // Receives the aggregated response; the caller adds its own hop
+    using Done = std::function<void(benchmark::BenchmarkResponse*)>;
+
+    explicit TreeMulticast(const std::vector<std::shared_ptr<grpc::Channel>>& channels) {
+        for (const auto& channel : channels) {
+            stubs_.push_back(benchmark::BenchmarkService::NewStub(channel));
+        }
+    }
+
+    size_t Fanout() const { return stubs_.size(); }
+
+    // done runs on a gRPC callback thread; request must stay valid until then.
+    void Send(const benchmark::BenchmarkRequest& request, Done done) {
+        auto* call = new Call(stubs_.size(), std::move(done));
+        auto deadline = std::chrono::system_clock::now() + std::chrono::seconds(30);
+        for (size_t i = 0; i < stubs_.size(); ++i) {
+            Leg& leg = call->legs[i];
+            leg.context.set_deadline(deadline);
+            stubs_[i]->async()->ProcessBenchmark(&leg.context, &request, &leg.response,
+                                                 [call, &leg](grpc::Status status) {
+                leg.ok = status.ok() && leg.response.success();
+                leg.doneNs = WallClockNs();
+                if (call->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    Aggregate(call);
+                }
+            });
+        }
+    }
+
+    // Blocking form for the sync engine.
+    benchmark::BenchmarkResponse SendAndWait(const benchmark::BenchmarkRequest& request) {
+        std::promise<benchmark::BenchmarkResponse> aggregated;
+        Send(request, [&aggregated](benchmark::BenchmarkResponse* response) {
+            aggregated.set_value(std::move(*response));
+        });
+        return aggregated.get_future().get();
+    }
+
+private:
+    struct Leg {
+        grpc::ClientContext context;
+        benchmark::BenchmarkResponse response;
+        bool ok = false;
+        int64_t doneNs = 0;
+    };
+
+    struct Call {
+        Call(size_t fanout, Done done) : legs(fanout), pending(fanout), done(std::move(done)) {}
+        std::vector<Leg> legs;
+        std::atomic<size_t> pending;
+        Done done;
+    };
+
+    static void Aggregate(Call* call) {
+        bool success = true;
+        int32_t workers = 1;
+        int32_t fanout = static_cast<int32_t>(call->legs.size());
+        Leg* slowest = nullptr;
+        for (Leg& leg : call->legs) {
+            success = success && leg.ok;
+            if (!leg.ok) {
+                continue;
+            }
+            workers += leg.response.treeworkers();
+            fanout = std::max(fanout, leg.response.treefanout());
+            if (slowest == nullptr || leg.doneNs >= slowest->doneNs) {
+                slowest = &leg;
+            }
+        }
+        benchmark::BenchmarkResponse& response = (slowest != nullptr ? slowest : &call->legs[0])->response;
+        response.set_success(success);
+        response.set_treeworkers(workers);
+        response.set_treefanout(fanout);
+        call->done(&response);
+        delete call;
+    }
+
+    std::vector<std::unique_ptr<benchmark::BenchmarkService::Stub>> stubs_;
+};
+
+// Request/response pairs recycled by --reuse-buffers. A recycled request keeps
+// the payload capacity of its previous use, so parsing a payload of the same
+// size needs no allocation, and a recycled response keeps its acknowledgement.
+class MessagePool {
+public:
+    struct Messages {
+        benchmark::BenchmarkRequest request;
+        benchmark::BenchmarkResponse response;
+    };
+
+    std::unique_ptr<Messages> Acquire() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.empty()) {
+            return std::make_unique<Messages>();
+        }
+        auto messages = std::move(free_.back());
+        free_.pop_back();
+        return messages;
+    }
+
+    void Recycle(std::unique_ptr<Messages> messages) {
+        messages->request.Clear();
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(std::move(messages));
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Messages>> free_;
+};
+
+inline constexpr char kNoChunkedMulticast[] =
+    "tree workers take whole requests only; chunked uploads are not multicast";
+
+// State and per-request work shared by the sync, callback and async server engines.
+class BenchmarkCore {
+public:
+    BenchmarkCore(const std::string& nextWorkerAddress = "", bool reuseBuffers = false,
+                  grpc_compression_algorithm forwardCompression = GRPC_COMPRESS_NONE, int maxMessageMb = 0,
+                  const TuningProfile& tuning = TuningProfile())
+        : nextWorkerAddress_(nextWorkerAddress) {
+        if (reuseBuffers) {
+            messagePool_ = std::make_unique<MessagePool>();
+        }
+
+        // Pre-generate 512-byte acknowledgement data
+        ackData_.resize(512);
+        for (int i = 0; i < 512; ++i) {
+            ackData_[i] = static_cast<char>('A' + (i % 26));
+        }
+
+        // The same acknowledgement serialized once for the raw codec
+        benchmark::BenchmarkResponse rawAck;
+        rawAck.set_acknowledgement(ackData_);
+        rawAck.set_success(true);
+        grpc::Slice slice(rawAck.SerializeAsString());
+        rawAck_ = grpc::ByteBuffer(&slice, 1);
+
+        // If we have a next worker, create a client for forwarding, or with
+        // several children one for multicasting. Requests arrive decompressed
+        // and are compressed again for the next worker.
+        grpc::ChannelArguments args;
+        tuning.Apply(&args);
+        if (forwardCompression != GRPC_COMPRESS_NONE) {
+            args.SetCompressionAlgorithm(forwardCompression);
+        }
+        if (maxMessageMb > 0) {
+            args.SetMaxReceiveMessageSize(maxMessageMb * 1024 * 1024);
+            args.SetMaxSendMessageSize(maxMessageMb * 1024 * 1024);
+        }
+        std::vector<std::string> children = SplitAddresses(nextWorkerAddress_);
+        if (children.size() == 1) {
+            auto channel = grpc::CreateCustomChannel(children[0], grpc::InsecureChannelCredentials(), args);
+            forwardingClient_ = std::make_unique<ForwardingClient>(channel);
+            std::cout << "Worker configured to forward to: " << nextWorkerAddress_ << std::endl;
+        } else if (children.size() > 1) {
+            std::vector<std::shared_ptr<grpc::Channel>> channels;
+            for (const auto& child : children) {
+                channels.push_back(grpc::CreateCustomChannel(child, grpc::InsecureChannelCredentials(), args));
+            }
+            multicast_ = std::make_unique<TreeMulticast>(channels);
+            std::cout << "Worker configured to multicast to " << children.size() << " children: "
+                      << nextWorkerAddress_ << std::endl;
+        }
+    }
+
+    static std::vector<std::string> SplitAddresses(const std::string& list) {
+        std::vector<std::string> addresses;
+        std::stringstream stream(list);
+        std::string address;
+        while (std::getline(stream, address, ',')) {
+            if (!address.empty()) {
+                addresses.push_back(address);
+            }
+        }
+        return addresses;
+    }
+
+    // Relays to the worker behind channel instead of a --forward-to address;
+    // name is only used in log lines. For chains built inside one process.
+    void ForwardThrough(std::shared_ptr<grpc::Channel> channel, const std::string& name) {
+        nextWorkerAddress_ = name;
+        forwardingClient_ = std::make_unique<ForwardingClient>(channel);
+    }
+
+    // For a server that relays over its own transport, as --transport tcp
+    // does: names the next worker in log lines without opening a channel to it
+    void NameForwardTarget(const std::string& name) { nextWorkerAddress_ = name; }
+
+    // Progress lines every 100 requests; off when the worker shares the head's stdout
+    void SetProgressLog(bool enabled) { progressLog_ = enabled; }
+
+    // Relays to a single next worker; a multicasting worker is not "forwarding"
+    bool IsForwarding() const { return forwardingClient_ != nullptr; }
+    ForwardingClient* forwardingClient() { return forwardingClient_.get(); }
+    bool IsMulticasting() const { return multicast_ != nullptr; }
+    TreeMulticast* multicast() { return multicast_.get(); }
+
+    // --delay-ms: a fraction of the unary requests answered by this worker are
+    // held for delayMs first, a local stand-in for a slow or overloaded replica
+    void InjectDelay(double delayMs, double fraction) {
+        delayNs_ = static_cast<int64_t>(delayMs * 1e6);
+        delayFraction_ = fraction;
+    }
+
+    // How long to hold the next request; 0 for most
+    int64_t NextDelayNs() const {
+        if (delayNs_ == 0) {
+            return 0;
+        }
+        thread_local std::mt19937_64 rng(std::random_device{}());
+        return std::uniform_real_distribution<double>(0.0, 1.0)(rng) < delayFraction_ ? delayNs_ : 0;
+    }
+
+    // --service-time: work done by the worker that answers, before it answers
+    void EmulateServiceTime(const ServiceTime& model) { serviceTime_ = model; }
+
+    // Holds the calling thread for the request's drawn service time
+    void Serve(size_t payloadBytes) {
+        if (!serviceTime_.Active()) {
+            return;
+        }
+        int64_t serviceNs = serviceTime_.SampleNs(payloadBytes);
+        serviceTime_.Perform(serviceNs);
+        stats_.Record(Stage::kService, serviceNs);
+    }
+
+    MessagePool* messagePool() { return messagePool_.get(); }
+    const grpc::ByteBuffer& rawAck() const { return rawAck_; }
+
+    // The last worker of a chain answers the request and starts the hop list
+    // with its own receive and send times.
+    void FillResponse(const benchmark::BenchmarkRequest& request, benchmark::BenchmarkResponse* response) {
+        int64_t receiveTime = WallClockNs();
+        FillResponse(request.requestid(), request.timestamp(), request.payload().size(), receiveTime, response);
+    }
+
+    // Chunked requests are answered from what their chunks said, with the
+    // arrival of the first chunk as the receive time.
+    void FillResponse(int32_t requestId, int64_t requestTimestamp, size_t payloadBytes, int64_t receiveTime,
+                      benchmark::BenchmarkResponse* response) {
+        // The head's clock probes carry negative ids and are answered at once
+        if (requestId >= 0) {
+            Serve(payloadBytes);
+        }
+        response->set_requestid(requestId);
+        // A recycled response still holds the acknowledgement from its last use
+        if (response->acknowledgement().size() != ackData_.size()) {
+            response->set_acknowledgement(ackData_);
+        }
+        response->set_requesttimestamp(requestTimestamp);
+        response->set_success(true);
+        response->set_treeworkers(1);
+        response->set_treefanout(0);
+
+        response->clear_hops();
+        benchmark::HopTimestamps* hop = response->add_hops();
+        hop->set_receivetimestamp(receiveTime);
+        int64_t sendTime = WallClockNs();
+        hop->set_sendtimestamp(sendTime);
+        response->set_responsetimestamp(sendTime);
+
+        // The head's clock probes carry negative ids and are not counted
+        if (requestId >= 0) {
+            if (requestTimestamp > 0) {
+                stats_.Record(Stage::kArrival, receiveTime - requestTimestamp);
+            }
+            stats_.Record(Stage::kHandler, sendTime - receiveTime);
+            stats_.CountAnswered();
+        }
+
+        if (progressLog_ && requestId % 100 == 0) {
+            log_.Printf("Worker processed request %d with payload size: %zu bytes", requestId, payloadBytes);
+        }
+    }
+
+    // A forwarding worker adds its hop to the next worker's response on the way back.
+    // The response echoes the head's request timestamp, which gives the arrival stage.
+    void AppendForwardHop(benchmark::BenchmarkResponse* response, int64_t receiveTime, int64_t forwardSendTime,
+                          int64_t forwardReceiveTime) {
+        benchmark::HopTimestamps* hop = response->add_hops();
+        hop->set_receivetimestamp(receiveTime);
+        hop->set_forwardsendtimestamp(forwardSendTime);
+        hop->set_forwardreceivetimestamp(forwardReceiveTime);
+        int64_t sendTime = WallClockNs();
+        hop->set_sendtimestamp(sendTime);
+
+        if (response->requesttimestamp() > 0) {
+            stats_.Record(Stage::kArrival, receiveTime - response->requesttimestamp());
+        }
+        stats_.Record(Stage::kHandler, sendTime - receiveTime);
+        stats_.Record(Stage::kForward, forwardReceiveTime - forwardSendTime);
+        stats_.CountForwarded();
+    }
+
+    void NoteForwarded(const benchmark::BenchmarkRequest& request) { NoteForwarded(request.requestid()); }
+
+    void NoteForwarded(int32_t requestId) {
+        if (progressLog_ && requestId % 100 == 0) {
+            log_.Printf("Worker forwarded request %d to %s", requestId, nextWorkerAddress_.c_str());
+        }
+    }
+
+    // Passthrough forwarding never parses the request, so progress is logged by count
+    void NoteForwardedCall(uint64_t completed) {
+        if (progressLog_ && completed % 100 == 0) {
+            log_.Printf("Worker forwarded %llu calls to %s", static_cast<unsigned long long>(completed),
+                        nextWorkerAddress_.c_str());
+        }
+    }
+
+    // Raw calls are never parsed either, so they are also logged by count; the
+    // handler stage starts once the whole request has been read
+    void NoteRawCall(uint64_t completed, int64_t receiveTime, bool forwarded) {
+        stats_.Record(Stage::kHandler, WallClockNs() - receiveTime);
+        if (forwarded) {
+            stats_.CountForwarded();
+        } else {
+            stats_.CountAnswered();
+        }
+        if (progressLog_ && completed % 100 == 0) {
+            log_.Printf("Worker answered %llu raw calls", static_cast<unsigned long long>(completed));
+        }
+    }
+
+    // GetStats' path, which the generic engines answer themselves
+    static const std::string& GetStatsMethod() {
+        static const std::string method = BenchmarkMethodPath("GetStats");
+        return method;
+    }
+
+    // GetStats on every engine
+    void FillStats(bool reset, benchmark::WorkerStatsSnapshot* out) {
+        auto snapshot = std::make_unique<StatsSnapshot>();
+        stats_.Snapshot(snapshot.get(), reset);
+        out->set_requests(snapshot->answered);
+        out->set_forwarded(snapshot->forwarded);
+        out->set_intervalsec(snapshot->intervalSec);
+        out->set_logdropped(log_.Dropped());
+        out->set_threads(static_cast<uint32_t>(snapshot->threads));
+        for (size_t i = 0; i < kStageCount; ++i) {
+            const LatencyHistogram& histogram = snapshot->stages[i];
+            benchmark::StageStats* stage = out->add_stages();
+            stage->set_stage(StageName(static_cast<Stage>(i)));
+            stage->set_count(histogram.TotalCount());
+            stage->set_meanus(histogram.MeanNs() / 1e3);
+            stage->set_p50us(histogram.ValueAtPercentile(50.0) / 1e3);
+            stage->set_p90us(histogram.ValueAtPercentile(90.0) / 1e3);
+            stage->set_p99us(histogram.ValueAtPercentile(99.0) / 1e3);
+            stage->set_maxus(histogram.MaxNs() / 1e3);
+        }
+    }
+
+    // The generic services (raw codec, passthrough forwarding) see GetStats as bytes
+    grpc::Status FillStats(grpc::ByteBuffer* request, grpc::ByteBuffer* response) {
+        benchmark::StatsRequest statsRequest;
+        if (!grpc::SerializationTraits<benchmark::StatsRequest>::Deserialize(request, &statsRequest).ok()) {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "malformed StatsRequest");
+        }
+        benchmark::WorkerStatsSnapshot snapshot;
+        FillStats(statsRequest.reset(), &snapshot);
+        bool ownBuffer;
+        return grpc::SerializationTraits<benchmark::WorkerStatsSnapshot>::Serialize(snapshot, response, &ownBuffer);
+    }
+
+    // --stats-file: everything since the worker started, unaffected by GetStats resets
+    void WriteStatsText(std::ostream& out) {
+        auto snapshot = std::make_unique<StatsSnapshot>();
+        stats_.Cumulative(snapshot.get());
+        WorkerStats::WriteText(out, *snapshot, log_.Dropped());
+    }
+
+    uint64_t CountCompleted() { return completed_.fetch_add(1, std::memory_order_relaxed) + 1; }
+    uint64_t Completed() const { return completed_.load(std::memory_order_relaxed); }
+
+private:
+    std::string ackData_;
+    grpc::ByteBuffer rawAck_;
+    std::string nextWorkerAddress_;
+    std::unique_ptr<ForwardingClient> forwardingClient_;
+    std::unique_ptr<TreeMulticast> multicast_;
+    std::unique_ptr<MessagePool> messagePool_;
+    std::atomic<uint64_t> completed_{0};
+    int64_t delayNs_ = 0;
+    double delayFraction_ = 1.0;
+    bool progressLog_ = true;
+    ServiceTime serviceTime_;
+    WorkerStats stats_;
+    AsyncLog log_;
+};
+
+// Callback-engine message allocator for --reuse-buffers: each unary call gets
+// a pair from the core's MessagePool and hands it back when gRPC releases it.
+class RecyclingMessageAllocator final
+    : public grpc::MessageAllocator<benchmark::BenchmarkRequest, benchmark::BenchmarkResponse> {
+public:
+    explicit RecyclingMessageAllocator(MessagePool* pool) : pool_(pool) {}
+
+    grpc::MessageHolder<benchmark::BenchmarkRequest, benchmark::BenchmarkResponse>* AllocateMessages() override {
+        return new Holder(pool_, pool_->Acquire());
+    }
+
+private:
+    class Holder : public grpc::MessageHolder<benchmark::BenchmarkRequest, benchmark::BenchmarkResponse> {
+    public:
+        Holder(MessagePool* pool, std::unique_ptr<MessagePool::Messages> messages)
+            : pool_(pool), messages_(std::move(messages)) {
+            set_request(&messages_->request);
+            set_response(&messages_->response);
+        }
+
+        void Release() override {
+            pool_->Recycle(std::move(messages_));
+            delete this;
+        }
+
+    private:
+        MessagePool* pool_;
+        std::unique_ptr<MessagePool::Messages> messages_;
+    };
+
+    MessagePool* pool_;
+};
+
+// Synchronous engine: gRPC's sync thread pool runs the handler, and a forwarding
+// worker holds that thread for the whole downstream RPC.
+class BenchmarkServiceImpl final : public benchmark::BenchmarkService::Service {
+public:
+    BenchmarkServiceImpl(BenchmarkCore& core) : core_(core) {}
+
+    grpc::Status ProcessBenchmark(grpc::ServerContext* /*context*/, const benchmark::BenchmarkRequest* request,
+                                  benchmark::BenchmarkResponse* response) override {
+        // If this worker should forward to another worker (two-hop pattern)
+        if (core_.IsForwarding()) {
+            // Forward the request as received; the final worker's answer lands in response
+            int64_t receiveTime = WallClockNs();
+            int64_t forwardSendTime = WallClockNs();
+            core_.forwardingClient()->ForwardRequest(*request, response);
+            int64_t forwardReceiveTime = WallClockNs();
+
+            core_.AppendForwardHop(response, receiveTime, forwardSendTime, forwardReceiveTime);
+            core_.NoteForwarded(*request);
+        } else if (core_.IsMulticasting()) {
+            // Tree pattern: this thread waits for every child
+            int64_t receiveTime = WallClockNs();
+            *response = core_.multicast()->SendAndWait(*request);
+            core_.AppendForwardHop(response, receiveTime, receiveTime, WallClockNs());
+            core_.NoteForwarded(*request);
+        } else {
+            // Normal processing - this is the final worker
+            int64_t receiveTime = WallClockNs();
+            int64_t delayNs = core_.NextDelayNs();
+            if (delayNs > 0) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(delayNs));
+            }
+            core_.FillResponse(request->requestid(), request->timestamp(), request->payload().size(), receiveTime,
+                               response);
+        }
+
+        core_.CountCompleted();
+        return grpc::Status::OK;
+    }
+
+    // Responses are written in request order; a forwarding worker relays each
+    // message as its own unary call to the next worker.
+    grpc::Status ProcessBenchmarkStream(
+        grpc::ServerContext* /*context*/,
+        grpc::ServerReaderWriter<benchmark::BenchmarkResponse, benchmark::BenchmarkRequest>* stream) override {
+        benchmark::BenchmarkRequest request;
+        benchmark::BenchmarkResponse response;
+        while (stream->Read(&request)) {
+            if (core_.IsForwarding()) {
+                int64_t receiveTime = WallClockNs();
+                response.Clear();
+                core_.forwardingClient()->ForwardRequest(request, &response);
+                core_.AppendForwardHop(&response, receiveTime, receiveTime, WallClockNs());
+                core_.NoteForwarded(request);
+            } else if (core_.IsMulticasting()) {
+                int64_t receiveTime = WallClockNs();
+                response = core_.multicast()->SendAndWait(request);
+                core_.AppendForwardHop(&response, receiveTime, receiveTime, WallClockNs());
+                core_.NoteForwarded(request);
+            } else {
+                core_.FillResponse(request, &response);
+            }
+
+            core_.CountCompleted();
+            if (!stream->Write(response)) {
+                break;
+            }
+        }
+        return grpc::Status::OK;
+    }
+
+    // Chunks are counted as they arrive and never reassembled; a forwarding
+    // worker writes each chunk to the next worker before reading the next one,
+    // so it holds one chunk at a time however large the request.
+    grpc::Status ProcessBenchmarkChunked(grpc::ServerContext* /*context*/,
+                                         grpc::ServerReader<benchmark::BenchmarkChunk>* reader,
+                                         benchmark::BenchmarkResponse* response) override {
+        if (core_.IsMulticasting()) {
+            return grpc::Status(grpc::StatusCode::UNIMPLEMENTED, kNoChunkedMulticast);
+        }
+        benchmark::BenchmarkChunk chunk;
+        if (!reader->Read(&chunk)) {
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "chunked request without chunks");
+        }
+        int64_t receiveTime = WallClockNs();
+        int32_t requestId = chunk.requestid();
+
+        if (core_.IsForwarding()) {
+            grpc::ClientContext forwardContext;
+            forwardContext.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(30));
+            int64_t forwardSendTime = WallClockNs();
+            auto writer = core_.forwardingClient()->stub()->ProcessBenchmarkChunked(&forwardContext, response);
+            bool relayed = writer->Write(chunk);
+            while (relayed && reader->Read(&chunk)) {
+                relayed = writer->Write(chunk);
+            }
+            writer->WritesDone();
+            if (!writer->Finish().ok()) {
+                response->set_success(false);
+            }
+            core_.AppendForwardHop(response, receiveTime, forwardSendTime, WallClockNs());
+            core_.NoteForwarded(requestId);
+        } else {
+            int64_t timestamp = chunk.timestamp();
+            int64_t totalSize = chunk.totalsize();
+            size_t bytes = chunk.data().size();
+            while (reader->Read(&chunk)) {
+                bytes += chunk.data().size();
+            }
+            core_.FillResponse(requestId, timestamp, bytes, receiveTime, response);
+            response->set_success(static_cast<int64_t>(bytes) == totalSize);
+        }
+
+        core_.CountCompleted();
+        return grpc::Status::OK;
+    }
+
+    grpc::Status GetStats(grpc::ServerContext* /*context*/, const benchmark::StatsRequest* request,
+                          benchmark::WorkerStatsSnapshot* response) override {
+        core_.FillStats(request->reset(), response);
+        return grpc::Status::OK;
+    }
+
+private:
+    BenchmarkCore& core_;
+};
@@ -3,162 +3,2257 @@
 #include <string>
 #include <vector>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
 
 #include <grpcpp/grpcpp.h>
+#include <grpcpp/alarm.h>
+#include <grpcpp/generic/async_generic_service.h>
+#include <grpcpp/generic/generic_stub.h>
 #include "build/benchmark.pb.h"
 #include "build/benchmark.grpc.pb.h"
+#include "src/allocationCounter.h"
+#include "src/benchmarkService.h"
+#include "src/clockSync.h"
+#include "src/cpuPlacement.h"
+#include "src/cpuTime.h"
+#include "src/serviceTime.h"
+#include "src/shmTransport.h"
+#include "src/tcpTransport.h"
+#include "src/tuningProfile.h"
+#include "src/workerStats.h"
 
+using grpc::ByteBuffer;
 using grpc::Channel;
+using grpc::ClientAsyncResponseReader;
 using grpc::ClientContext;
 using grpc::Server;
+using grpc::ClientAsyncWriter;
+using grpc::ServerAsyncReader;
+using grpc::ServerAsyncReaderWriter;
+using grpc::ServerAsyncResponseWriter;
 using grpc::ServerBuilder;
+using grpc::ServerCompletionQueue;
 using grpc::ServerContext;
 using grpc::Status;
 using benchmark::BenchmarkService;
+using benchmark::BenchmarkChunk;
 using benchmark::BenchmarkRequest;
 using benchmark::BenchmarkResponse;
+using benchmark::HopTimestamps;
+
+struct WorkerOptions {
+    std::string port = "50051";
+    std::string nextWorkerAddress;    // one address relays (twohop); several multicast (tree)
+    std::string serverMode = "sync";  // sync | callback | async
+    std::string forwardEngine = "passthrough";  // passthrough | copy
+    int threads = 0;                  // 0 = gRPC default (sync) / hardware concurrency (async)
+    bool pinCpus = false;
+    CpuPlacement placement;           // --cpu-affinity / --numa-node
+    TuningProfile tuning;
+    int reportIntervalSec = 0;
+    bool reuseBuffers = false;
+    std::string codec = "proto";      // proto | raw
+    bool shm = false;
+    ShmWait shmWait = ShmWait::kFutex;
+    size_t shmRingBytes = kShmDefaultRingBytes;
+    std::string transport = "grpc";   // grpc | tcp
+    std::string tcpBackend = "epoll"; // epoll | uring
+    size_t tcpBufferBytes = 256 * 1024;
+    grpc_compression_algorithm compression = GRPC_COMPRESS_NONE;  // responses and forwarded requests
+    int maxMessageMb = 0;             // gRPC message size limit in both directions; 0 = gRPC default (4 MB receive)
+    double delayMs = 0.0;             // injected at the last worker, for delayFraction of unary requests
+    double delayFraction = 1.0;
+    ServiceTime serviceTime;          // emulated work before answering; see src/serviceTime.h
+    std::string statsFile;            // periodic text dump of the worker's stats; empty = none
+    int statsIntervalSec = 10;
+};
 
-class ForwardingClient {
+// Callback stream: read -> (forward) -> write -> read, one message at a time.
+class CallbackStreamReactor : public grpc::ServerBidiReactor<BenchmarkRequest, BenchmarkResponse> {
 public:
-    ForwardingClient(std::shared_ptr<Channel> channel)
-        : stub_(BenchmarkService::NewStub(channel)) {}
+    CallbackStreamReactor(BenchmarkCore& core) : core_(core) { StartRead(&request_); }
 
-    BenchmarkResponse ForwardRequest(const BenchmarkRequest& request) {
-        BenchmarkResponse response;
-        ClientContext context;
+    void OnReadDone(bool ok) override {
+        if (!ok) {
+            Finish(Status::OK);
+            return;
+        }
+        if (core_.IsMulticasting()) {
+            receiveTime_ = WallClockNs();
+            core_.multicast()->Send(request_, [this](BenchmarkResponse* aggregated) {
+                response_ = std::move(*aggregated);
+                core_.AppendForwardHop(&response_, receiveTime_, receiveTime_, WallClockNs());
+                core_.NoteForwarded(request_);
+                StartWrite(&response_);
+            });
+            return;
+        }
+        if (!core_.IsForwarding()) {
+            core_.FillResponse(request_, &response_);
+            StartWrite(&response_);
+            return;
+        }
+
+        receiveTime_ = WallClockNs();
+        response_.Clear();
+        forwardContext_ = std::make_unique<ClientContext>();
+        forwardContext_->set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(30));
+        core_.forwardingClient()->stub()->async()->ProcessBenchmark(
+            forwardContext_.get(), &request_, &response_,
+            [this](Status status) {
+                if (!status.ok()) {
+                    response_.set_success(false);
+                }
+                core_.AppendForwardHop(&response_, receiveTime_, receiveTime_, WallClockNs());
+                core_.NoteForwarded(request_);
+                StartWrite(&response_);
+            });
+    }
+
+    void OnWriteDone(bool ok) override {
+        core_.CountCompleted();
+        if (ok) {
+            StartRead(&request_);
+        } else {
+            Finish(Status::OK);
+        }
+    }
+
+    void OnDone() override { delete this; }
 
-        // Set timeout for the request
-        std::chrono::system_clock::time_point deadline =
-            std::chrono::system_clock::now() + std::chrono::seconds(30);
-        context.set_deadline(deadline);
+private:
+    BenchmarkCore& core_;
+    BenchmarkRequest request_;
+    BenchmarkResponse response_;
+    std::unique_ptr<ClientContext> forwardContext_;
+    int64_t receiveTime_ = 0;
+};
+
+// Callback chunked upload: read -> (relay downstream) -> read, one chunk in
+// flight at a time. A forwarding worker opens the downstream upload on the
+// first chunk and finishes the upstream call from the downstream completion.
+class CallbackChunkedReactor : public grpc::ServerReadReactor<BenchmarkChunk> {
+public:
+    CallbackChunkedReactor(BenchmarkCore& core, BenchmarkResponse* response)
+        : core_(core), response_(response), downstream_(this) {
+        if (core_.IsMulticasting()) {
+            Finish(Status(grpc::StatusCode::UNIMPLEMENTED, kNoChunkedMulticast));
+            return;
+        }
+        StartRead(&chunk_);
+    }
 
-        Status status = stub_->ProcessBenchmark(&context, request, &response);
+    void OnReadDone(bool ok) override {
+        if (!ok) {
+            if (chunks_ == 0) {
+                Finish(Status(grpc::StatusCode::INVALID_ARGUMENT, "chunked request without chunks"));
+            } else if (core_.IsForwarding()) {
+                downstream_.StartWritesDone();
+                downstream_.RemoveHold();
+            } else {
+                core_.FillResponse(requestId_, timestamp_, bytes_, receiveTime_, response_);
+                response_->set_success(static_cast<int64_t>(bytes_) == totalSize_);
+                core_.CountCompleted();
+                Finish(Status::OK);
+            }
+            return;
+        }
 
+        if (chunks_++ == 0) {
+            receiveTime_ = WallClockNs();
+            requestId_ = chunk_.requestid();
+            timestamp_ = chunk_.timestamp();
+            totalSize_ = chunk_.totalsize();
+            if (core_.IsForwarding()) {
+                forwardContext_.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(30));
+                forwardSendTime_ = WallClockNs();
+                core_.forwardingClient()->stub()->async()->ProcessBenchmarkChunked(&forwardContext_, response_,
+                                                                                   &downstream_);
+                pendingHalves_.fetch_add(1, std::memory_order_relaxed);
+                downstream_.AddHold();
+                downstream_.StartCall();
+            }
+        }
+        bytes_ += chunk_.data().size();
+        if (core_.IsForwarding()) {
+            downstream_.StartWrite(&chunk_);
+        } else {
+            StartRead(&chunk_);
+        }
+    }
+
+    void OnCancel() override {
+        if (chunks_ > 0 && core_.IsForwarding()) {
+            forwardContext_.TryCancel();
+        }
+    }
+
+    void OnDone() override { Release(); }
+
+private:
+    class Downstream : public grpc::ClientWriteReactor<BenchmarkChunk> {
+    public:
+        explicit Downstream(CallbackChunkedReactor* call) : call_(call) {}
+        void OnWriteDone(bool ok) override { call_->OnDownstreamWriteDone(ok); }
+        void OnDone(const Status& status) override { call_->OnDownstreamDone(status); }
+
+    private:
+        CallbackChunkedReactor* call_;
+    };
+
+    void OnDownstreamWriteDone(bool ok) {
+        if (ok) {
+            StartRead(&chunk_);
+        } else {
+            // Stop relaying; the downstream status is reported through OnDownstreamDone
+            downstream_.RemoveHold();
+        }
+    }
+
+    void OnDownstreamDone(const Status& status) {
         if (!status.ok()) {
-            response.set_success(false);
+            response_->set_success(false);
         }
+        core_.AppendForwardHop(response_, receiveTime_, forwardSendTime_, WallClockNs());
+        core_.NoteForwarded(requestId_);
+        core_.CountCompleted();
+        Finish(Status::OK);
+        Release();
+    }
+
+    // With a downstream upload the server and client halves finish
+    // independently; whichever is last frees the call
+    void Release() {
+        if (pendingHalves_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    BenchmarkCore& core_;
+    BenchmarkResponse* response_;
+    Downstream downstream_;
+    ClientContext forwardContext_;
+    BenchmarkChunk chunk_;
+    uint64_t chunks_ = 0;
+    size_t bytes_ = 0;
+    int32_t requestId_ = 0;
+    int64_t timestamp_ = 0;
+    int64_t totalSize_ = 0;
+    int64_t receiveTime_ = 0;
+    int64_t forwardSendTime_ = 0;
+    std::atomic<int> pendingHalves_{1};
+};
+
+// Callback engine: handlers run on gRPC's callback executor and return a
+// reactor; a forwarding worker issues the downstream call with the callback
+// stub API and finishes the reactor from its completion, so no thread waits.
+class CallbackBenchmarkServiceImpl final : public BenchmarkService::CallbackService {
+public:
+    CallbackBenchmarkServiceImpl(BenchmarkCore& core) : core_(core) {}
+
+    grpc::ServerUnaryReactor* ProcessBenchmark(grpc::CallbackServerContext* context,
+                                               const BenchmarkRequest* request,
+                                               BenchmarkResponse* response) override {
+        grpc::ServerUnaryReactor* reactor = context->DefaultReactor();
+
+        if (core_.IsMulticasting()) {
+            int64_t receiveTime = WallClockNs();
+            core_.multicast()->Send(*request, [this, reactor, request, response, receiveTime](
+                                                  BenchmarkResponse* aggregated) {
+                *response = std::move(*aggregated);
+                core_.AppendForwardHop(response, receiveTime, receiveTime, WallClockNs());
+                core_.NoteForwarded(*request);
+                core_.CountCompleted();
+                reactor->Finish(Status::OK);
+            });
+            return reactor;
+        }
+
+        if (!core_.IsForwarding()) {
+            int64_t delayNs = core_.NextDelayNs();
+            if (delayNs > 0) {
+                // Answered from a callback alarm, so no executor thread is held
+                int64_t receiveTime = WallClockNs();
+                auto* alarm = new grpc::Alarm();
+                alarm->Set(std::chrono::system_clock::now() + std::chrono::nanoseconds(delayNs),
+                           [this, alarm, reactor, request, response, receiveTime](bool) {
+                               core_.FillResponse(request->requestid(), request->timestamp(),
+                                                  request->payload().size(), receiveTime, response);
+                               core_.CountCompleted();
+                               reactor->Finish(Status::OK);
+                               delete alarm;
+                           });
+                return reactor;
+            }
+            core_.FillResponse(*request, response);
+            core_.CountCompleted();
+            reactor->Finish(Status::OK);
+            return reactor;
+        }
+
+        int64_t receiveTime = WallClockNs();
+        auto* forwardContext = new ClientContext();
+        forwardContext->set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(30));
+        core_.forwardingClient()->stub()->async()->ProcessBenchmark(
+            forwardContext, request, response,
+            [this, forwardContext, reactor, request, response, receiveTime](Status status) {
+                if (!status.ok()) {
+                    response->set_success(false);
+                }
+                core_.AppendForwardHop(response, receiveTime, receiveTime, WallClockNs());
+                core_.NoteForwarded(*request);
+                core_.CountCompleted();
+                delete forwardContext;
+                reactor->Finish(Status::OK);
+            });
+        return reactor;
+    }
+
+    grpc::ServerBidiReactor<BenchmarkRequest, BenchmarkResponse>* ProcessBenchmarkStream(
+        grpc::CallbackServerContext* /*context*/) override {
+        return new CallbackStreamReactor(core_);
+    }
+
+    grpc::ServerReadReactor<BenchmarkChunk>* ProcessBenchmarkChunked(grpc::CallbackServerContext* /*context*/,
+                                                                    BenchmarkResponse* response) override {
+        return new CallbackChunkedReactor(core_, response);
+    }
 
-        return response;
+    grpc::ServerUnaryReactor* GetStats(grpc::CallbackServerContext* context, const benchmark::StatsRequest* request,
+                                       benchmark::WorkerStatsSnapshot* response) override {
+        core_.FillStats(request->reset(), response);
+        grpc::ServerUnaryReactor* reactor = context->DefaultReactor();
+        reactor->Finish(Status::OK);
+        return reactor;
     }
 
 private:
-    std::unique_ptr<BenchmarkService::Stub> stub_;
+    BenchmarkCore& core_;
 };
 
-class BenchmarkServiceImpl final : public BenchmarkService::Service {
+// Passthrough forwarding: a generic (ByteBuffer) bidi proxy between the caller
+// and the next worker. Messages are relayed as the serialized slices gRPC
+// received, so the payload is never parsed or copied, and every step is a
+// reactor callback, so no thread is held while the downstream call is pending.
+// Any method is relayed, so unary and streaming calls share this path.
+//
+// Each direction is a chain of one outstanding operation at a time, and each
+// chain holds the downstream call open until it ends. That guarantees no relay
+// step is still in flight when the downstream status arrives and is passed
+// upstream with Finish.
+//
+// The forwarder's hop is still recorded without parsing anything: protobuf
+// merges concatenated encodings by appending repeated fields, so a serialized
+// BenchmarkResponse holding only this worker's hop is added to each relayed
+// response as one extra slice. Responses come back in request order, so the
+// request times are matched to responses through a FIFO.
+class PassthroughForwardCall : public grpc::ServerGenericBidiReactor {
 public:
-    BenchmarkServiceImpl(const std::string& nextWorkerAddress = "") 
-        : nextWorkerAddress_(nextWorkerAddress) {
-        // Pre-generate 512-byte acknowledgement data
-        ackData_.resize(512);
-        for (int i = 0; i < 512; ++i) {
-            ackData_[i] = static_cast<char>('A' + (i % 26));
-        }
-
-        // If we have a next worker, create a client for forwarding
-        if (!nextWorkerAddress_.empty()) {
-            auto channel = grpc::CreateChannel(nextWorkerAddress_, grpc::InsecureChannelCredentials());
-            forwardingClient_ = std::make_unique<ForwardingClient>(channel);
-            std::cout << "Worker configured to forward to: " << nextWorkerAddress_ << std::endl;
-        }
-    }
-
-    Status ProcessBenchmark(ServerContext* context, const BenchmarkRequest* request,
-                           BenchmarkResponse* response) override {
-        
-        auto responseTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
-            std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-
-        // If this worker should forward to another worker (two-hop pattern)
-        if (forwardingClient_) {
-            // Forward the request to the next worker
-            BenchmarkRequest forwardRequest = *request;
-            BenchmarkResponse forwardResponse = forwardingClient_->ForwardRequest(forwardRequest);
-            
-            // Return the response from the final worker
-            *response = forwardResponse;
-            
-            if (request->requestid() % 100 == 0) {
-                std::cout << "Worker forwarded request " << request->requestid() 
-                          << " to " << nextWorkerAddress_ << std::endl;
+    PassthroughForwardCall(grpc::GenericCallbackServerContext* context, BenchmarkCore& core)
+        : core_(core), downstream_(this),
+          downstreamContext_(ClientContext::FromCallbackServerContext(*context)) {
+        core_.forwardingClient()->genericStub()->PrepareBidiStreamingCall(
+            downstreamContext_.get(), context->method(), grpc::StubOptions(), &downstream_);
+        downstream_.AddHold();  // request chain
+        downstream_.AddHold();  // response chain
+        downstream_.StartRead(&downstreamMessage_);
+        downstream_.StartCall();
+        StartRead(&upstreamMessage_);
+    }
+
+    // Request chain: upstream read -> downstream write -> upstream read ...
+    void OnReadDone(bool ok) override {
+        if (ok) {
+            {
+                int64_t now = WallClockNs();
+                std::lock_guard<std::mutex> lock(hopMutex_);
+                receiveTimes_.push_back(now);
             }
+            downstream_.StartWrite(&upstreamMessage_);
+        } else {
+            downstream_.StartWritesDone();
+            downstream_.RemoveHold();
+        }
+    }
+
+    void OnDownstreamWriteDone(bool ok) {
+        if (ok) {
+            StartRead(&upstreamMessage_);
+        } else {
+            // The downstream call is broken; its status is reported through OnDownstreamDone
+            downstream_.RemoveHold();
+        }
+    }
+
+    // Response chain: downstream read -> upstream write -> downstream read ...
+    void OnDownstreamReadDone(bool ok) {
+        if (ok) {
+            AppendHop();
+            StartWrite(&downstreamMessage_);
+        } else {
+            downstream_.RemoveHold();
+        }
+    }
+
+    void OnWriteDone(bool ok) override {
+        if (ok) {
+            downstream_.StartRead(&downstreamMessage_);
         } else {
-            // Normal processing - this is the final worker
-            response->set_requestid(request->requestid());
-            response->set_acknowledgement(ackData_);
-            response->set_requesttimestamp(request->timestamp());
-            response->set_responsetimestamp(responseTime);
-            response->set_success(true);
-            
-            if (request->requestid() % 100 == 0) {
-                std::cout << "Worker processed request " << request->requestid() 
-                          << " with payload size: " << request->payload().size() 
-                          << " bytes" << std::endl;
+            downstreamContext_->TryCancel();
+            downstream_.RemoveHold();
+        }
+    }
+
+    void OnDownstreamDone(const Status& status) {
+        core_.NoteForwardedCall(core_.CountCompleted());
+        Finish(status);
+        Release();
+    }
+
+    void OnCancel() override { downstreamContext_->TryCancel(); }
+
+    void OnDone() override { Release(); }
+
+private:
+    class Downstream : public grpc::ClientBidiReactor<ByteBuffer, ByteBuffer> {
+    public:
+        explicit Downstream(PassthroughForwardCall* call) : call_(call) {}
+        void OnWriteDone(bool ok) override { call_->OnDownstreamWriteDone(ok); }
+        void OnReadDone(bool ok) override { call_->OnDownstreamReadDone(ok); }
+        void OnDone(const Status& status) override { call_->OnDownstreamDone(status); }
+
+    private:
+        PassthroughForwardCall* call_;
+    };
+
+    void AppendHop() {
+        int64_t forwardReceiveTime = WallClockNs();
+        int64_t receiveTime;
+        {
+            std::lock_guard<std::mutex> lock(hopMutex_);
+            if (receiveTimes_.empty()) {
+                return;
             }
+            receiveTime = receiveTimes_.front();
+            receiveTimes_.pop_front();
+        }
+
+        BenchmarkResponse hopOnly;
+        core_.AppendForwardHop(&hopOnly, receiveTime, receiveTime, forwardReceiveTime);
+        std::vector<grpc::Slice> slices;
+        if (!downstreamMessage_.Dump(&slices).ok()) {
+            return;
+        }
+        slices.emplace_back(hopOnly.SerializeAsString());
+        downstreamMessage_ = ByteBuffer(slices.data(), slices.size());
+    }
+
+    // The server and client halves finish independently; whichever is last frees the call
+    void Release() {
+        if (pendingHalves_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
         }
-        
-        return Status::OK;
     }
 
+    BenchmarkCore& core_;
+    Downstream downstream_;
+    std::unique_ptr<ClientContext> downstreamContext_;
+    ByteBuffer upstreamMessage_;
+    ByteBuffer downstreamMessage_;
+    std::mutex hopMutex_;
+    std::deque<int64_t> receiveTimes_;
+    std::atomic<int> pendingHalves_{2};
+};
+
+// GetStats reaches a passthrough forwarder like any other method but is about
+// this worker, so it is answered here instead of being relayed.
+class LocalStatsCall : public grpc::ServerGenericBidiReactor {
+public:
+    explicit LocalStatsCall(BenchmarkCore& core) : core_(core) { StartRead(&request_); }
+
+    void OnReadDone(bool ok) override {
+        Status status = ok ? core_.FillStats(&request_, &response_)
+                           : Status(grpc::StatusCode::INVALID_ARGUMENT, "missing request message");
+        if (status.ok()) {
+            StartWriteAndFinish(&response_, grpc::WriteOptions(), Status::OK);
+        } else {
+            Finish(status);
+        }
+    }
+
+    void OnDone() override { delete this; }
+
 private:
-    std::string ackData_;
+    BenchmarkCore& core_;
+    ByteBuffer request_;
+    ByteBuffer response_;
+};
+
+class PassthroughForwardingService final : public grpc::CallbackGenericService {
+public:
+    PassthroughForwardingService(BenchmarkCore& core) : core_(core) {}
+
+    grpc::ServerGenericBidiReactor* CreateReactor(grpc::GenericCallbackServerContext* context) override {
+        if (context->method() == BenchmarkCore::GetStatsMethod()) {
+            return new LocalStatsCall(core_);
+        }
+        return new PassthroughForwardCall(context, core_);
+    }
+
+private:
+    BenchmarkCore& core_;
+};
+
+// Async engine: one ServerCompletionQueue per polling thread. Each call is a
+// small state machine driven by its CQ; forwarding is issued on the same CQ so
+// the downstream response is handled by the thread that owns the request.
+class AsyncTag {
+public:
+    virtual ~AsyncTag() = default;
+    virtual void Proceed(bool ok) = 0;
+};
+
+class AsyncCall final : public AsyncTag {
+public:
+    AsyncCall(BenchmarkService::AsyncService* service, ServerCompletionQueue* cq, BenchmarkCore& core)
+        : service_(service), cq_(cq), core_(core), responder_(&context_), state_(State::kListening) {
+        // Swapping heap messages only exchanges their internals, so a pooled
+        // pair lends its buffers to this call without copying
+        if (core_.messagePool() != nullptr) {
+            pooled_ = core_.messagePool()->Acquire();
+            request_.Swap(&pooled_->request);
+            response_.Swap(&pooled_->response);
+        }
+        service_->RequestProcessBenchmark(&context_, &request_, &responder_, cq_, cq_, this);
+    }
+
+    ~AsyncCall() override {
+        if (pooled_) {
+            request_.Swap(&pooled_->request);
+            response_.Swap(&pooled_->response);
+            core_.messagePool()->Recycle(std::move(pooled_));
+        }
+    }
+
+    void Proceed(bool ok) override {
+        switch (state_) {
+        case State::kListening:
+            if (!ok) {
+                // Server is shutting down
+                delete this;
+                return;
+            }
+            // Re-arm before doing any work so the CQ always has a pending request
+            new AsyncCall(service_, cq_, core_);
+
+            if (core_.IsForwarding()) {
+                state_ = State::kForwarding;
+                receiveTime_ = WallClockNs();
+                forwardContext_.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(30));
+                forwardReader_ = core_.forwardingClient()->stub()->AsyncProcessBenchmark(
+                    &forwardContext_, request_, cq_);
+                forwardReader_->Finish(&response_, &forwardStatus_, this);
+            } else if (core_.IsMulticasting()) {
+                // The aggregate completes on a gRPC thread; the alarm hands it back to this CQ
+                state_ = State::kForwarding;
+                receiveTime_ = WallClockNs();
+                core_.multicast()->Send(request_, [this](BenchmarkResponse* aggregated) {
+                    response_ = std::move(*aggregated);
+                    alarm_.Set(cq_, gpr_now(GPR_CLOCK_MONOTONIC), this);
+                });
+            } else {
+                receiveTime_ = WallClockNs();
+                int64_t delayNs = core_.NextDelayNs();
+                if (delayNs > 0) {
+                    // Answered when the alarm fires, without holding the polling thread
+                    state_ = State::kDelaying;
+                    alarm_.Set(cq_, std::chrono::system_clock::now() + std::chrono::nanoseconds(delayNs), this);
+                    break;
+                }
+                core_.FillResponse(request_, &response_);
+                state_ = State::kFinishing;
+                responder_.Finish(response_, Status::OK, this);
+            }
+            break;
+        case State::kDelaying:
+            core_.FillResponse(request_.requestid(), request_.timestamp(), request_.payload().size(), receiveTime_,
+                               &response_);
+            state_ = State::kFinishing;
+            responder_.Finish(response_, Status::OK, this);
+            break;
+        case State::kForwarding:
+            if (!ok || !forwardStatus_.ok()) {
+                response_.set_success(false);
+            }
+            core_.AppendForwardHop(&response_, receiveTime_, receiveTime_, WallClockNs());
+            core_.NoteForwarded(request_);
+            state_ = State::kFinishing;
+            responder_.Finish(response_, Status::OK, this);
+            break;
+        case State::kFinishing:
+            core_.CountCompleted();
+            delete this;
+            break;
+        }
+    }
+
+private:
+    enum class State { kListening, kForwarding, kDelaying, kFinishing };
+
+    BenchmarkService::AsyncService* service_;
+    ServerCompletionQueue* cq_;
+    BenchmarkCore& core_;
+    ServerContext context_;
+    BenchmarkRequest request_;
+    BenchmarkResponse response_;
+    ServerAsyncResponseWriter<BenchmarkResponse> responder_;
+    ClientContext forwardContext_;
+    Status forwardStatus_;
+    std::unique_ptr<ClientAsyncResponseReader<BenchmarkResponse>> forwardReader_;
+    grpc::Alarm alarm_;  // multicast aggregates and injected delays come back through it
+    std::unique_ptr<MessagePool::Messages> pooled_;
+    int64_t receiveTime_ = 0;
+    State state_;
+};
+
+// One ProcessBenchmarkStream call: read -> (forward) -> write -> read until the
+// client half-closes, with every step completed on the call's CQ.
+class AsyncStreamCall final : public AsyncTag {
+public:
+    AsyncStreamCall(BenchmarkService::AsyncService* service, ServerCompletionQueue* cq, BenchmarkCore& core)
+        : service_(service), cq_(cq), core_(core), stream_(&context_), state_(State::kListening) {
+        service_->RequestProcessBenchmarkStream(&context_, &stream_, cq_, cq_, this);
+    }
+
+    void Proceed(bool ok) override {
+        switch (state_) {
+        case State::kListening:
+            if (!ok) {
+                delete this;
+                return;
+            }
+            new AsyncStreamCall(service_, cq_, core_);
+            state_ = State::kReading;
+            stream_.Read(&request_, this);
+            break;
+        case State::kReading:
+            if (!ok) {
+                // Client half-closed the stream
+                state_ = State::kFinishing;
+                stream_.Finish(Status::OK, this);
+            } else if (core_.IsForwarding()) {
+                state_ = State::kForwarding;
+                receiveTime_ = WallClockNs();
+                response_.Clear();
+                forwardContext_ = std::make_unique<ClientContext>();
+                forwardContext_->set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(30));
+                forwardReader_ = core_.forwardingClient()->stub()->AsyncProcessBenchmark(
+                    forwardContext_.get(), request_, cq_);
+                forwardReader_->Finish(&response_, &forwardStatus_, this);
+            } else if (core_.IsMulticasting()) {
+                state_ = State::kForwarding;
+                receiveTime_ = WallClockNs();
+                forwardStatus_ = Status::OK;
+                core_.multicast()->Send(request_, [this](BenchmarkResponse* aggregated) {
+                    response_ = std::move(*aggregated);
+                    multicastDone_.Set(cq_, gpr_now(GPR_CLOCK_MONOTONIC), this);
+                });
+            } else {
+                core_.FillResponse(request_, &response_);
+                state_ = State::kWriting;
+                stream_.Write(response_, this);
+            }
+            break;
+        case State::kForwarding:
+            if (!ok || !forwardStatus_.ok()) {
+                response_.set_success(false);
+            }
+            core_.AppendForwardHop(&response_, receiveTime_, receiveTime_, WallClockNs());
+            core_.NoteForwarded(request_);
+            state_ = State::kWriting;
+            stream_.Write(response_, this);
+            break;
+        case State::kWriting:
+            core_.CountCompleted();
+            if (ok) {
+                state_ = State::kReading;
+                stream_.Read(&request_, this);
+            } else {
+                state_ = State::kFinishing;
+                stream_.Finish(Status::OK, this);
+            }
+            break;
+        case State::kFinishing:
+            delete this;
+            break;
+        }
+    }
+
+private:
+    enum class State { kListening, kReading, kForwarding, kWriting, kFinishing };
+
+    BenchmarkService::AsyncService* service_;
+    ServerCompletionQueue* cq_;
+    BenchmarkCore& core_;
+    ServerContext context_;
+    BenchmarkRequest request_;
+    BenchmarkResponse response_;
+    ServerAsyncReaderWriter<BenchmarkResponse, BenchmarkRequest> stream_;
+    std::unique_ptr<ClientContext> forwardContext_;
+    Status forwardStatus_;
+    std::unique_ptr<ClientAsyncResponseReader<BenchmarkResponse>> forwardReader_;
+    grpc::Alarm multicastDone_;
+    int64_t receiveTime_ = 0;
+    State state_;
+};
+
+// One ProcessBenchmarkChunked call: read -> (relay) -> read until the client
+// half-closes. A forwarding worker starts the downstream upload on the first
+// chunk and writes each chunk to it before reading the next, all on the
+// call's CQ.
+class AsyncChunkedCall final : public AsyncTag {
+public:
+    AsyncChunkedCall(BenchmarkService::AsyncService* service, ServerCompletionQueue* cq, BenchmarkCore& core)
+        : service_(service), cq_(cq), core_(core), reader_(&context_), state_(State::kListening) {
+        service_->RequestProcessBenchmarkChunked(&context_, &reader_, cq_, cq_, this);
+    }
+
+    void Proceed(bool ok) override {
+        switch (state_) {
+        case State::kListening:
+            if (!ok) {
+                delete this;
+                return;
+            }
+            new AsyncChunkedCall(service_, cq_, core_);
+            if (core_.IsMulticasting()) {
+                state_ = State::kFinishing;
+                reader_.FinishWithError(Status(grpc::StatusCode::UNIMPLEMENTED, kNoChunkedMulticast), this);
+                break;
+            }
+            state_ = State::kReading;
+            reader_.Read(&chunk_, this);
+            break;
+        case State::kReading:
+            if (!ok) {
+                // Client half-closed: every chunk has arrived
+                if (chunks_ == 0) {
+                    state_ = State::kFinishing;
+                    reader_.FinishWithError(Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                                   "chunked request without chunks"), this);
+                } else if (core_.IsForwarding()) {
+                    state_ = State::kClosingForward;
+                    forwardWriter_->WritesDone(this);
+                } else {
+                    core_.FillResponse(requestId_, timestamp_, bytes_, receiveTime_, &response_);
+                    response_.set_success(static_cast<int64_t>(bytes_) == totalSize_);
+                    state_ = State::kFinishing;
+                    reader_.Finish(response_, Status::OK, this);
+                }
+                break;
+            }
+            bytes_ += chunk_.data().size();
+            if (chunks_++ == 0) {
+                receiveTime_ = WallClockNs();
+                requestId_ = chunk_.requestid();
+                timestamp_ = chunk_.timestamp();
+                totalSize_ = chunk_.totalsize();
+                if (core_.IsForwarding()) {
+                    state_ = State::kStartingForward;
+                    forwardContext_.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(30));
+                    forwardSendTime_ = WallClockNs();
+                    forwardWriter_ = core_.forwardingClient()->stub()->PrepareAsyncProcessBenchmarkChunked(
+                        &forwardContext_, &response_, cq_);
+                    forwardWriter_->StartCall(this);
+                    break;
+                }
+            }
+            if (core_.IsForwarding()) {
+                state_ = State::kRelaying;
+                forwardWriter_->Write(chunk_, this);
+            } else {
+                reader_.Read(&chunk_, this);
+            }
+            break;
+        case State::kStartingForward:
+        case State::kRelaying:
+            if (!ok) {
+                // The downstream call is broken; collect its status and answer
+                state_ = State::kForwardFinishing;
+                forwardWriter_->Finish(&forwardStatus_, this);
+            } else if (state_ == State::kStartingForward) {
+                state_ = State::kRelaying;
+                forwardWriter_->Write(chunk_, this);
+            } else {
+                state_ = State::kReading;
+                reader_.Read(&chunk_, this);
+            }
+            break;
+        case State::kClosingForward:
+            state_ = State::kForwardFinishing;
+            forwardWriter_->Finish(&forwardStatus_, this);
+            break;
+        case State::kForwardFinishing:
+            if (!ok || !forwardStatus_.ok()) {
+                response_.set_success(false);
+            }
+            core_.AppendForwardHop(&response_, receiveTime_, forwardSendTime_, WallClockNs());
+            core_.NoteForwarded(requestId_);
+            state_ = State::kFinishing;
+            reader_.Finish(response_, Status::OK, this);
+            break;
+        case State::kFinishing:
+            core_.CountCompleted();
+            delete this;
+            break;
+        }
+    }
+
+private:
+    enum class State { kListening, kReading, kStartingForward, kRelaying, kClosingForward, kForwardFinishing,
+                       kFinishing };
+
+    BenchmarkService::AsyncService* service_;
+    ServerCompletionQueue* cq_;
+    BenchmarkCore& core_;
+    ServerContext context_;
+    BenchmarkChunk chunk_;
+    BenchmarkResponse response_;
+    ServerAsyncReader<BenchmarkResponse, BenchmarkChunk> reader_;
+    ClientContext forwardContext_;
+    Status forwardStatus_;
+    std::unique_ptr<ClientAsyncWriter<BenchmarkChunk>> forwardWriter_;
+    uint64_t chunks_ = 0;
+    size_t bytes_ = 0;
+    int32_t requestId_ = 0;
+    int64_t timestamp_ = 0;
+    int64_t totalSize_ = 0;
+    int64_t receiveTime_ = 0;
+    int64_t forwardSendTime_ = 0;
+    State state_;
+};
+
+// GetStats on the async engine. Every method of an AsyncService must be
+// requested, or its calls would wait forever, so one is posted per CQ.
+class AsyncStatsCall final : public AsyncTag {
+public:
+    AsyncStatsCall(BenchmarkService::AsyncService* service, ServerCompletionQueue* cq, BenchmarkCore& core)
+        : service_(service), cq_(cq), core_(core), responder_(&context_) {
+        service_->RequestGetStats(&context_, &request_, &responder_, cq_, cq_, this);
+    }
+
+    void Proceed(bool ok) override {
+        if (!ok || finishing_) {
+            delete this;
+            return;
+        }
+        new AsyncStatsCall(service_, cq_, core_);
+        core_.FillStats(request_.reset(), &response_);
+        finishing_ = true;
+        responder_.Finish(response_, Status::OK, this);
+    }
+
+private:
+    BenchmarkService::AsyncService* service_;
+    ServerCompletionQueue* cq_;
+    BenchmarkCore& core_;
+    ServerContext context_;
+    benchmark::StatsRequest request_;
+    benchmark::WorkerStatsSnapshot response_;
+    ServerAsyncResponseWriter<benchmark::WorkerStatsSnapshot> responder_;
+    bool finishing_ = false;
+};
+
+// Raw codec: an AsyncGenericService call that answers with the pre-serialized
+// acknowledgement without ever parsing the request. A copy-engine forwarder
+// relays the request bytes through the GenericStub on the same CQ. GetStats
+// arrives through the same generic service and is the one call that is parsed.
+class RawCall final : public AsyncTag {
+public:
+    RawCall(grpc::AsyncGenericService* service, ServerCompletionQueue* cq, BenchmarkCore& core)
+        : service_(service), cq_(cq), core_(core), stream_(&context_), state_(State::kListening) {
+        service_->RequestCall(&context_, &stream_, cq_, cq_, this);
+    }
+
+    void Proceed(bool ok) override {
+        switch (state_) {
+        case State::kListening:
+            if (!ok) {
+                delete this;
+                return;
+            }
+            new RawCall(service_, cq_, core_);
+            state_ = State::kReading;
+            stream_.Read(&request_, this);
+            break;
+        case State::kReading:
+            receiveTime_ = WallClockNs();
+            if (!ok) {
+                state_ = State::kFinishing;
+                stream_.Finish(Status(grpc::StatusCode::INVALID_ARGUMENT, "missing request message"), this);
+            } else if (context_.method() == BenchmarkCore::GetStatsMethod()) {
+                state_ = State::kFinishing;
+                statsCall_ = true;
+                AnswerStats();
+            } else if (core_.IsForwarding()) {
+                state_ = State::kForwarding;
+                forwardContext_.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(30));
+                forwardReader_ = core_.forwardingClient()->genericStub()->PrepareUnaryCall(
+                    &forwardContext_, context_.method(), request_, cq_);
+                forwardReader_->StartCall();
+                forwardReader_->Finish(&response_, &forwardStatus_, this);
+            } else {
+                core_.Serve(request_.Length());
+                state_ = State::kFinishing;
+                stream_.WriteAndFinish(core_.rawAck(), grpc::WriteOptions(), Status::OK, this);
+            }
+            break;
+        case State::kForwarding:
+            state_ = State::kFinishing;
+            if (ok && forwardStatus_.ok()) {
+                stream_.WriteAndFinish(response_, grpc::WriteOptions(), Status::OK, this);
+            } else {
+                stream_.Finish(forwardStatus_.ok() ? Status(grpc::StatusCode::UNAVAILABLE, "forwarding failed")
+                                                   : forwardStatus_, this);
+            }
+            break;
+        case State::kFinishing:
+            if (!statsCall_) {
+                core_.NoteRawCall(core_.CountCompleted(), receiveTime_, core_.IsForwarding());
+            }
+            delete this;
+            break;
+        }
+    }
+
+private:
+    enum class State { kListening, kReading, kForwarding, kFinishing };
+
+    void AnswerStats() {
+        Status status = core_.FillStats(&request_, &response_);
+        if (status.ok()) {
+            stream_.WriteAndFinish(response_, grpc::WriteOptions(), Status::OK, this);
+        } else {
+            stream_.Finish(status, this);
+        }
+    }
+
+    grpc::AsyncGenericService* service_;
+    ServerCompletionQueue* cq_;
+    BenchmarkCore& core_;
+    grpc::GenericServerContext context_;
+    grpc::GenericServerAsyncReaderWriter stream_;
+    ByteBuffer request_;
+    ByteBuffer response_;
+    ClientContext forwardContext_;
+    Status forwardStatus_;
+    std::unique_ptr<grpc::GenericClientAsyncResponseReader> forwardReader_;
+    int64_t receiveTime_ = 0;
+    bool statsCall_ = false;
+    State state_;
+};
+
+class AsyncServerEngine {
+public:
+    // Requests pre-posted on each CQ so bursts do not wait for re-arming
+    static constexpr int kCallsPerCq = 16;
+
+    // With a rawService every CQ serves raw generic calls instead of the typed service
+    AsyncServerEngine(BenchmarkCore& core, BenchmarkService::AsyncService* service,
+                      grpc::AsyncGenericService* rawService,
+                      std::vector<std::unique_ptr<ServerCompletionQueue>> cqs, bool pinCpus, bool busyPoll)
+        : core_(core), service_(service), rawService_(rawService), cqs_(std::move(cqs)), pinCpus_(pinCpus),
+          busyPoll_(busyPoll) {}
+
+    void Run() {
+        std::vector<std::thread> pollers;
+        for (size_t i = 0; i < cqs_.size(); ++i) {
+            if (rawService_ != nullptr) {
+                for (int c = 0; c < kCallsPerCq; ++c) {
+                    new RawCall(rawService_, cqs_[i].get(), core_);
+                }
+            } else {
+                for (int c = 0; c < kCallsPerCq; ++c) {
+                    new AsyncCall(service_, cqs_[i].get(), core_);
+                }
+                new AsyncStreamCall(service_, cqs_[i].get(), core_);
+                new AsyncChunkedCall(service_, cqs_[i].get(), core_);
+                new AsyncStatsCall(service_, cqs_[i].get(), core_);
+            }
+            pollers.emplace_back([this, i]() {
+                if (pinCpus_) {
+                    PinThreadToCpu(i);
+                }
+                void* tag;
+                bool ok;
+                while (NextCompletion(cqs_[i].get(), busyPoll_, &tag, &ok)) {
+                    static_cast<AsyncTag*>(tag)->Proceed(ok);
+                }
+            });
+        }
+
+        for (auto& poller : pollers) {
+            poller.join();
+        }
+    }
+
+private:
+    BenchmarkCore& core_;
+    BenchmarkService::AsyncService* service_;
+    grpc::AsyncGenericService* rawService_;
+    std::vector<std::unique_ptr<ServerCompletionQueue>> cqs_;
+    bool pinCpus_;
+    bool busyPoll_;
+};
+
+// Serves the shared-memory transport alongside the gRPC server. One thread polls
+// every claimed slot of this worker's segment and answers requests in order; a
+// forwarding worker relays each one over its own slot in the next worker's
+// segment first, so twohop runs end to end without gRPC.
+class ShmServer {
+public:
+    ShmServer(BenchmarkCore& core, const WorkerOptions& options)
+        : core_(core),
+          segment_(ShmSegment::Create(ShmSegmentName(options.port), options.shmRingBytes)),
+          wait_(options.shmWait),
+          nextWorkerAddress_(options.nextWorkerAddress) {}
+
+    void Run() {
+        static constexpr int kPollTimeoutMs = 100;
+        BenchmarkRequest request;
+        BenchmarkResponse response;
+        while (true) {
+            bool idle = true;
+            for (int slot = 0; slot < kShmSlots; ++slot) {
+                if (!segment_->SlotClaimed(slot)) {
+                    continue;
+                }
+                ShmRing requests = segment_->RequestRing(slot);
+                ShmRing responses = segment_->ResponseRing(slot);
+                ShmRead read;
+                while ((read = requests.TryRead(&request)) == ShmRead::kMessage) {
+                    idle = false;
+                    Process(request, &response);
+                    if (!Reply(slot, responses, response)) {
+                        break;
+                    }
+                }
+                // The request's id went with it, so it cannot be answered; the
+                // client sees the broken slot and fails what it has outstanding
+                if (read == ShmRead::kMalformed) {
+                    std::cout << "Dropping shared-memory slot " << slot << ": malformed request" << std::endl;
+                    segment_->BreakSlot(slot);
+                    responses.wake().Notify();
+                }
+            }
+            if (idle) {
+                segment_->header()->doorbell.Wait([this]() { return HasRequests(); }, wait_, kPollTimeoutMs);
+            }
+        }
+    }
+
+private:
+    bool HasRequests() {
+        for (int slot = 0; slot < kShmSlots; ++slot) {
+            if (segment_->SlotClaimed(slot) && !segment_->RequestRing(slot).Empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Process(const BenchmarkRequest& request, BenchmarkResponse* response) {
+        if (nextWorkerAddress_.empty()) {
+            core_.FillResponse(request, response);
+        } else {
+            int64_t receiveTime = WallClockNs();
+            Forward(request, response);
+            core_.AppendForwardHop(response, receiveTime, receiveTime, WallClockNs());
+            core_.NoteForwarded(request);
+        }
+        core_.CountCompleted();
+    }
+
+    // Waits for room in a full response ring; gives up if the client released the slot.
+    bool Reply(int slot, ShmRing& responses, const BenchmarkResponse& response) {
+        while (!responses.TryWrite(response)) {
+            if (!segment_->SlotClaimed(slot)) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        responses.wake().Notify();
+        return true;
+    }
+
+    void Forward(const BenchmarkRequest& request, BenchmarkResponse* response) {
+        static constexpr int kPollTimeoutMs = 100;
+        try {
+            if (!forward_) {
+                forward_ = std::make_unique<ShmConnection>(nextWorkerAddress_, wait_);
+            }
+        } catch (const std::exception& e) {
+            std::cout << "Shared-memory forwarding failed: " << e.what() << std::endl;
+            FailResponse(request, response);
+            return;
+        }
+
+        if (!forward_->Send(request)) {
+            FailResponse(request, response);
+            return;
+        }
+        while (!forward_->Receive(response, kPollTimeoutMs)) {
+            if (!forward_->WorkerAlive() || !forward_->Intact()) {
+                std::cout << "Shared-memory forwarding target " << nextWorkerAddress_
+                          << (forward_->Intact() ? " exited" : " dropped the connection") << std::endl;
+                forward_.reset();
+                FailResponse(request, response);
+                return;
+            }
+        }
+    }
+
+    static void FailResponse(const BenchmarkRequest& request, BenchmarkResponse* response) {
+        response->Clear();
+        response->set_requestid(request.requestid());
+        response->set_success(false);
+    }
+
+    BenchmarkCore& core_;
+    std::unique_ptr<ShmSegment> segment_;
+    ShmWait wait_;
     std::string nextWorkerAddress_;
-    std::unique_ptr<ForwardingClient> forwardingClient_;
+    std::unique_ptr<ShmConnection> forward_;
 };
 
-void RunServer(const std::string& port, const std::string& nextWorkerAddress = "") {
-    std::string server_address("0.0.0.0:" + port);
-    BenchmarkServiceImpl service(nextWorkerAddress);
+// Serves the raw TCP transport (see src/tcpTransport.h) instead of gRPC on the
+// worker's port, from a single event-loop thread built on either epoll or
+// io_uring. Every request frame read in one wakeup is answered before the
+// loop waits again, and the responses go out in one write. A forwarding worker
+// pipelines the requests of all its clients onto one connection to the next
+// worker, which answers them in order, and hands each answer back to the
+// client it came from; the loop never waits for the next hop.
+class TcpServer {
+public:
+    TcpServer(BenchmarkCore& core, const WorkerOptions& options)
+        : core_(core),
+          listenFd_(ListenTcp(options.port)),
+          nextWorkerAddress_(options.nextWorkerAddress),
+          uringBufferBytes_(options.tcpBufferBytes) {}
+
+    ~TcpServer() { close(listenFd_); }
+
+    void RunEpoll() {
+        epollFd_ = epoll_create1(0);
+        fcntl(listenFd_, F_SETFL, O_NONBLOCK);
+        epoll_event listenEvent{};
+        listenEvent.events = EPOLLIN;
+        listenEvent.data.ptr = nullptr;
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &listenEvent);
+
+        std::vector<epoll_event> events(64);
+        while (true) {
+            int ready = epoll_wait(epollFd_, events.data(), static_cast<int>(events.size()), -1);
+            for (int i = 0; i < ready; ++i) {
+                auto* connection = static_cast<EpollConnection*>(events[i].data.ptr);
+                if (connection == nullptr) {
+                    AcceptAll();
+                } else if (connection->fd < 0) {
+                    // Closed by an earlier event of this batch
+                } else if (connection == epollForward_) {
+                    ServeEpollForward(events[i].events);
+                } else {
+                    ServeEpollConnection(connection, events[i].events);
+                }
+            }
+            for (EpollConnection* connection : retired_) {
+                delete connection;
+            }
+            retired_.clear();
+        }
+    }
+
+    void RunUring() {
+        IoUring ring(256);
+        uringMemory_.resize(kUringConnections * 2 * uringBufferBytes_);
+        std::vector<iovec> buffers;
+        for (int i = 0; i < kUringConnections * 2; ++i) {
+            buffers.push_back(iovec{uringMemory_.data() + i * uringBufferBytes_, uringBufferBytes_});
+        }
+        ring.RegisterBuffers(buffers);
+        ring_ = &ring;
+
+        QueueAccept();
+        while (true) {
+            ring.Submit(1);
+            while (io_uring_cqe* cqe = ring.PeekCompletion()) {
+                uint64_t tag = cqe->user_data;
+                int result = cqe->res;
+                ring.ConsumeCompletion();
+                OnUringCompletion(static_cast<int>(tag >> 8), static_cast<UringOp>(tag & 0xff), result);
+            }
+        }
+    }
+
+private:
+    struct EpollConnection {
+        EpollConnection(int fd, uint64_t id) : fd(fd), id(id) {}
+
+        int fd;        // -1 once closed
+        uint64_t id;   // how relayed requests find their way back
+        std::vector<char> input;
+        std::vector<char> output;
+        size_t written = 0;
+        uint32_t watched = EPOLLIN;  // the events registered for fd
+        bool readClosed = false;     // the peer has sent everything it will
+    };
+
+    enum class UringOp : uint8_t { kAccept, kRead, kWrite };
+
+    // Reads and writes go to the slot's registered buffers; a connection has
+    // at most one of each in flight, and the loop leaves the buffer of an
+    // operation in flight alone. Closing a slot shuts its socket down so those
+    // operations complete, and the slot is reused only after they have.
+    struct UringConnection {
+        int fd = -1;
+        uint64_t id = 0;     // as EpollConnection::id; the low byte is the slot
+        size_t filled = 0;   // bytes in the read buffer
+        size_t pending = 0;  // response bytes in the write buffer
+        size_t written = 0;
+        bool reading = false;
+        bool writing = false;
+        bool readClosed = false;
+        std::vector<char> backlog;  // responses waiting for the write buffer
+    };
+
+    // The io_uring end of the connection to the next worker. Its I/O is not on
+    // registered buffers: frames queue in output while the previous write is
+    // in flight from sending.
+    struct UringForward {
+        int fd = -1;
+        std::vector<char> readChunk = std::vector<char>(64 * 1024);
+        std::vector<char> input;
+        std::vector<char> output;
+        std::vector<char> sending;
+        size_t written = 0;
+        bool reading = false;
+        bool writing = false;
+    };
+
+    // A request relayed to the next worker and not answered yet
+    struct PendingForward {
+        uint64_t origin;  // id of the client connection
+        int32_t requestId;
+        int64_t receiveTime;
+    };
+
+    static constexpr int kUringConnections = 8;
+    static constexpr int kUringForwardSlot = kUringConnections;
+
+    // Answers, or relays to the next worker, each complete request frame in
+    // data from the client origin, handing every answer to emit until it
+    // returns false. Returns the bytes consumed, or -1 on a frame larger than
+    // kTcpMaxFrameBytes or one that does not parse: its requestId is lost, so
+    // the connection is dropped and the client fails what is outstanding.
+    template <typename Emit>
+    long HandleFrames(const char* data, size_t size, uint64_t origin, Emit emit) {
+        size_t consumed = 0;
+        while (true) {
+            long frame = CompleteFrameBytes(data + consumed, size - consumed);
+            if (frame < 0) {
+                return -1;
+            }
+            if (frame == 0) {
+                return static_cast<long>(consumed);
+            }
+            if (!request_.ParseFromArray(data + consumed + kTcpFrameHeaderBytes,
+                                         static_cast<int>(frame - kTcpFrameHeaderBytes))) {
+                return -1;
+            }
+            consumed += frame;
+
+            if (nextWorkerAddress_.empty()) {
+                core_.FillResponse(request_, &response_);
+            } else if (Forward(request_, origin)) {
+                continue;
+            } else {
+                FailResponse(request_.requestid(), &response_);
+            }
+            core_.CountCompleted();
+            if (!emit(response_)) {
+                return static_cast<long>(consumed);
+            }
+        }
+    }
+
+    // Queues request for the next worker; false if it cannot be reached.
+    bool Forward(const BenchmarkRequest& request, uint64_t origin) {
+        std::vector<char>* output = ConnectForward();
+        if (output == nullptr) {
+            return false;
+        }
+        forwarded_.push_back(PendingForward{origin, request.requestid(), WallClockNs()});
+        AppendFrame(request, *output);
+        return true;
+    }
+
+    // The next worker's output queue, connecting first if need be; null if
+    // the connection cannot be made.
+    std::vector<char>* ConnectForward() {
+        if (ring_ == nullptr && epollForward_ != nullptr) {
+            return &epollForward_->output;
+        }
+        if (ring_ != nullptr && uringForward_.fd >= 0) {
+            return &uringForward_.output;
+        }
+        // A dropped io_uring link is reconnected once its last operation is back
+        if (ring_ != nullptr && (uringForward_.reading || uringForward_.writing)) {
+            return nullptr;
+        }
+
+        int fd;
+        try {
+            fd = ConnectTcp(nextWorkerAddress_);
+        } catch (const std::exception& e) {
+            std::cout << "TCP forwarding failed: " << e.what() << std::endl;
+            return nullptr;
+        }
+        if (ring_ != nullptr) {
+            uringForward_.fd = fd;
+            QueueForwardRead();
+            return &uringForward_.output;
+        }
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        epollForward_ = new EpollConnection(fd, 0);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = epollForward_;
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event);
+        return &epollForward_->output;
+    }
+
+    // Matches the next worker's responses in data, which come back in the
+    // order the requests went out, to the clients that sent them. Returns the
+    // bytes consumed, or -1 on a bad frame or one that answers the wrong request.
+    long AnswerForwarded(const char* data, size_t size) {
+        size_t consumed = 0;
+        while (true) {
+            long frame = CompleteFrameBytes(data + consumed, size - consumed);
+            if (frame < 0) {
+                return -1;
+            }
+            if (frame == 0) {
+                return static_cast<long>(consumed);
+            }
+            if (!response_.ParseFromArray(data + consumed + kTcpFrameHeaderBytes,
+                                          static_cast<int>(frame - kTcpFrameHeaderBytes)) ||
+                forwarded_.empty() || response_.requestid() != forwarded_.front().requestId) {
+                return -1;
+            }
+            consumed += frame;
+
+            PendingForward request = forwarded_.front();
+            forwarded_.pop_front();
+            core_.AppendForwardHop(&response_, request.receiveTime, request.receiveTime, WallClockNs());
+            core_.NoteForwarded(request.requestId);
+            core_.CountCompleted();
+            Answer(request.origin, response_);
+        }
+    }
+
+    // Closes the connection to the next worker and fails every request still
+    // relayed on it; the next request reconnects.
+    void DropForward(const char* reason) {
+        std::cout << "TCP forwarding target " << nextWorkerAddress_ << " " << reason << std::endl;
+        if (ring_ != nullptr) {
+            shutdown(uringForward_.fd, SHUT_RDWR);
+            close(uringForward_.fd);
+            uringForward_.fd = -1;
+            uringForward_.input.clear();
+            uringForward_.output.clear();
+        } else {
+            RetireEpoll(epollForward_);
+            epollForward_ = nullptr;
+        }
+
+        std::deque<PendingForward> failed;
+        failed.swap(forwarded_);
+        for (const PendingForward& request : failed) {
+            FailResponse(request.requestId, &response_);
+            core_.CountCompleted();
+            Answer(request.origin, response_);
+        }
+    }
+
+    // Whether requests relayed for the client origin are still unanswered
+    bool Owed(uint64_t origin) const {
+        return std::any_of(forwarded_.begin(), forwarded_.end(),
+                           [origin](const PendingForward& request) { return request.origin == origin; });
+    }
+
+    // Sends a relayed request's answer to its client, unless that has gone away
+    void Answer(uint64_t origin, const BenchmarkResponse& response) {
+        if (ring_ != nullptr) {
+            int slot = static_cast<int>(origin & 0xff);
+            if (uringConnections_[slot].fd >= 0 && uringConnections_[slot].id == origin) {
+                EmitUring(slot, response);
+                SettleUring(slot);
+            }
+            return;
+        }
+        auto it = epollConnections_.find(origin);
+        if (it != epollConnections_.end()) {
+            AppendFrame(response, it->second->output);
+            SettleEpoll(it->second);
+        }
+    }
+
+    static void FailResponse(int32_t requestId, BenchmarkResponse* response) {
+        response->Clear();
+        response->set_requestid(requestId);
+        response->set_success(false);
+    }
+
+    void AcceptAll() {
+        while (true) {
+            int fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK);
+            if (fd < 0) {
+                return;
+            }
+            TuneSocket(fd);
+            auto* connection = new EpollConnection(fd, nextConnectionId_++);
+            epollConnections_[connection->id] = connection;
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.ptr = connection;
+            epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event);
+        }
+    }
+
+    void ServeEpollConnection(EpollConnection* connection, uint32_t events) {
+        if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+            connection->readClosed = !ReadSocket(connection->fd, &connection->input);
+            long consumed = HandleFrames(connection->input.data(), connection->input.size(), connection->id,
+                                         [connection](const BenchmarkResponse& response) {
+                                             AppendFrame(response, connection->output);
+                                             return true;
+                                         });
+            if (consumed < 0) {
+                std::cout << "Dropping TCP connection: frame too large or malformed" << std::endl;
+                RetireEpoll(connection);
+                return;
+            }
+            connection->input.erase(connection->input.begin(), connection->input.begin() + consumed);
+        }
+        if (epollForward_ != nullptr && !Flush(epollForward_)) {
+            DropForward("closed the connection");
+        }
+        // Nothing more can be written to a peer that has hung up
+        if (events & (EPOLLHUP | EPOLLERR)) {
+            RetireEpoll(connection);
+            return;
+        }
+        SettleEpoll(connection);
+    }
+
+    void ServeEpollForward(uint32_t events) {
+        if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+            bool open = ReadSocket(epollForward_->fd, &epollForward_->input);
+            long consumed = AnswerForwarded(epollForward_->input.data(), epollForward_->input.size());
+            if (consumed < 0) {
+                DropForward("sent a bad frame");
+                return;
+            }
+            epollForward_->input.erase(epollForward_->input.begin(), epollForward_->input.begin() + consumed);
+            if (!open) {
+                DropForward("closed the connection");
+                return;
+            }
+        }
+        if (!Flush(epollForward_)) {
+            DropForward("closed the connection");
+        }
+    }
+
+    // Writes what is queued for a client, and closes the connection once the
+    // client has sent everything and been answered
+    void SettleEpoll(EpollConnection* connection) {
+        if (connection->fd < 0) {
+            return;
+        }
+        if (!Flush(connection)) {
+            RetireEpoll(connection);
+            return;
+        }
+        if (connection->readClosed && connection->output.empty() && !Owed(connection->id)) {
+            RetireEpoll(connection);
+        }
+    }
+
+    // Closes the connection now and frees it after the current batch of events,
+    // which may still refer to it
+    void RetireEpoll(EpollConnection* connection) {
+        if (connection->fd < 0) {
+            return;
+        }
+        epoll_ctl(epollFd_, EPOLL_CTL_DEL, connection->fd, nullptr);
+        close(connection->fd);
+        connection->fd = -1;
+        epollConnections_.erase(connection->id);
+        retired_.push_back(connection);
+    }
+
+    // Appends everything the socket has to input. Returns false once the peer
+    // has closed the connection or it failed.
+    static bool ReadSocket(int fd, std::vector<char>* input) {
+        static constexpr size_t kReadChunk = 64 * 1024;
+        while (true) {
+            size_t filled = input->size();
+            input->resize(filled + kReadChunk);
+            ssize_t n = recv(fd, input->data() + filled, kReadChunk, 0);
+            input->resize(filled + std::max<ssize_t>(n, 0));
+            if (n > 0 || (n < 0 && errno == EINTR)) {
+                continue;
+            }
+            return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+    }
+
+    // Writes queued output until the socket would block, and watches for
+    // EPOLLOUT while some remains (and for EPOLLIN until the peer is done).
+    // Returns false on a write error.
+    bool Flush(EpollConnection* connection) {
+        while (connection->written < connection->output.size()) {
+            ssize_t n = send(connection->fd, connection->output.data() + connection->written,
+                             connection->output.size() - connection->written, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            if (n <= 0) {
+                connection->output.clear();
+                connection->written = 0;
+                return false;
+            }
+            connection->written += n;
+        }
+
+        bool done = connection->written == connection->output.size();
+        if (done) {
+            connection->output.clear();
+            connection->written = 0;
+        }
+        uint32_t wanted = (connection->readClosed ? 0 : static_cast<uint32_t>(EPOLLIN)) |
+                          (done ? 0 : static_cast<uint32_t>(EPOLLOUT));
+        if (wanted != connection->watched) {
+            connection->watched = wanted;
+            epoll_event event{};
+            event.events = wanted;
+            event.data.ptr = connection;
+            epoll_ctl(epollFd_, EPOLL_CTL_MOD, connection->fd, &event);
+        }
+        return true;
+    }
+
+    char* UringReadBuffer(int slot) { return uringMemory_.data() + (2 * slot) * uringBufferBytes_; }
+    char* UringWriteBuffer(int slot) { return uringMemory_.data() + (2 * slot + 1) * uringBufferBytes_; }
+
+    io_uring_sqe* NextSqe(int slot, UringOp op) {
+        io_uring_sqe* sqe = ring_->NextSqe();
+        if (sqe == nullptr) {
+            ring_->Submit(0);
+            sqe = ring_->NextSqe();
+        }
+        sqe->user_data = (static_cast<uint64_t>(slot) << 8) | static_cast<uint8_t>(op);
+        return sqe;
+    }
+
+    void QueueAccept() {
+        io_uring_sqe* sqe = NextSqe(0, UringOp::kAccept);
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = listenFd_;
+    }
+
+    void QueueRead(int slot) {
+        UringConnection& connection = uringConnections_[slot];
+        io_uring_sqe* sqe = NextSqe(slot, UringOp::kRead);
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->fd = connection.fd;
+        sqe->addr = reinterpret_cast<uint64_t>(UringReadBuffer(slot) + connection.filled);
+        sqe->len = static_cast<uint32_t>(uringBufferBytes_ - connection.filled);
+        sqe->buf_index = static_cast<uint16_t>(2 * slot);
+        connection.reading = true;
+    }
+
+    void QueueWrite(int slot) {
+        UringConnection& connection = uringConnections_[slot];
+        io_uring_sqe* sqe = NextSqe(slot, UringOp::kWrite);
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->fd = connection.fd;
+        sqe->addr = reinterpret_cast<uint64_t>(UringWriteBuffer(slot) + connection.written);
+        sqe->len = static_cast<uint32_t>(connection.pending - connection.written);
+        sqe->buf_index = static_cast<uint16_t>(2 * slot + 1);
+        connection.writing = true;
+    }
+
+    void QueueForwardRead() {
+        io_uring_sqe* sqe = NextSqe(kUringForwardSlot, UringOp::kRead);
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = uringForward_.fd;
+        sqe->addr = reinterpret_cast<uint64_t>(uringForward_.readChunk.data());
+        sqe->len = static_cast<uint32_t>(uringForward_.readChunk.size());
+        uringForward_.reading = true;
+    }
+
+    void QueueForwardWrite() {
+        io_uring_sqe* sqe = NextSqe(kUringForwardSlot, UringOp::kWrite);
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = uringForward_.fd;
+        sqe->addr = reinterpret_cast<uint64_t>(uringForward_.sending.data() + uringForward_.written);
+        sqe->len = static_cast<uint32_t>(uringForward_.sending.size() - uringForward_.written);
+        uringForward_.writing = true;
+    }
+
+    // Starts writing the requests queued for the next worker, unless a write
+    // is already in flight; its completion picks them up.
+    void FlushUringForward() {
+        if (uringForward_.fd < 0 || uringForward_.writing || uringForward_.output.empty()) {
+            return;
+        }
+        uringForward_.sending.swap(uringForward_.output);
+        uringForward_.output.clear();
+        uringForward_.written = 0;
+        QueueForwardWrite();
+    }
+
+    void OnUringCompletion(int slot, UringOp op, int result) {
+        if (op == UringOp::kAccept) {
+            QueueAccept();
+            if (result >= 0) {
+                AdoptUringConnection(result);
+            }
+            return;
+        }
+        if (slot == kUringForwardSlot) {
+            OnUringForwardCompletion(op, result);
+            return;
+        }
+
+        UringConnection& connection = uringConnections_[slot];
+        (op == UringOp::kRead ? connection.reading : connection.writing) = false;
+        if (connection.fd < 0) {
+            return;  // closed while this was in flight
+        }
+        if (op == UringOp::kRead) {
+            if (result < 0) {
+                CloseUringConnection(slot);
+                return;
+            }
+            connection.filled += result;
+            connection.readClosed = result == 0;
+        } else {
+            if (result <= 0) {
+                CloseUringConnection(slot);
+                return;
+            }
+            connection.written += result;
+            if (connection.written < connection.pending) {
+                QueueWrite(slot);
+                return;
+            }
+            connection.pending = 0;
+            connection.written = 0;
+        }
+        DrainUringConnection(slot);
+    }
+
+    void OnUringForwardCompletion(UringOp op, int result) {
+        (op == UringOp::kRead ? uringForward_.reading : uringForward_.writing) = false;
+        if (uringForward_.fd < 0) {
+            return;  // dropped while this was in flight
+        }
+        if (result <= 0) {
+            DropForward("closed the connection");
+            return;
+        }
+        if (op == UringOp::kRead) {
+            std::vector<char>& input = uringForward_.input;
+            input.insert(input.end(), uringForward_.readChunk.data(), uringForward_.readChunk.data() + result);
+            long consumed = AnswerForwarded(input.data(), input.size());
+            if (consumed < 0) {
+                DropForward("sent a bad frame");
+                return;
+            }
+            input.erase(input.begin(), input.begin() + consumed);
+            QueueForwardRead();
+        } else {
+            uringForward_.written += result;
+            if (uringForward_.written < uringForward_.sending.size()) {
+                QueueForwardWrite();
+                return;
+            }
+            FlushUringForward();
+        }
+    }
+
+    void AdoptUringConnection(int fd) {
+        for (int slot = 0; slot < kUringConnections; ++slot) {
+            UringConnection& connection = uringConnections_[slot];
+            if (connection.fd < 0 && !connection.reading && !connection.writing) {
+                TuneSocket(fd);
+                connection.fd = fd;
+                connection.id = (nextConnectionId_++ << 8) | static_cast<uint64_t>(slot);
+                QueueRead(slot);
+                return;
+            }
+        }
+        std::cout << "Refusing TCP connection: all " << kUringConnections << " io_uring slots in use" << std::endl;
+        close(fd);
+    }
+
+    // Puts a response in the connection's write buffer or, while a write is in
+    // flight or it does not fit, in the backlog behind it. Returns false in
+    // that case, so no more requests are taken until the backlog drains.
+    bool EmitUring(int slot, const BenchmarkResponse& response) {
+        UringConnection& connection = uringConnections_[slot];
+        if (!connection.writing && connection.backlog.empty()) {
+            size_t n = WriteFrame(response, UringWriteBuffer(slot) + connection.pending,
+                                  uringBufferBytes_ - connection.pending);
+            connection.pending += n;
+            if (n > 0) {
+                return true;
+            }
+        }
+        AppendFrame(response, connection.backlog);
+        return false;
+    }
+
+    // Answers the complete frames in the read buffer, unless earlier responses
+    // are still waiting for room or a read is filling the buffer, then starts
+    // whatever I/O the connection can.
+    void DrainUringConnection(int slot) {
+        UringConnection& connection = uringConnections_[slot];
+        if (connection.backlog.empty() && !connection.reading) {
+            long consumed = HandleFrames(UringReadBuffer(slot), connection.filled, connection.id,
+                                         [this, slot](const BenchmarkResponse& response) {
+                                             return EmitUring(slot, response);
+                                         });
+            if (consumed < 0) {
+                std::cout << "Dropping TCP connection: frame too large or malformed" << std::endl;
+                CloseUringConnection(slot);
+                return;
+            }
+            std::memmove(UringReadBuffer(slot), UringReadBuffer(slot) + consumed, connection.filled - consumed);
+            connection.filled -= consumed;
+        }
+        FlushUringForward();
+        SettleUring(slot);
+    }
+
+    // Starts the next write (refilling the write buffer from the backlog, a
+    // buffer at a time, so any response size gets through) and the next read,
+    // and closes the connection once the client is done and fully answered.
+    void SettleUring(int slot) {
+        UringConnection& connection = uringConnections_[slot];
+        if (!connection.writing) {
+            if (connection.pending == 0 && !connection.backlog.empty()) {
+                size_t n = std::min(connection.backlog.size(), uringBufferBytes_);
+                std::memcpy(UringWriteBuffer(slot), connection.backlog.data(), n);
+                connection.backlog.erase(connection.backlog.begin(), connection.backlog.begin() + n);
+                connection.pending = n;
+            }
+            if (connection.pending > 0) {
+                QueueWrite(slot);
+            }
+        }
+        // Frames left behind by a full backlog are answered before reading more
+        if (!connection.reading && !connection.readClosed && connection.backlog.empty() &&
+            CompleteFrameBytes(UringReadBuffer(slot), connection.filled) == 0) {
+            if (connection.filled == uringBufferBytes_) {
+                std::cout << "Dropping TCP connection: frame larger than the " << uringBufferBytes_ / 1024
+                          << " KB io_uring buffer (raise --tcp-buffer-kb)" << std::endl;
+                CloseUringConnection(slot);
+                return;
+            }
+            QueueRead(slot);
+        }
+        if (connection.readClosed && !connection.writing && connection.pending == 0 &&
+            connection.backlog.empty() && !Owed(connection.id)) {
+            CloseUringConnection(slot);
+        }
+    }
+
+    // The slot stays taken until the operations still in flight on it are back
+    void CloseUringConnection(int slot) {
+        UringConnection& connection = uringConnections_[slot];
+        shutdown(connection.fd, SHUT_RDWR);
+        close(connection.fd);
+        connection.fd = -1;
+        connection.filled = 0;
+        connection.pending = 0;
+        connection.written = 0;
+        connection.readClosed = false;
+        connection.backlog.clear();
+    }
+
+    BenchmarkCore& core_;
+    int listenFd_;
+    std::string nextWorkerAddress_;
+    std::deque<PendingForward> forwarded_;
+    uint64_t nextConnectionId_ = 1;
+    BenchmarkRequest request_;
+    BenchmarkResponse response_;
+
+    int epollFd_ = -1;
+    std::unordered_map<uint64_t, EpollConnection*> epollConnections_;
+    EpollConnection* epollForward_ = nullptr;
+    std::vector<EpollConnection*> retired_;
+
+    IoUring* ring_ = nullptr;
+    size_t uringBufferBytes_;
+    std::vector<char> uringMemory_;
+    UringConnection uringConnections_[kUringConnections];
+    UringForward uringForward_;
+};
+
+// Prints completed requests/sec, C++ heap allocations and process CPU time per
+// request so worker throughput and cost can be compared across server modes,
+// thread counts, --reuse-buffers and --compression.
+void ReportThroughput(const BenchmarkCore& core, int intervalSec) {
+    uint64_t last = core.Completed();
+    uint64_t lastAllocations = AllocationCounter::Count();
+    uint64_t lastCpuNs = ProcessCpuNs();
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::seconds(intervalSec));
+        uint64_t now = core.Completed();
+        uint64_t allocations = AllocationCounter::Count();
+        uint64_t cpuNs = ProcessCpuNs();
+        std::cout << "Throughput: " << std::fixed << std::setprecision(1)
+                  << static_cast<double>(now - last) / intervalSec << " req/s"
+                  << " (total " << now << ")";
+        if (now > last) {
+            std::cout << ", " << static_cast<double>(allocations - lastAllocations) / (now - last)
+                      << " allocations/req, " << (cpuNs - lastCpuNs) / 1000.0 / (now - last) << " us cpu/req";
+        }
+        std::cout << std::endl;
+        last = now;
+        lastAllocations = allocations;
+        lastCpuNs = cpuNs;
+    }
+}
+
+// --stats-file: rewritten every intervalSec seconds through a rename, so a
+// scraper never reads a half-written file
+void DumpStats(BenchmarkCore& core, const std::string& path, int intervalSec) {
+    std::string temporary = path + ".tmp";
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::seconds(intervalSec));
+        {
+            std::ofstream out(temporary, std::ios::trunc);
+            if (!out) {
+                std::cout << "Cannot write " << temporary << "; stats dump stopped" << std::endl;
+                return;
+            }
+            core.WriteStatsText(out);
+        }
+        std::rename(temporary.c_str(), path.c_str());
+    }
+}
+
+// Runs the raw TCP transport in place of the gRPC server.
+void RunTcpServer(const WorkerOptions& options) {
+    // TcpServer relays over raw TCP itself, so the core gets no gRPC forwarding client
+    BenchmarkCore core;
+    core.NameForwardTarget(options.nextWorkerAddress);
+    core.EmulateServiceTime(options.serviceTime);
+    try {
+        TcpServer server(core, options);
+        std::cout << "Benchmark worker listening for raw TCP on port " << options.port
+                  << " (" << options.tcpBackend << " backend)";
+        if (!options.nextWorkerAddress.empty()) {
+            std::cout << " (forwarding to " << options.nextWorkerAddress << ")";
+        }
+        std::cout << std::endl;
+
+        if (options.reportIntervalSec > 0) {
+            std::thread(ReportThroughput, std::cref(core), options.reportIntervalSec).detach();
+        }
+        if (!options.statsFile.empty()) {
+            std::thread(DumpStats, std::ref(core), options.statsFile, options.statsIntervalSec).detach();
+        }
+        if (options.tcpBackend == "uring") {
+            server.RunUring();
+        } else {
+            server.RunEpoll();
+        }
+    } catch (const std::exception& e) {
+        std::cout << "TCP server failed: " << e.what() << std::endl;
+    }
+}
+
+void RunServer(const WorkerOptions& options) {
+    if (options.transport == "tcp") {
+        RunTcpServer(options);
+        return;
+    }
+
+    std::string server_address("0.0.0.0:" + options.port);
+    BenchmarkCore core(options.nextWorkerAddress, options.reuseBuffers, options.compression, options.maxMessageMb,
+                       options.tuning);
+    core.InjectDelay(options.delayMs, options.delayFraction);
+    core.EmulateServiceTime(options.serviceTime);
 
     ServerBuilder builder;
     builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
-    builder.RegisterService(&service);
-    
+    options.tuning.Apply(&builder);
+    // Compressed requests are always accepted; this only sets how responses are sent
+    if (options.compression != GRPC_COMPRESS_NONE) {
+        builder.SetDefaultCompressionAlgorithm(options.compression);
+    }
+    // Unary requests above gRPC's 4 MB default would be rejected before any
+    // handler runs; chunked requests never come close to it
+    if (options.maxMessageMb > 0) {
+        builder.SetMaxReceiveMessageSize(options.maxMessageMb * 1024 * 1024);
+        builder.SetMaxSendMessageSize(options.maxMessageMb * 1024 * 1024);
+    }
+
+    BenchmarkServiceImpl syncService(core);
+    CallbackBenchmarkServiceImpl callbackService(core);
+    RecyclingMessageAllocator recyclingAllocator(core.messagePool());
+    BenchmarkService::AsyncService asyncService;
+    PassthroughForwardingService passthroughService(core);
+    grpc::AsyncGenericService rawService;
+    std::vector<std::unique_ptr<ServerCompletionQueue>> cqs;
+
+    // A passthrough forwarder registers no typed service, so every method
+    // falls through to the generic proxy regardless of --server-mode. A
+    // multicasting worker must parse to aggregate, so it never proxies.
+    bool passthrough = core.IsForwarding() && options.forwardEngine == "passthrough";
+    bool raw = !passthrough && options.codec == "raw";
+    if (passthrough) {
+        builder.RegisterCallbackGenericService(&passthroughService);
+    } else if (raw) {
+        // Raw calls always run on the async engine's completion queues
+        builder.RegisterAsyncGenericService(&rawService);
+        int cqCount = options.threads > 0 ? options.threads
+                                          : std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 0; i < cqCount; ++i) {
+            cqs.push_back(builder.AddCompletionQueue());
+        }
+    } else if (options.serverMode == "callback") {
+        if (core.messagePool() != nullptr) {
+            callbackService.SetMessageAllocatorFor_ProcessBenchmark(&recyclingAllocator);
+        }
+        builder.RegisterService(&callbackService);
+    } else if (options.serverMode == "async") {
+        builder.RegisterService(&asyncService);
+        int cqCount = options.threads > 0 ? options.threads
+                                          : std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 0; i < cqCount; ++i) {
+            cqs.push_back(builder.AddCompletionQueue());
+        }
+    } else {
+        builder.RegisterService(&syncService);
+        if (options.threads > 0) {
+            builder.SetSyncServerOption(ServerBuilder::SyncServerOption::NUM_CQS, options.threads);
+            builder.SetSyncServerOption(ServerBuilder::SyncServerOption::MIN_POLLERS, options.threads);
+            builder.SetSyncServerOption(ServerBuilder::SyncServerOption::MAX_POLLERS, options.threads);
+        }
+    }
+
     std::unique_ptr<Server> server(builder.BuildAndStart());
     if (!server) {
         std::cout << "Failed to start server on " << server_address << std::endl;
         return;
     }
-    
-    std::cout << "Benchmark worker server listening on " << server_address;
-    if (!nextWorkerAddress.empty()) {
-        std::cout << " (forwarding to " << nextWorkerAddress << ")";
+
+    std::cout << "Benchmark worker server listening on " << server_address
+              << " (" << (passthrough ? "passthrough forwarding" : raw ? "raw codec" : options.serverMode + " mode");
+    if (!cqs.empty()) {
+        std::cout << ", " << cqs.size() << " completion queues" << (options.pinCpus ? ", pinned" : "");
+    }
+    std::cout << ")";
+    if (!options.nextWorkerAddress.empty()) {
+        std::cout << (core.IsMulticasting() ? " (multicasting to " : " (forwarding to ") << options.nextWorkerAddress
+                  << ")";
     }
     std::cout << std::endl;
 
-    server->Wait();
+    if (options.reportIntervalSec > 0) {
+        std::thread(ReportThroughput, std::cref(core), options.reportIntervalSec).detach();
+    }
+    if (!options.statsFile.empty()) {
+        std::thread(DumpStats, std::ref(core), options.statsFile, options.statsIntervalSec).detach();
+    }
+
+    std::unique_ptr<ShmServer> shmServer;
+    if (options.shm) {
+        try {
+            shmServer = std::make_unique<ShmServer>(core, options);
+        } catch (const std::exception& e) {
+            std::cout << "Failed to create shared-memory segment: " << e.what() << std::endl;
+            return;
+        }
+        std::cout << "Serving shared-memory transport on " << ShmSegmentName(options.port) << std::endl;
+        std::thread([&shmServer]() { shmServer->Run(); }).detach();
+    }
+
+    if (!cqs.empty()) {
+        AsyncServerEngine engine(core, &asyncService, raw ? &rawService : nullptr, std::move(cqs), options.pinCpus,
+                                 options.tuning.busyPollCq);
+        engine.Run();
+    } else {
+        server->Wait();
+    }
 }
 
 int main(int argc, char** argv) {
-    std::string port = "50051";
-    std::string nextWorkerAddress = "";
-    
+    WorkerOptions options;
+
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg == "--port" && i + 1 < argc) {
-            port = argv[++i];
+            options.port = argv[++i];
         } else if (arg == "--forward-to" && i + 1 < argc) {
-            nextWorkerAddress = argv[++i];
+            options.nextWorkerAddress = argv[++i];
+        } else if (arg == "--server-mode" && i + 1 < argc) {
+            options.serverMode = argv[++i];
+        } else if (arg == "--forward-engine" && i + 1 < argc) {
+            options.forwardEngine = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = std::stoi(argv[++i]);
+        } else if (arg == "--pin-cpus") {
+            options.pinCpus = true;
+        } else if (arg == "--cpu-affinity" && i + 1 < argc) {
+            if (!ParseCpuList(argv[++i], &options.placement.cpus)) {
+                std::cout << "Error: --cpu-affinity takes a CPU list such as 0-3,8" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--numa-node" && i + 1 < argc) {
+            options.placement.numaNode = std::stoi(argv[++i]);
+        } else if (arg == "--tuning" && i + 1 < argc) {
+            if (!ParseTuningProfile(argv[++i], &options.tuning)) {
+                std::cout << "Error: --tuning must be 'default', 'low-latency' or 'throughput'" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--report-interval" && i + 1 < argc) {
+            options.reportIntervalSec = std::stoi(argv[++i]);
+        } else if (arg == "--stats-file" && i + 1 < argc) {
+            options.statsFile = argv[++i];
+        } else if (arg == "--stats-interval" && i + 1 < argc) {
+            options.statsIntervalSec = std::stoi(argv[++i]);
+        } else if (arg == "--delay-ms" && i + 1 < argc) {
+            options.delayMs = std::stod(argv[++i]);
+        } else if (arg == "--delay-fraction" && i + 1 < argc) {
+            options.delayFraction = std::stod(argv[++i]);
+        } else if (arg == "--service-time" && i + 1 < argc) {
+            std::string spec = argv[++i];
+            try {
+                if (!ParseServiceTime(spec, &options.serviceTime)) {
+                    std::cout << "Error: --service-time must be const:US, exp:MEAN_US, bimodal:FAST_US,SLOW_US,P, "
+                              << "file:PATH or none" << std::endl;
+                    return 1;
+                }
+            } catch (const std::exception& e) {
+                std::cout << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+        } else if (arg == "--service-work" && i + 1 < argc) {
+            std::string work = argv[++i];
+            if (work != "spin" && work != "sleep") {
+                std::cout << "Error: --service-work must be 'spin' or 'sleep'" << std::endl;
+                return 1;
+            }
+            options.serviceTime.SetWork(work == "spin" ? ServiceTime::Work::kSpin : ServiceTime::Work::kSleep);
+        } else if (arg == "--service-ns-per-byte" && i + 1 < argc) {
+            double nsPerByte = std::stod(argv[++i]);
+            if (nsPerByte < 0.0) {
+                std::cout << "Error: --service-ns-per-byte must be >= 0" << std::endl;
+                return 1;
+            }
+            options.serviceTime.SetNsPerByte(nsPerByte);
+        } else if (arg == "--reuse-buffers") {
+            options.reuseBuffers = true;
+        } else if (arg == "--codec" && i + 1 < argc) {
+            options.codec = argv[++i];
+        } else if (arg == "--shm") {
+            options.shm = true;
+        } else if (arg == "--shm-wait" && i + 1 < argc) {
+            std::string wait = argv[++i];
+            if (wait != "spin" && wait != "futex") {
+                std::cout << "Error: --shm-wait must be 'spin' or 'futex'" << std::endl;
+                return 1;
+            }
+            options.shmWait = wait == "spin" ? ShmWait::kSpin : ShmWait::kFutex;
+        } else if (arg == "--shm-ring-kb" && i + 1 < argc) {
+            options.shmRingBytes = static_cast<size_t>(std::stoul(argv[++i])) * 1024;
+        } else if (arg == "--transport" && i + 1 < argc) {
+            options.transport = argv[++i];
+        } else if (arg == "--tcp-backend" && i + 1 < argc) {
+            options.tcpBackend = argv[++i];
+        } else if (arg == "--tcp-buffer-kb" && i + 1 < argc) {
+            options.tcpBufferBytes = static_cast<size_t>(std::stoul(argv[++i])) * 1024;
+        } else if (arg == "--compression" && i + 1 < argc) {
+            std::string compression = argv[++i];
+            if (compression == "none") {
+                options.compression = GRPC_COMPRESS_NONE;
+            } else if (compression == "deflate") {
+                options.compression = GRPC_COMPRESS_DEFLATE;
+            } else if (compression == "gzip") {
+                options.compression = GRPC_COMPRESS_GZIP;
+            } else {
+                std::cout << "Error: --compression must be 'none', 'deflate' or 'gzip'" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--max-message-mb" && i + 1 < argc) {
+            options.maxMessageMb = std::stoi(argv[++i]);
         } else if (arg == "--help") {
             std::cout << "Usage: " << argv[0] << " [options]\n"
                       << "Options:\n"
-                      << "  --port PORT           Port to listen on (default: 50051)\n"
-                      << "  --forward-to ADDRESS  Forward requests to this worker (for two-hop pattern)\n"
-                      << "  --help                Show this help message\n";
+                      << "  --port PORT                      Port to listen on (default: 50051)\n"
+                      << "  --forward-to ADDRESS[,ADDRESS...]  Forward requests to this worker (for two-hop pattern);\n"
+                      << "                                   with several, multicast to all of them and answer with\n"
+                      << "                                   one aggregated ack (a node of the tree pattern)\n"
+                      << "  --server-mode <sync|callback|async>  Server engine (default: sync)\n"
+                      << "  --forward-engine <passthrough|copy>  How a forwarding worker relays requests (default:\n"
+                      << "                                   passthrough = zero-copy generic proxy; copy = parse and\n"
+                      << "                                   re-send through the --server-mode engine)\n"
+                      << "  --threads N                      sync: polling threads; async: completion queues,\n"
+                      << "                                   one polling thread each (default: gRPC default / #cores)\n"
+                      << "  --pin-cpus                       async: pin each CQ polling thread to its own CPU\n"
+                      << "  --cpu-affinity LIST              Run on these CPUs, e.g. 0-3,8; async CQ pollers are\n"
+                      << "                                   pinned one per CPU of the list (default: any)\n"
+                      << "  --numa-node N                    Allocate memory on NUMA node N, and run on its CPUs\n"
+                      << "                                   unless --cpu-affinity is given (default: none)\n"
+                      << "  --tuning <default|low-latency|throughput>  Named set of gRPC server, socket and CQ\n"
+                      << "                                   polling settings (default: default)\n"
+                      << "  --report-interval SEC            Print completed requests/sec, allocations/request and\n"
+                      << "                                   CPU time/request every SEC seconds\n"
+                      << "  --stats-file PATH                Every --stats-interval seconds, write the worker's counters\n"
+                      << "                                   and arrival/handler/forward percentiles to PATH in the\n"
+                      << "                                   Prometheus text format (the same stats GetStats returns)\n"
+                      << "  --stats-interval SEC             Seconds between --stats-file dumps (default: 10)\n"
+                      << "  --delay-ms MS                    Hold unary requests for MS before answering them, as a\n"
+                      << "                                   slow replica (last worker only; default: 0)\n"
+                      << "  --delay-fraction F               Fraction of requests that are held (default: 1)\n"
+                      << "  --service-time SPEC              Emulated work per answered request, drawn from const:US,\n"
+                      << "                                   exp:MEAN_US, bimodal:FAST_US,SLOW_US,P (SLOW with\n"
+                      << "                                   probability P) or file:PATH of samples in us (default: none)\n"
+                      << "  --service-work <spin|sleep>      spin: burn it as thread CPU time; sleep: block the\n"
+                      << "                                   thread without CPU (default: spin)\n"
+                      << "  --service-ns-per-byte NS         Add NS nanoseconds of service time per payload byte\n"
+                      << "  --reuse-buffers                  callback/async: recycle request/response messages across\n"
+                      << "                                   calls instead of allocating them per request\n"
+                      << "  --codec <proto|raw>              raw: answer ProcessBenchmark with a pre-serialized\n"
+                      << "                                   ByteBuffer on the async engine, never parsing the request\n"
+                      << "  --shm                            Also serve the shared-memory transport for co-located\n"
+                      << "                                   heads (head --transport shm); a forwarding worker relays\n"
+                      << "                                   those requests over shm to --forward-to as well\n"
+                      << "  --shm-wait <spin|futex>          How the shm poller waits for requests (default: futex)\n"
+                      << "  --shm-ring-kb KB                 Size of each shm ring, a power of two (default: 1024)\n"
+                      << "  --transport <grpc|tcp>           tcp: serve length-prefixed frames over raw TCP on --port\n"
+                      << "                                   instead of gRPC, forwarding over TCP too (default: grpc)\n"
+                      << "  --tcp-backend <epoll|uring>      Event loop for --transport tcp (default: epoll)\n"
+                      << "  --tcp-buffer-kb KB               io_uring registered buffer per connection and direction;\n"
+                      << "                                   bounds the frame size (default: 256)\n"
+                      << "  --compression <none|deflate|gzip>  gRPC compression for responses and for requests\n"
+                      << "                                   forwarded to --forward-to; compressed requests are\n"
+                      << "                                   always accepted (default: none)\n"
+                      << "  --max-message-mb MB              Largest gRPC message accepted or sent; raise it for\n"
+                      << "                                   unchunked payloads above 4 MB (default: gRPC's 4 MB)\n"
+                      << "  --help                           Show this help message\n";
             return 0;
         } else if (i == 1 && arg.find("--") != 0) {
             // Backward compatibility: first argument is port
-            port = arg;
+            options.port = arg;
         }
     }
-    
-    std::cout << "Starting benchmark worker node on port " << port;
-    if (!nextWorkerAddress.empty()) {
-        std::cout << " with forwarding to " << nextWorkerAddress;
+
+    if (options.serverMode != "sync" && options.serverMode != "callback" && options.serverMode != "async") {
+        std::cout << "Error: Invalid server mode. Must be 'sync', 'callback', or 'async'" << std::endl;
+        return 1;
+    }
+
+    if (options.statsIntervalSec <= 0) {
+        std::cout << "Error: --stats-interval must be positive" << std::endl;
+        return 1;
+    }
+
+    if (options.codec != "proto" && options.codec != "raw") {
+        std::cout << "Error: Invalid codec. Must be 'proto' or 'raw'" << std::endl;
+        return 1;
+    }
+
+    if ((options.transport != "grpc" && options.transport != "tcp") ||
+        (options.tcpBackend != "epoll" && options.tcpBackend != "uring")) {
+        std::cout << "Error: --transport must be 'grpc' or 'tcp' and --tcp-backend 'epoll' or 'uring'" << std::endl;
+        return 1;
+    }
+
+    if (options.maxMessageMb < 0 || options.maxMessageMb > 2047) {
+        std::cout << "Error: --max-message-mb must be between 0 and 2047" << std::endl;
+        return 1;
+    }
+
+    if (options.forwardEngine != "passthrough" && options.forwardEngine != "copy") {
+        std::cout << "Error: Invalid forward engine. Must be 'passthrough' or 'copy'" << std::endl;
+        return 1;
+    }
+
+    if (options.delayMs < 0.0 || options.delayFraction < 0.0 || options.delayFraction > 1.0) {
+        std::cout << "Error: --delay-ms must be >= 0 and --delay-fraction between 0 and 1" << std::endl;
+        return 1;
+    }
+
+    // Multicast parses every request and response, so it exists only on the gRPC proto path
+    if (BenchmarkCore::SplitAddresses(options.nextWorkerAddress).size() > 1 &&
+        (options.codec == "raw" || options.shm || options.transport == "tcp")) {
+        std::cout << "Error: several --forward-to addresses (tree multicast) cannot be combined with "
+                  << "--codec raw, --shm or --transport tcp" << std::endl;
+        return 1;
+    }
+
+    // Before the first thread is started, so all of them inherit it
+    try {
+        ApplyCpuPlacement(options.placement);
+    } catch (const std::exception& e) {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    if (options.placement.Active()) {
+        options.pinCpus = true;
+    }
+    TcpBusyPollUs() = options.tuning.socketBusyPollUs;
+
+    std::cout << "Starting benchmark worker node on port " << options.port;
+    if (!options.nextWorkerAddress.empty()) {
+        std::cout << " with forwarding to " << options.nextWorkerAddress;
     }
     std::cout << std::endl;
-    
-    RunServer(port, nextWorkerAddress);
-    
+    std::cout << "CPU placement: " << DescribePlacement(options.placement) << std::endl;
+    std::cout << "Tuning: " << options.tuning.Describe() << std::endl;
+    if (options.serviceTime.Active()) {
+        std::cout << "Service time: " << options.serviceTime.Describe() << std::endl;
+    }
+
+    RunServer(options);
+
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+// Wall-clock time in nanoseconds since the Unix epoch. Every timestamp that
+// crosses the wire uses this clock: steady and high-resolution clocks have a
+// per-boot epoch, so their readings cannot be compared between hosts even
+// after offset correction.
+inline int64_t WallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// NTP-style estimate of how far a remote clock runs ahead of a local one, fed
+// by request/response exchanges where the local side stamps send (t1) and
+// receive (t4) and the remote side stamps receive (t2) and send (t3):
+//
+//   offset = ((t2 - t1) + (t3 - t4)) / 2      delay = (t4 - t1) - (t3 - t2)
+//
+// An exchange's offset is off by at most half its delay, and queueing only
+// ever adds delay, so exchanges are grouped into one-second windows and only
+// the lowest-delay one of each is kept. Drift is the least-squares slope of
+// those per-window offsets over the last kMaxWindows windows, and OffsetAt
+// extrapolates along it. All methods are thread-safe.
+class ClockEstimator {
+public:
+    static constexpr int64_t kWindowNs = 1000000000;
+    static constexpr size_t kMaxWindows = 60;
+
+    void AddExchange(int64_t t1, int64_t t2, int64_t t3, int64_t t4) {
+        int64_t delay = (t4 - t1) - (t3 - t2);
+        if (t1 == 0 || t2 == 0 || t3 == 0 || t4 < t1 || t3 < t2 || delay < 0) {
+            return;
+        }
+        Exchange exchange{t1 + (t4 - t1) / 2, ((t2 - t1) + (t3 - t4)) / 2.0, delay};
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++exchanges_;
+        auto inserted = windows_.emplace(exchange.localNs / kWindowNs, exchange);
+        if (!inserted.second) {
+            if (delay >= inserted.first->second.delayNs) {
+                return;
+            }
+            inserted.first->second = exchange;
+        }
+        if (windows_.size() > kMaxWindows) {
+            windows_.erase(windows_.begin());
+        }
+        Refit();
+    }
+
+    bool HasEstimate() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return !windows_.empty();
+    }
+
+    // Remote minus local clock, in ns, at the given local time.
+    double OffsetAt(int64_t localNs) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return offsetNs_ + driftPpm_ * 1e-6 * static_cast<double>(localNs - referenceNs_);
+    }
+
+    double DriftPpm() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return driftPpm_;
+    }
+
+    // Lowest round-trip delay among the retained windows, i.e. the error bound
+    // (times two) of the current offset.
+    int64_t MinDelayNs() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int64_t best = 0;
+        for (const auto& window : windows_) {
+            if (best == 0 || window.second.delayNs < best) {
+                best = window.second.delayNs;
+            }
+        }
+        return best;
+    }
+
+    uint64_t Exchanges() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return exchanges_;
+    }
+
+private:
+    struct Exchange {
+        int64_t localNs;  // midpoint of t1 and t4
+        double offsetNs;
+        int64_t delayNs;
+    };
+
+    // Caller holds mutex_. Fewer than three windows give no usable slope, so
+    // the offset is then simply that of the best exchange.
+    void Refit() {
+        if (windows_.size() < 3) {
+            const Exchange* best = nullptr;
+            for (const auto& window : windows_) {
+                if (best == nullptr || window.second.delayNs < best->delayNs) {
+                    best = &window.second;
+                }
+            }
+            referenceNs_ = best->localNs;
+            offsetNs_ = best->offsetNs;
+            driftPpm_ = 0.0;
+            return;
+        }
+
+        // Regress in seconds relative to the first window to keep the sums well conditioned
+        int64_t originNs = windows_.begin()->second.localNs;
+        double n = static_cast<double>(windows_.size());
+        double sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0;
+        for (const auto& window : windows_) {
+            double x = static_cast<double>(window.second.localNs - originNs) / 1e9;
+            double y = window.second.offsetNs;
+            sumX += x;
+            sumY += y;
+            sumXX += x * x;
+            sumXY += x * y;
+        }
+        double denominator = n * sumXX - sumX * sumX;
+        double slope = denominator > 0.0 ? (n * sumXY - sumX * sumY) / denominator : 0.0;  // ns per s
+        double meanX = sumX / n;
+        referenceNs_ = originNs + static_cast<int64_t>(meanX * 1e9);
+        offsetNs_ = sumY / n;
+        driftPpm_ = slope / 1e3;
+    }
+
+    mutable std::mutex mutex_;
+    std::map<int64_t, Exchange> windows_;  // window index -> lowest-delay exchange
+    uint64_t exchanges_ = 0;
+    int64_t referenceNs_ = 0;
+    double offsetNs_ = 0.0;
+    double driftPpm_ = 0.0;
+};
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// --cpu-affinity / --numa-node for the head and the worker. The placement is
+// applied to the main thread before gRPC or anything else starts a thread, and
+// new threads inherit the memory policy and, through the default thread
+// attributes, the whole CPU set, so gRPC's own pollers and executors stay
+// inside it. Application threads (completion-queue pollers, the head's sender)
+// are then pinned to single CPUs of the set with PinThreadToCpu; threads they
+// start still get the whole set rather than their creator's one CPU.
+struct CpuPlacement {
+    std::vector<int> cpus;  // empty = leave the inherited affinity alone
+    int numaNode = -1;      // memory (and CPUs, without a list) from this node; -1 = none
+
+    bool Active() const { return !cpus.empty() || numaNode >= 0; }
+};
+
+// "0-3,8,10-11" -> 0 1 2 3 8 10 11; false for anything else
+inline bool ParseCpuList(const std::string& text, std::vector<int>* cpus) {
+    cpus->clear();
+    std::stringstream list(text);
+    std::string range;
+    while (std::getline(list, range, ',')) {
+        size_t dash = range.find('-');
+        try {
+            size_t used = 0;
+            int first = std::stoi(range.substr(0, dash), &used);
+            int last = first;
+            if (dash != std::string::npos) {
+                last = std::stoi(range.substr(dash + 1), &used);
+            }
+            if (first < 0 || last < first || last >= CPU_SETSIZE) {
+                return false;
+            }
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus->push_back(cpu);
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    std::sort(cpus->begin(), cpus->end());
+    cpus->erase(std::unique(cpus->begin(), cpus->end()), cpus->end());
+    return !cpus->empty();
+}
+
+// The inverse, compressing runs: 0 1 2 3 8 -> "0-3,8"
+inline std::string FormatCpuList(const std::vector<int>& cpus) {
+    std::string text;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            ++j;
+        }
+        text += (text.empty() ? "" : ",") + std::to_string(cpus[i]);
+        if (j > i) {
+            text += "-" + std::to_string(cpus[j]);
+        }
+        i = j + 1;
+    }
+    return text;
+}
+
+// CPUs of a NUMA node from sysfs; empty if there is no such node
+inline std::vector<int> NumaNodeCpus(int node) {
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string text;
+    std::vector<int> cpus;
+    if (std::getline(file, text)) {
+        ParseCpuList(text, &cpus);
+    }
+    return cpus;
+}
+
+// CPUs the calling thread may run on
+inline std::vector<int> AllowedCpus() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    std::vector<int> cpus;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+// The set PinThreadToCpu picks from, recorded by ApplyCpuPlacement
+inline std::vector<int>& PlacementCpus() {
+    static std::vector<int> cpus;
+    return cpus;
+}
+
+// Call once from main before any thread is started, with or without an active
+// placement. Throws std::runtime_error if a CPU or the node is not available.
+inline void ApplyCpuPlacement(CpuPlacement& placement) {
+    if (placement.numaNode >= 0) {
+        std::vector<int> nodeCpus = NumaNodeCpus(placement.numaNode);
+        if (nodeCpus.empty()) {
+            throw std::runtime_error("no NUMA node " + std::to_string(placement.numaNode));
+        }
+        if (placement.cpus.empty()) {
+            placement.cpus = nodeCpus;
+        }
+        // Preferred rather than bound: allocations fall back to other nodes
+        // instead of failing when the node runs out of memory
+        unsigned long nodeMask[1024 / (8 * sizeof(unsigned long))] = {};
+        if (placement.numaNode >= 1024) {
+            throw std::runtime_error("NUMA node " + std::to_string(placement.numaNode) + " out of range");
+        }
+        nodeMask[placement.numaNode / (8 * sizeof(unsigned long))] |=
+            1ul << (placement.numaNode % (8 * sizeof(unsigned long)));
+        if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, nodeMask, 1024) != 0) {
+            throw std::runtime_error(std::string("set_mempolicy failed: ") + std::strerror(errno));
+        }
+    }
+    if (!placement.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : placement.cpus) {
+            CPU_SET(cpu, &set);
+        }
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            throw std::runtime_error("cannot run on CPUs " + FormatCpuList(placement.cpus) + ": " +
+                                     std::strerror(errno));
+        }
+    }
+
+    PlacementCpus() = AllowedCpus();
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : PlacementCpus()) {
+        CPU_SET(cpu, &set);
+    }
+    pthread_attr_t attributes;
+    if (pthread_getattr_default_np(&attributes) == 0) {
+        pthread_attr_setaffinity_np(&attributes, sizeof(set), &set);
+        pthread_setattr_default_np(&attributes);
+        pthread_attr_destroy(&attributes);
+    }
+}
+
+inline std::string DescribePlacement(const CpuPlacement& placement) {
+    if (!placement.Active()) {
+        return "none";
+    }
+    std::string text = "cpus " + FormatCpuList(placement.cpus);
+    if (placement.numaNode >= 0) {
+        text += ", memory on node " + std::to_string(placement.numaNode);
+    }
+    return text;
+}
+
+// Pins the calling thread to the index-th CPU of the placement.
+inline void PinThreadToCpu(size_t index) {
+    const std::vector<int>& cpus = PlacementCpus();
+    if (cpus.empty()) {
+        return;
+    }
+
+    cpu_set_t target;
+    CPU_ZERO(&target);
+    CPU_SET(cpus[index % cpus.size()], &target);
+    pthread_setaffinity_np(pthread_self(), sizeof(target), &target);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+
+// CPU time consumed so far by the whole process (every thread, user and
+// system), in nanoseconds. Differences over a run give its CPU cost, which,
+// unlike latency, includes work done off the critical path such as
+// compression on gRPC's threads.
+inline uint64_t ProcessCpuNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// CPU time consumed so far by the calling thread, in nanoseconds. It stands
+// still while the thread is preempted or blocked.
+inline uint64_t ThreadCpuNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
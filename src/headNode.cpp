@@ -1,9 +1,14 @@
 #include <iostream>
+#include <iomanip>
 #include <memory>
 #include <string>
 #include <vector>
+#include <deque>
 #include <thread>
-#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <random>
 #include <chrono>
 
 #include <grpcpp/grpcpp.h>
@@ -16,6 +21,13 @@ using grpc::Status;
 using demo::DemoService;
 using demo::Request;
 using demo::Response;
+using demo::BatchRequest;
+using demo::BatchResponse;
+
+struct Task {
+    int jobId;
+    std::string query;
+};
 
 class WorkerClient {
 public:
@@ -44,13 +56,334 @@ public:
         }
     }
 
+    // One ProcessBatch call for all of tasks; results in task order, every
+    // one failed if the call fails.
+    std::vector<std::pair<bool, std::string>> ProcessBatch(const std::vector<Task>& tasks) {
+        BatchRequest request;
+        for (const auto& task : tasks) {
+            Request* job = request.add_requests();
+            job->set_jobid(task.jobId);
+            job->set_query(task.query);
+        }
+
+        BatchResponse response;
+        ClientContext context;
+        context.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(10));
+        Status status = stub_->ProcessBatch(&context, request, &response);
+
+        std::vector<std::pair<bool, std::string>> results;
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            if (!status.ok()) {
+                results.emplace_back(false, "RPC failed: " + status.error_message());
+            } else if (i >= static_cast<size_t>(response.responses_size())) {
+                results.emplace_back(false, "missing from batch response");
+            } else {
+                results.emplace_back(response.responses(i).success(), response.responses(i).result());
+            }
+        }
+        return results;
+    }
+
 private:
     std::unique_ptr<DemoService::Stub> stub_;
 };
 
+// How tasks are placed on the per-worker queues
+enum class Policy {
+    kStatic,            // task i to worker i % N and no stealing (the original distribution)
+    kLeastOutstanding,  // the worker with the fewest queued and in-flight tasks
+    kPowerOfTwo         // the cheaper of two random workers, by queued work times observed latency
+};
+
+struct SchedulerOptions {
+    Policy policy = Policy::kPowerOfTwo;
+    int maxInFlight = 2;      // calls in flight per worker
+    int maxBatch = 1;         // tasks per ProcessBatch call; 1 = one ProcessRequest per task
+    int lingerMs = 2;         // how long a short batch waits for more tasks while they are being submitted
+    double targetBatchMs = 50.0;  // batch latency the adaptive batch size steers towards
+    bool quiet = false;       // no per-job lines
+};
+
+// Per-worker scheduling state, guarded by the scheduler mutex
+struct WorkerLoad {
+    std::deque<Task> queue;
+    int inFlight = 0;
+    double latencyMs = 0.0;  // moving average of time per completed task; 0 until the first
+    int completed = 0;
+    int failed = 0;
+    int stolen = 0;          // tasks this worker took from another worker's queue
+    double busyMs = 0.0;     // time with at least one call in flight
+    std::chrono::steady_clock::time_point busySince;
+    size_t batchLimit = 1;   // adaptive; kept across rounds like latencyMs
+    int batches = 0;
+};
+
+// Dispatches tasks from per-worker queues with a fixed pool of dispatcher
+// threads: maxInFlight per worker, each sending its worker's tasks one call at
+// a time, so in-flight work per worker is capped and the thread count does not
+// grow with the number of tasks. A dispatcher whose own queue is empty steals
+// from the back of the longest other queue, which moves work off slow workers
+// without having to predict which ones are slow.
+//
+// With maxBatch > 1 a call carries up to the worker's batch limit of tasks.
+// The limit starts at 1 and adapts to the latency of the batches sent: it
+// doubles while full batches return within half of targetBatchMs and halves
+// when one takes longer than targetBatchMs.
+class TaskScheduler {
+public:
+    TaskScheduler(std::vector<std::unique_ptr<WorkerClient>>& workers, const std::vector<std::string>& addresses,
+                  const SchedulerOptions& options)
+        : workers_(workers), addresses_(addresses), options_(options), loads_(workers.size()), rng_(42) {
+        for (size_t i = 0; i < workers_.size() * options_.maxInFlight; ++i) {
+            dispatchers_.emplace_back([this, i]() { Dispatch(i % workers_.size()); });
+        }
+    }
+
+    ~TaskScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        workCv_.notify_all();
+        for (auto& dispatcher : dispatchers_) {
+            dispatcher.join();
+        }
+    }
+
+    // Submits the tasks one by one, as a stream of arriving work that the
+    // dispatchers start on right away, waits for all of them and returns the
+    // makespan in ms.
+    double Run(const std::vector<Task>& tasks) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto& load : loads_) {
+                load.completed = load.failed = load.stolen = load.batches = 0;
+                load.busyMs = 0.0;
+            }
+            roundStart_ = std::chrono::steady_clock::now();
+            remaining_ = tasks.size();
+            submitting_ = true;
+        }
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                loads_[Place(i)].queue.push_back(tasks[i]);
+            }
+            workCv_.notify_all();
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        submitting_ = false;
+        workCv_.notify_all();
+        doneCv_.wait(lock, [this]() { return remaining_ == 0; });
+        return ElapsedMs(roundStart_);
+    }
+
+    void PrintRound(double makespanMs) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int completed = 0;
+        for (const auto& load : loads_) {
+            completed += load.completed;
+        }
+        std::cout << "Makespan: " << std::fixed << std::setprecision(1) << makespanMs << "ms, "
+                  << std::setprecision(0) << (makespanMs > 0.0 ? completed * 1000.0 / makespanMs : 0.0)
+                  << " tasks/s" << std::endl;
+        for (size_t i = 0; i < loads_.size(); ++i) {
+            const WorkerLoad& load = loads_[i];
+            std::cout << "  " << addresses_[i] << ": " << load.completed << " tasks (" << load.stolen << " stolen, "
+                      << load.failed << " failed), " << std::setprecision(2) << load.latencyMs
+                      << "ms per task, " << std::setprecision(0)
+                      << (makespanMs > 0.0 ? 100.0 * load.busyMs / makespanMs : 0.0) << "% utilized";
+            if (options_.maxBatch > 1 && load.batches > 0) {
+                std::cout << ", " << load.batches << " batches (mean " << std::setprecision(1)
+                          << static_cast<double>(load.completed + load.failed) / load.batches << ", limit now "
+                          << load.batchLimit << ")";
+            }
+            std::cout << std::endl;
+        }
+    }
+
+private:
+    static double ElapsedMs(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    }
+
+    // Expected time for a worker to get through what it already has plus one
+    // more task. Workers not yet observed count as the fastest seen so far.
+    double Cost(size_t worker) const {
+        double fastest = 0.0;
+        for (const auto& load : loads_) {
+            if (load.latencyMs > 0.0 && (fastest == 0.0 || load.latencyMs < fastest)) {
+                fastest = load.latencyMs;
+            }
+        }
+        const WorkerLoad& load = loads_[worker];
+        double latency = load.latencyMs > 0.0 ? load.latencyMs : (fastest > 0.0 ? fastest : 1.0);
+        return (load.queue.size() + load.inFlight + 1) * latency;
+    }
+
+    size_t Place(size_t taskIndex) {
+        size_t count = loads_.size();
+        if (options_.policy == Policy::kStatic || count == 1) {
+            return taskIndex % count;
+        }
+        if (options_.policy == Policy::kLeastOutstanding) {
+            // Scan from the next in turn so ties still rotate
+            size_t best = taskIndex % count;
+            for (size_t i = 1; i < count; ++i) {
+                size_t candidate = (taskIndex + i) % count;
+                if (loads_[candidate].queue.size() + loads_[candidate].inFlight <
+                    loads_[best].queue.size() + loads_[best].inFlight) {
+                    best = candidate;
+                }
+            }
+            return best;
+        }
+        std::uniform_int_distribution<size_t> pick(0, count - 1);
+        size_t first = pick(rng_);
+        size_t second = pick(rng_);
+        while (second == first) {
+            second = pick(rng_);
+        }
+        return Cost(second) < Cost(first) ? second : first;
+    }
+
+    // Longest queue other than the thief's, or the thief itself if none has work
+    size_t Victim(size_t thief) const {
+        size_t victim = thief;
+        for (size_t i = 0; i < loads_.size(); ++i) {
+            if (i != thief && !loads_[i].queue.empty() &&
+                (victim == thief || loads_[i].queue.size() > loads_[victim].queue.size())) {
+                victim = i;
+            }
+        }
+        return victim;
+    }
+
+    // Up to the worker's batch limit from the front of its own queue or, if
+    // that is empty, up to half of the longest other queue from its back.
+    std::vector<Task> TakeBatch(size_t worker, bool steal) {
+        WorkerLoad& load = loads_[worker];
+        std::vector<Task> batch;
+        if (!load.queue.empty()) {
+            while (!load.queue.empty() && batch.size() < load.batchLimit) {
+                batch.push_back(std::move(load.queue.front()));
+                load.queue.pop_front();
+            }
+        } else if (steal && Victim(worker) != worker) {
+            WorkerLoad& victim = loads_[Victim(worker)];
+            size_t take = std::min(load.batchLimit, (victim.queue.size() + 1) / 2);
+            while (batch.size() < take) {
+                batch.push_back(std::move(victim.queue.back()));
+                victim.queue.pop_back();
+            }
+            load.stolen += static_cast<int>(batch.size());
+        }
+        return batch;
+    }
+
+    void AdaptBatchLimit(WorkerLoad& load, size_t batchSize, double latencyMs) {
+        if (latencyMs > options_.targetBatchMs) {
+            load.batchLimit = std::max<size_t>(1, load.batchLimit / 2);
+        } else if (batchSize == load.batchLimit && latencyMs < options_.targetBatchMs / 2) {
+            load.batchLimit = std::min<size_t>(options_.maxBatch, load.batchLimit * 2);
+        }
+    }
+
+    void Dispatch(size_t worker) {
+        bool steal = options_.policy != Policy::kStatic;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            workCv_.wait(lock, [&]() {
+                return stopping_ || !loads_[worker].queue.empty() || (steal && Victim(worker) != worker);
+            });
+            if (stopping_) {
+                return;
+            }
+
+            WorkerLoad& load = loads_[worker];
+            // A short batch lingers for more tasks while they are still arriving
+            if (!load.queue.empty() && load.queue.size() < load.batchLimit && submitting_) {
+                workCv_.wait_for(lock, std::chrono::milliseconds(options_.lingerMs), [&]() {
+                    return stopping_ || !submitting_ || load.queue.size() >= load.batchLimit;
+                });
+                if (stopping_) {
+                    return;
+                }
+            }
+            std::vector<Task> batch = TakeBatch(worker, steal);
+            if (batch.empty()) {
+                continue;
+            }
+            if (load.inFlight++ == 0) {
+                load.busySince = std::chrono::steady_clock::now();
+            }
+            if (!options_.quiet) {
+                if (batch.size() == 1) {
+                    std::cout << "Sending job " << batch[0].jobId << " to worker " << addresses_[worker] << ": "
+                              << batch[0].query << std::endl;
+                } else {
+                    std::cout << "Sending jobs " << batch.front().jobId << ".." << batch.back().jobId
+                              << " (batch of " << batch.size() << ") to worker " << addresses_[worker] << std::endl;
+                }
+            }
+            lock.unlock();
+
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::pair<bool, std::string>> results;
+            if (options_.maxBatch == 1) {
+                results.push_back(workers_[worker]->ProcessRequest(batch[0].jobId, batch[0].query));
+            } else {
+                results = workers_[worker]->ProcessBatch(batch);
+            }
+            double latencyMs = ElapsedMs(start);
+
+            lock.lock();
+            if (--load.inFlight == 0) {
+                load.busyMs += ElapsedMs(std::max(load.busySince, roundStart_));
+            }
+            ++load.batches;
+            AdaptBatchLimit(load, batch.size(), latencyMs);
+            double perTaskMs = latencyMs / batch.size();
+            for (size_t i = 0; i < batch.size(); ++i) {
+                if (results[i].first) {
+                    ++load.completed;
+                    load.latencyMs = load.latencyMs == 0.0 ? perTaskMs : 0.8 * load.latencyMs + 0.2 * perTaskMs;
+                    if (!options_.quiet) {
+                        std::cout << "✓ Job " << batch[i].jobId << " completed in " << std::fixed
+                                  << std::setprecision(0) << latencyMs << "ms: " << results[i].second << std::endl;
+                    }
+                } else {
+                    ++load.failed;
+                    std::cout << "✗ Job " << batch[i].jobId << " failed: " << results[i].second << std::endl;
+                }
+            }
+            remaining_ -= batch.size();
+            if (remaining_ == 0) {
+                doneCv_.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<WorkerClient>>& workers_;
+    const std::vector<std::string>& addresses_;
+    SchedulerOptions options_;
+    std::vector<WorkerLoad> loads_;
+    std::mt19937 rng_;
+    mutable std::mutex mutex_;
+    std::condition_variable workCv_;
+    std::condition_variable doneCv_;
+    size_t remaining_ = 0;
+    bool submitting_ = false;
+    bool stopping_ = false;
+    std::chrono::steady_clock::time_point roundStart_;
+    std::vector<std::thread> dispatchers_;
+};
+
 class HeadNode {
 public:
-    HeadNode() : jobCounter_(0) {}
+    explicit HeadNode(const SchedulerOptions& options = SchedulerOptions())
+        : jobCounter_(0), options_(options) {}
 
     void AddWorker(const std::string& address) {
         auto channel = grpc::CreateChannel(address, grpc::InsecureChannelCredentials());
@@ -68,44 +401,22 @@ public:
         std::cout << "\n=== Distributing " << tasks.size() << " tasks to " 
                   << workers_.size() << " workers ===" << std::endl;
 
-        std::vector<std::future<void>> futures;
-
-        for (size_t i = 0; i < tasks.size(); ++i) {
-            int workerIndex = i % workers_.size();
-            int jobId = ++jobCounter_;
-            
-            auto future = std::async(std::launch::async, [this, workerIndex, jobId, &tasks, i]() {
-                auto start = std::chrono::high_resolution_clock::now();
-                
-                std::cout << "Sending job " << jobId << " to worker " 
-                          << workerAddresses_[workerIndex] << ": " << tasks[i] << std::endl;
-                
-                auto result = workers_[workerIndex]->ProcessRequest(jobId, tasks[i]);
-                
-                auto end = std::chrono::high_resolution_clock::now();
-                auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-                
-                if (result.first) {
-                    std::cout << "✓ Job " << jobId << " completed in " << duration.count() 
-                              << "ms: " << result.second << std::endl;
-                } else {
-                    std::cout << "✗ Job " << jobId << " failed: " << result.second << std::endl;
-                }
-            });
-            
-            futures.push_back(std::move(future));
+        // Started on first use, so the latency estimates carry over between rounds
+        if (!scheduler_) {
+            scheduler_ = std::make_unique<TaskScheduler>(workers_, workerAddresses_, options_);
         }
-
-        // Wait for all tasks to complete
-        for (auto& future : futures) {
-            future.wait();
+        std::vector<Task> jobs;
+        for (const auto& query : tasks) {
+            jobs.push_back({++jobCounter_, query});
         }
+        double makespanMs = scheduler_->Run(jobs);
 
         std::cout << "\n=== All tasks completed ===" << std::endl;
+        scheduler_->PrintRound(makespanMs);
     }
 
-    void RunDemo() {
-        std::vector<std::string> tasks = {
+    void RunDemo(int taskCount = 8, int rounds = 3) {
+        std::vector<std::string> samples = {
             "Calculate fibonacci(20)",
             "Sort array [5,2,8,1,9]",
             "Find prime numbers up to 100",
@@ -115,39 +426,114 @@ public:
             "Validate email addresses",
             "Compress text data"
         };
+        std::vector<std::string> tasks;
+        for (int i = 0; i < taskCount; ++i) {
+            tasks.push_back(samples[i % samples.size()]);
+        }
 
         std::cout << "Head Node starting demo with " << workers_.size() << " workers" << std::endl;
         
         // Run multiple rounds of work distribution
-        for (int round = 1; round <= 3; ++round) {
+        for (int round = 1; round <= rounds; ++round) {
             std::cout << "\n--- Round " << round << " ---" << std::endl;
             DistributeWork(tasks);
             
-            if (round < 3) {
+            if (round < rounds) {
                 std::cout << "Waiting 2 seconds before next round...\n" << std::endl;
                 std::this_thread::sleep_for(std::chrono::seconds(2));
             }
         }
+        scheduler_.reset();
     }
 
 private:
     std::vector<std::unique_ptr<WorkerClient>> workers_;
     std::vector<std::string> workerAddresses_;
     std::atomic<int> jobCounter_;
+    SchedulerOptions options_;
+    std::unique_ptr<TaskScheduler> scheduler_;
 };
 
 int main(int argc, char** argv) {
-    HeadNode headNode;
-
     std::vector<std::string> defaultWorkers = {
         "localhost:50051",
         "localhost:50052", 
         "localhost:50053"
     };
 
-    if (argc > 1) {
-        for (int i = 1; i < argc; ++i) {
-            headNode.AddWorker(argv[i]);
+    std::string policyName = "p2c";
+    SchedulerOptions options;
+    int taskCount = 8;
+    int rounds = 3;
+    std::vector<std::string> addresses;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--policy" && i + 1 < argc) {
+            policyName = argv[++i];
+        } else if (arg == "--max-inflight" && i + 1 < argc) {
+            options.maxInFlight = std::stoi(argv[++i]);
+        } else if (arg == "--batch-max" && i + 1 < argc) {
+            options.maxBatch = std::stoi(argv[++i]);
+        } else if (arg == "--linger-ms" && i + 1 < argc) {
+            options.lingerMs = std::stoi(argv[++i]);
+        } else if (arg == "--batch-target-ms" && i + 1 < argc) {
+            options.targetBatchMs = std::stod(argv[++i]);
+        } else if (arg == "--quiet") {
+            options.quiet = true;
+        } else if (arg == "--tasks" && i + 1 < argc) {
+            taskCount = std::stoi(argv[++i]);
+        } else if (arg == "--rounds" && i + 1 < argc) {
+            rounds = std::stoi(argv[++i]);
+        } else if (arg == "--help") {
+            std::cout << "Usage: " << argv[0] << " [options] [worker_addresses...]\n"
+                      << "Options:\n"
+                      << "  --policy <static|least-outstanding|p2c>  How tasks are placed on the per-worker\n"
+                      << "                                 queues; static is round-robin without work stealing\n"
+                      << "                                 (default: p2c)\n"
+                      << "  --max-inflight N               Calls in flight per worker (default: 2)\n"
+                      << "  --batch-max N                  Send up to N tasks per ProcessBatch call; the batch\n"
+                      << "                                 size adapts to latency (default: 1, unbatched)\n"
+                      << "  --linger-ms MS                 How long a short batch waits for more tasks while the\n"
+                      << "                                 round is being submitted (default: 2)\n"
+                      << "  --batch-target-ms MS           Batch latency the batch size steers towards (default: 50)\n"
+                      << "  --quiet                        Only print round summaries and failures\n"
+                      << "  --tasks N                      Tasks per round (default: 8)\n"
+                      << "  --rounds N                     Rounds (default: 3)\n"
+                      << "  --help                         Show this help\n"
+                      << std::endl;
+            return 0;
+        } else {
+            addresses.push_back(arg);
+        }
+    }
+
+    if (policyName == "static") {
+        options.policy = Policy::kStatic;
+    } else if (policyName == "least-outstanding") {
+        options.policy = Policy::kLeastOutstanding;
+    } else if (policyName == "p2c") {
+        options.policy = Policy::kPowerOfTwo;
+    } else {
+        std::cout << "Error: --policy must be 'static', 'least-outstanding' or 'p2c'" << std::endl;
+        return 1;
+    }
+    if (options.maxInFlight <= 0 || options.maxBatch <= 0 || options.lingerMs < 0 || options.targetBatchMs <= 0.0 ||
+        taskCount <= 0 || rounds <= 0) {
+        std::cout << "Error: --max-inflight, --batch-max, --batch-target-ms, --tasks and --rounds must be > 0 "
+                  << "and --linger-ms >= 0" << std::endl;
+        return 1;
+    }
+
+    HeadNode headNode(options);
+    std::cout << "Scheduling: " << policyName << ", " << options.maxInFlight << " in flight per worker" << std::endl;
+    if (options.maxBatch > 1) {
+        std::cout << "Batching: up to " << options.maxBatch << " tasks per call, " << options.lingerMs
+                  << "ms linger, " << options.targetBatchMs << "ms target batch latency" << std::endl;
+    }
+
+    if (!addresses.empty()) {
+        for (const auto& address : addresses) {
+            headNode.AddWorker(address);
         }
     } else {
         std::cout << "Using default worker addresses:" << std::endl;
@@ -159,7 +545,7 @@ int main(int argc, char** argv) {
     std::cout << "\nWaiting 2 seconds for workers to start..." << std::endl;
     std::this_thread::sleep_for(std::chrono::seconds(2));
 
-    headNode.RunDemo();
+    headNode.RunDemo(taskCount, rounds);
 
     return 0;
 }
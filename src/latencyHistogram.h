@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Fixed-memory, log-bucketed latency histogram in the spirit of HdrHistogram.
+//
+// Values (nanoseconds) below 2^kSubBucketBits are counted exactly. Above that,
+// every power-of-two range is split into 2^(kSubBucketBits-1) linear
+// sub-buckets, so any recorded value is reported within 1/64 (~1.6%) of its
+// true value. The tracked range tops out at kMaxTrackableNs; larger values are
+// clamped into the last bucket. Record() only touches atomics and is safe to
+// call from any number of threads concurrently.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 7;
+    static constexpr uint64_t kSubBucketHalf = 1ull << (kSubBucketBits - 1);
+    static constexpr uint64_t kMaxTrackableNs = (1ull << 36) - 1;  // ~68.7s, beyond the 30s RPC deadline
+    static constexpr size_t kBucketCount = (36 - kSubBucketBits) * kSubBucketHalf + kSubBucketHalf * 2;
+
+    LatencyHistogram() { Reset(); }
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void Record(uint64_t valueNs) {
+        valueNs = std::min(valueNs, kMaxTrackableNs);
+        counts_[IndexOf(valueNs)].fetch_add(1, std::memory_order_relaxed);
+        totalCount_.fetch_add(1, std::memory_order_relaxed);
+        sumNs_.fetch_add(valueNs, std::memory_order_relaxed);
+
+        uint64_t seen = maxNs_.load(std::memory_order_relaxed);
+        while (valueNs > seen && !maxNs_.compare_exchange_weak(seen, valueNs, std::memory_order_relaxed)) {
+        }
+        seen = minNs_.load(std::memory_order_relaxed);
+        while (valueNs < seen && !minNs_.compare_exchange_weak(seen, valueNs, std::memory_order_relaxed)) {
+        }
+    }
+
+    void RecordMs(double valueMs) {
+        Record(valueMs <= 0.0 ? 0 : static_cast<uint64_t>(valueMs * 1000000.0));
+    }
+
+    void Merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            uint64_t c = other.counts_[i].load(std::memory_order_relaxed);
+            if (c != 0) {
+                counts_[i].fetch_add(c, std::memory_order_relaxed);
+            }
+        }
+        totalCount_.fetch_add(other.TotalCount(), std::memory_order_relaxed);
+        sumNs_.fetch_add(other.sumNs_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        if (other.TotalCount() > 0) {
+            maxNs_.store(std::max(MaxNs(), other.MaxNs()), std::memory_order_relaxed);
+            minNs_.store(std::min(minNs_.load(std::memory_order_relaxed), other.MinNs()), std::memory_order_relaxed);
+        }
+    }
+
+    void Reset() {
+        for (auto& c : counts_) {
+            c.store(0, std::memory_order_relaxed);
+        }
+        totalCount_.store(0, std::memory_order_relaxed);
+        sumNs_.store(0, std::memory_order_relaxed);
+        maxNs_.store(0, std::memory_order_relaxed);
+        minNs_.store(UINT64_MAX, std::memory_order_relaxed);
+    }
+
+    uint64_t TotalCount() const { return totalCount_.load(std::memory_order_relaxed); }
+    uint64_t MaxNs() const { return maxNs_.load(std::memory_order_relaxed); }
+    uint64_t MinNs() const { return TotalCount() == 0 ? 0 : minNs_.load(std::memory_order_relaxed); }
+
+    double MeanNs() const {
+        uint64_t n = TotalCount();
+        return n == 0 ? 0.0 : static_cast<double>(sumNs_.load(std::memory_order_relaxed)) / n;
+    }
+
+    // Highest value equivalent to the sample at the given percentile (0-100].
+    uint64_t ValueAtPercentile(double percentile) const {
+        uint64_t total = TotalCount();
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t target = static_cast<uint64_t>(percentile / 100.0 * total + 0.5);
+        target = std::max<uint64_t>(1, std::min(target, total));
+
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            cumulative += counts_[i].load(std::memory_order_relaxed);
+            if (cumulative >= target) {
+                return std::min(HighestEquivalentValue(i), MaxNs());
+            }
+        }
+        return MaxNs();
+    }
+
+    double ValueAtPercentileMs(double percentile) const { return ValueAtPercentile(percentile) / 1000000.0; }
+    double MaxMs() const { return MaxNs() / 1000000.0; }
+    double MeanMs() const { return MeanNs() / 1000000.0; }
+
+    // Text form: a header line followed by "index count" for every non-empty
+    // bucket. Files written by different runs or hosts can be merged bucket by
+    // bucket (see analysis/merge_histograms.py).
+    void Write(std::ostream& out, const std::string& label) const {
+        out << "histogram " << label << " subBucketBits=" << kSubBucketBits
+            << " count=" << TotalCount()
+            << " min=" << MinNs()
+            << " max=" << MaxNs()
+            << " sum=" << sumNs_.load(std::memory_order_relaxed) << "\n";
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            uint64_t c = counts_[i].load(std::memory_order_relaxed);
+            if (c != 0) {
+                out << i << " " << c << "\n";
+            }
+        }
+        out << "end\n";
+    }
+
+    static size_t IndexOf(uint64_t valueNs) {
+        if (valueNs < (kSubBucketHalf << 1)) {
+            return static_cast<size_t>(valueNs);
+        }
+        int msb = 63 - __builtin_clzll(valueNs);
+        int shift = msb - (kSubBucketBits - 1);
+        return static_cast<size_t>(shift) * kSubBucketHalf + static_cast<size_t>(valueNs >> shift);
+    }
+
+    static uint64_t LowestEquivalentValue(size_t index) {
+        if (index < (kSubBucketHalf << 1)) {
+            return index;
+        }
+        uint64_t shift = index / kSubBucketHalf - 1;
+        uint64_t mantissa = index - shift * kSubBucketHalf;
+        return mantissa << shift;
+    }
+
+    static uint64_t HighestEquivalentValue(size_t index) {
+        if (index < (kSubBucketHalf << 1)) {
+            return index;
+        }
+        uint64_t shift = index / kSubBucketHalf - 1;
+        uint64_t mantissa = index - shift * kSubBucketHalf;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, kBucketCount> counts_;
+    std::atomic<uint64_t> totalCount_;
+    std::atomic<uint64_t> sumNs_;
+    std::atomic<uint64_t> maxNs_;
+    std::atomic<uint64_t> minNs_;
+};
@@ -0,0 +1,358 @@
+#include <sys/stat.h>
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <google/protobuf/arena.h>
+#include <google/protobuf/stubs/common.h>
+#include <grpcpp/grpcpp.h>
+#include "build/benchmark.pb.h"
+#include "build/benchmark.grpc.pb.h"
+#include "src/allocationCounter.h"
+#include "src/payloadGenerator.h"
+
+// Machine-local microbenchmarks of the request path's building blocks, so a
+// regression in encoding or in the gRPC round-trip shows up in seconds rather
+// than in the next cluster sweep:
+//
+//   BuildSerialize*/Parse*  protobuf cost of BenchmarkRequest by payload size
+//                           and of BenchmarkResponse by number of hops, with
+//                           the message on the heap or on an Arena whose first
+//                           block is on the stack (as the head's --reuse-buffers)
+//   UnaryRoundTrip          one ProcessBenchmark call, sync stub
+//   StreamRoundTrip         one request/response on a long-lived bidi stream
+//
+// Round-trips go to a minimal in-process echo service over either
+// Server::InProcessChannel (no sockets: the cost of gRPC itself) or a
+// loopback TCP channel (plus the kernel and HTTP/2 framing). Results go to
+// csvfiles/microbench.json unless --benchmark_out is given; compare runs with
+// analysis/compare_microbench.py.
+
+using benchmark::BenchmarkRequest;
+using benchmark::BenchmarkResponse;
+using benchmark::BenchmarkService;
+using benchmark::HopTimestamps;
+
+namespace {
+
+constexpr int64_t kMaxPayloadBytes = 1 << 20;
+constexpr size_t kAckBytes = 512;
+
+PayloadGenerator& Payloads() {
+    static PayloadGenerator generator;
+    return generator;
+}
+
+const std::string& AckData() {
+    static const std::string ack = [] {
+        std::string data(kAckBytes, '\0');
+        for (size_t i = 0; i < kAckBytes; ++i) {
+            data[i] = static_cast<char>('A' + (i % 26));
+        }
+        return data;
+    }();
+    return ack;
+}
+
+void FillRequest(BenchmarkRequest* request, int64_t payloadSize, uint64_t sequence) {
+    std::string_view payload = Payloads().Payload(static_cast<size_t>(payloadSize), sequence);
+    request->set_requestid(static_cast<int32_t>(sequence));
+    request->mutable_payload()->assign(payload.data(), payload.size());
+    request->set_timestamp(1700000000000000000 + static_cast<int64_t>(sequence));
+}
+
+// A worker's answer with hops entries, as the last worker of a chain of that length builds it
+void FillResponse(BenchmarkResponse* response, int64_t hops, uint64_t sequence) {
+    int64_t now = 1700000000000000000 + static_cast<int64_t>(sequence);
+    response->set_requestid(static_cast<int32_t>(sequence));
+    response->set_acknowledgement(AckData());
+    response->set_requesttimestamp(now);
+    response->set_responsetimestamp(now + 1000);
+    response->set_success(true);
+    for (int64_t i = 0; i < hops; ++i) {
+        HopTimestamps* hop = response->add_hops();
+        hop->set_receivetimestamp(now + i);
+        if (i + 1 < hops) {
+            hop->set_forwardsendtimestamp(now + i + 10);
+            hop->set_forwardreceivetimestamp(now + i + 20);
+        }
+        hop->set_sendtimestamp(now + i + 30);
+    }
+}
+
+// Heap allocations per iteration, from the global operator new counter
+class AllocationsPerIteration {
+public:
+    AllocationsPerIteration() : start_(AllocationCounter::Count()) {}
+
+    void Report(benchmark::State& state) const {
+        state.counters["allocs"] = benchmark::Counter(static_cast<double>(AllocationCounter::Count() - start_),
+                                                      benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    uint64_t start_;
+};
+
+// Same first-block size as the head's ResponseSlot
+constexpr size_t kArenaBlockBytes = 2048;
+
+template <typename Message, typename Fill>
+void BuildSerialize(benchmark::State& state, bool arena, Fill fill) {
+    std::string wire;
+    uint64_t sequence = 0;
+    AllocationsPerIteration allocations;
+    for (auto _ : state) {
+        if (arena) {
+            alignas(8) char block[kArenaBlockBytes];
+            google::protobuf::Arena messageArena(block, sizeof(block));
+            Message* message = google::protobuf::Arena::CreateMessage<Message>(&messageArena);
+            fill(message, state.range(0), sequence++);
+            message->SerializeToString(&wire);
+        } else {
+            Message message;
+            fill(&message, state.range(0), sequence++);
+            message.SerializeToString(&wire);
+        }
+        benchmark::DoNotOptimize(wire.data());
+    }
+    allocations.Report(state);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(wire.size()));
+}
+
+template <typename Message, typename Fill>
+void Parse(benchmark::State& state, bool arena, Fill fill) {
+    std::string wire;
+    {
+        Message message;
+        fill(&message, state.range(0), 0);
+        message.SerializeToString(&wire);
+    }
+    AllocationsPerIteration allocations;
+    for (auto _ : state) {
+        if (arena) {
+            alignas(8) char block[kArenaBlockBytes];
+            google::protobuf::Arena messageArena(block, sizeof(block));
+            Message* message = google::protobuf::Arena::CreateMessage<Message>(&messageArena);
+            benchmark::DoNotOptimize(message->ParseFromString(wire));
+        } else {
+            Message message;
+            benchmark::DoNotOptimize(message.ParseFromString(wire));
+        }
+    }
+    allocations.Report(state);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(wire.size()));
+}
+
+void BM_BuildSerializeRequest(benchmark::State& state, bool arena) {
+    BuildSerialize<BenchmarkRequest>(state, arena, FillRequest);
+}
+
+void BM_ParseRequest(benchmark::State& state, bool arena) {
+    Parse<BenchmarkRequest>(state, arena, FillRequest);
+}
+
+void BM_BuildSerializeResponse(benchmark::State& state, bool arena) {
+    BuildSerialize<BenchmarkResponse>(state, arena, FillResponse);
+}
+
+void BM_ParseResponse(benchmark::State& state, bool arena) {
+    Parse<BenchmarkResponse>(state, arena, FillResponse);
+}
+
+// The worker's acknowledgement without its stats, timing or forwarding, so
+// a round-trip measures gRPC and protobuf only
+class EchoService final : public BenchmarkService::Service {
+public:
+    grpc::Status ProcessBenchmark(grpc::ServerContext*, const BenchmarkRequest* request,
+                                  BenchmarkResponse* response) override {
+        Acknowledge(*request, response);
+        return grpc::Status::OK;
+    }
+
+    grpc::Status ProcessBenchmarkStream(
+        grpc::ServerContext*, grpc::ServerReaderWriter<BenchmarkResponse, BenchmarkRequest>* stream) override {
+        BenchmarkRequest request;
+        BenchmarkResponse response;
+        while (stream->Read(&request)) {
+            Acknowledge(request, &response);
+            if (!stream->Write(response)) {
+                break;
+            }
+        }
+        return grpc::Status::OK;
+    }
+
+private:
+    static void Acknowledge(const BenchmarkRequest& request, BenchmarkResponse* response) {
+        response->set_requestid(request.requestid());
+        response->set_acknowledgement(AckData());
+        response->set_requesttimestamp(request.timestamp());
+        response->set_success(true);
+    }
+};
+
+enum class Transport { kInProcess, kLoopbackTcp };
+
+// One echo server for the whole run, listening on an ephemeral loopback port
+class EchoServer {
+public:
+    static EchoServer& Get() {
+        static EchoServer server;
+        return server;
+    }
+
+    std::shared_ptr<grpc::Channel> Channel(Transport transport) {
+        grpc::ChannelArguments args;
+        args.SetMaxReceiveMessageSize(kMaxMessageBytes);
+        args.SetMaxSendMessageSize(kMaxMessageBytes);
+        if (transport == Transport::kInProcess) {
+            return server_->InProcessChannel(args);
+        }
+        return grpc::CreateCustomChannel("127.0.0.1:" + std::to_string(port_), grpc::InsecureChannelCredentials(),
+                                         args);
+    }
+
+private:
+    static constexpr int kMaxMessageBytes = 4 * kMaxPayloadBytes;
+
+    EchoServer() {
+        grpc::ServerBuilder builder;
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port_);
+        builder.SetMaxReceiveMessageSize(kMaxMessageBytes);
+        builder.SetMaxSendMessageSize(kMaxMessageBytes);
+        builder.RegisterService(&service_);
+        server_ = builder.BuildAndStart();
+        if (!server_ || port_ == 0) {
+            std::cerr << "Failed to start the loopback echo server" << std::endl;
+            std::exit(1);
+        }
+    }
+
+    EchoService service_;
+    std::unique_ptr<grpc::Server> server_;
+    int port_ = 0;
+};
+
+void BM_UnaryRoundTrip(benchmark::State& state, Transport transport) {
+    auto stub = BenchmarkService::NewStub(EchoServer::Get().Channel(transport));
+    BenchmarkRequest request;
+    BenchmarkResponse response;
+    uint64_t sequence = 0;
+    AllocationsPerIteration allocations;
+    for (auto _ : state) {
+        FillRequest(&request, state.range(0), sequence++);
+        grpc::ClientContext context;
+        grpc::Status status = stub->ProcessBenchmark(&context, request, &response);
+        if (!status.ok()) {
+            state.SkipWithError(status.error_message().c_str());
+            break;
+        }
+    }
+    allocations.Report(state);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+void BM_StreamRoundTrip(benchmark::State& state, Transport transport) {
+    auto stub = BenchmarkService::NewStub(EchoServer::Get().Channel(transport));
+    grpc::ClientContext context;
+    auto stream = stub->ProcessBenchmarkStream(&context);
+    BenchmarkRequest request;
+    BenchmarkResponse response;
+    uint64_t sequence = 0;
+    AllocationsPerIteration allocations;
+    for (auto _ : state) {
+        FillRequest(&request, state.range(0), sequence++);
+        if (!stream->Write(request) || !stream->Read(&response)) {
+            state.SkipWithError("stream broken");
+            break;
+        }
+    }
+    allocations.Report(state);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    stream->WritesDone();
+    stream->Finish();
+}
+
+}  // namespace
+
+// Payload sizes 16 B to 1 MB, x16 apart; responses by hop count
+BENCHMARK_CAPTURE(BM_BuildSerializeRequest, heap, false)->RangeMultiplier(16)->Range(16, kMaxPayloadBytes);
+BENCHMARK_CAPTURE(BM_BuildSerializeRequest, arena, true)->RangeMultiplier(16)->Range(16, kMaxPayloadBytes);
+BENCHMARK_CAPTURE(BM_ParseRequest, heap, false)->RangeMultiplier(16)->Range(16, kMaxPayloadBytes);
+BENCHMARK_CAPTURE(BM_ParseRequest, arena, true)->RangeMultiplier(16)->Range(16, kMaxPayloadBytes);
+BENCHMARK_CAPTURE(BM_BuildSerializeResponse, heap, false)->Arg(0)->Arg(1)->Arg(2)->Arg(8);
+BENCHMARK_CAPTURE(BM_BuildSerializeResponse, arena, true)->Arg(0)->Arg(1)->Arg(2)->Arg(8);
+BENCHMARK_CAPTURE(BM_ParseResponse, heap, false)->Arg(0)->Arg(1)->Arg(2)->Arg(8);
+BENCHMARK_CAPTURE(BM_ParseResponse, arena, true)->Arg(0)->Arg(1)->Arg(2)->Arg(8);
+
+BENCHMARK_CAPTURE(BM_UnaryRoundTrip, inprocess, Transport::kInProcess)
+    ->RangeMultiplier(16)->Range(16, kMaxPayloadBytes)->UseRealTime();
+BENCHMARK_CAPTURE(BM_UnaryRoundTrip, tcp, Transport::kLoopbackTcp)
+    ->RangeMultiplier(16)->Range(16, kMaxPayloadBytes)->UseRealTime();
+BENCHMARK_CAPTURE(BM_StreamRoundTrip, inprocess, Transport::kInProcess)
+    ->RangeMultiplier(16)->Range(16, kMaxPayloadBytes)->UseRealTime();
+BENCHMARK_CAPTURE(BM_StreamRoundTrip, tcp, Transport::kLoopbackTcp)
+    ->RangeMultiplier(16)->Range(16, kMaxPayloadBytes)->UseRealTime();
+
+int main(int argc, char** argv) {
+    // --payload is ours; everything else is Google Benchmark's
+    std::string payloadKind = "random";
+    std::vector<char*> args;
+    bool hasOut = false;
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--payload" && i + 1 < argc) {
+            payloadKind = argv[++i];
+            continue;
+        }
+        if (arg == "--help") {
+            std::cout << "Usage: " << argv[0] << " [--payload KIND] [Google Benchmark options]\n"
+                      << "  --payload KIND     Payload content: repeat, random, text, protobuf, mixed or\n"
+                      << "                     file:PATH (default: random)\n"
+                      << "  Results are written to csvfiles/microbench.json unless --benchmark_out is given;\n"
+                      << "  e.g. --benchmark_filter=Parse to run a subset.\n"
+                      << std::endl;
+        }
+        hasOut = hasOut || arg.rfind("--benchmark_out=", 0) == 0;
+        args.push_back(argv[i]);
+    }
+
+    std::string outArg = "--benchmark_out=csvfiles/microbench.json";
+    std::string formatArg = "--benchmark_out_format=json";
+    if (!hasOut) {
+        mkdir("csvfiles", 0755);
+        args.push_back(outArg.data());
+        args.push_back(formatArg.data());
+    }
+
+    if (!PayloadGenerator::IsKnownKind(payloadKind)) {
+        std::cout << "Error: unknown --payload kind '" << payloadKind << "'" << std::endl;
+        return 1;
+    }
+    try {
+        Payloads() = PayloadGenerator(payloadKind, kMaxPayloadBytes);
+    } catch (const std::exception& e) {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    int count = static_cast<int>(args.size());
+    args.push_back(nullptr);
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+        return 1;
+    }
+    // Recorded in the JSON context, so runs compare like with like
+    benchmark::AddCustomContext("payload", Payloads().Label());
+    benchmark::AddCustomContext("grpc_version", grpc::Version());
+    benchmark::AddCustomContext("protobuf_version",
+                                google::protobuf::internal::VersionString(GOOGLE_PROTOBUF_VERSION));
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Request payload content. A corpus of the chosen kind is generated once at
+// startup, so building a request never pays for generating data; a payload is
+// a window into the corpus, and successive requests start at different
+// offsets so no two consecutive payloads are identical.
+//
+//   repeat    'X' repeated (the original payload; compresses to almost nothing)
+//   random    uniformly random bytes (incompressible)
+//   text      English-like words with Zipf-distributed frequencies
+//   protobuf  serialized records of varints, fixed64s, short strings, packed
+//             floats and nested messages, like typical service traffic
+//   mixed     4 KiB chunks of random, text and protobuf in turn
+//   file:PATH the bytes of a sample file, repeated to fill the corpus
+class PayloadGenerator {
+public:
+    // Extra corpus beyond the largest payload, over which payload offsets rotate
+    static constexpr size_t kOffsetSpan = 64 * 1024;
+
+    PayloadGenerator() : PayloadGenerator("repeat", 0) {}
+
+    // Throws std::runtime_error for an unknown kind or an unreadable sample file.
+    PayloadGenerator(const std::string& kind, size_t maxPayloadBytes, uint64_t seed = 42)
+        : kind_(kind), rng_(seed) {
+        size_t size = maxPayloadBytes + kOffsetSpan;
+        corpus_.reserve(size);
+        if (kind == "repeat") {
+            corpus_.assign(size, 'X');
+        } else if (kind == "random") {
+            AppendRandom(size);
+        } else if (kind == "text") {
+            AppendText(size);
+        } else if (kind == "protobuf") {
+            AppendProtobuf(size);
+        } else if (kind == "mixed") {
+            static constexpr size_t kChunk = 4096;
+            for (int turn = 0; corpus_.size() < size; turn = (turn + 1) % 3) {
+                size_t target = std::min(size, corpus_.size() + kChunk);
+                if (turn == 0) {
+                    AppendRandom(target);
+                } else if (turn == 1) {
+                    AppendText(target);
+                } else {
+                    AppendProtobuf(target);
+                }
+            }
+        } else if (kind.rfind("file:", 0) == 0) {
+            std::ifstream file(kind.substr(5), std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("cannot open payload sample file " + kind.substr(5));
+            }
+            std::string sample((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            if (sample.empty()) {
+                throw std::runtime_error("payload sample file " + kind.substr(5) + " is empty");
+            }
+            while (corpus_.size() < size) {
+                corpus_.append(sample, 0, std::min(sample.size(), size - corpus_.size()));
+            }
+        } else {
+            throw std::runtime_error("unknown payload kind '" + kind + "'");
+        }
+    }
+
+    static bool IsKnownKind(const std::string& kind) {
+        return kind == "repeat" || kind == "random" || kind == "text" || kind == "protobuf" || kind == "mixed" ||
+               (kind.rfind("file:", 0) == 0 && kind.size() > 5);
+    }
+
+    // size bytes of the corpus for the sequence-th request. Valid for the
+    // generator's lifetime; size must not exceed the maxPayloadBytes it was built for.
+    std::string_view Payload(size_t size, uint64_t sequence) const {
+        size_t offsets = corpus_.size() - size + 1;
+        return std::string_view(corpus_).substr(static_cast<size_t>((sequence * 4099) % offsets), size);
+    }
+
+    size_t MaxPayloadBytes() const { return corpus_.size() - kOffsetSpan; }
+
+    const std::string& kind() const { return kind_; }
+
+    // File-name friendly kind: the sample path is dropped from file:PATH.
+    std::string Label() const { return kind_.rfind("file:", 0) == 0 ? "file" : kind_; }
+
+    // Order-0 Shannon entropy of the corpus: 8 for random bytes, 0 for repeat.
+    // A rough upper bound on how well a byte-level compressor can do.
+    double EntropyBitsPerByte() const {
+        size_t counts[256] = {};
+        for (unsigned char c : corpus_) {
+            ++counts[c];
+        }
+        double bits = 0.0;
+        for (size_t count : counts) {
+            if (count > 0) {
+                double p = static_cast<double>(count) / corpus_.size();
+                bits -= p * std::log2(p);
+            }
+        }
+        return bits;
+    }
+
+private:
+    void AppendRandom(size_t target) {
+        std::uniform_int_distribution<int> byte(0, 255);
+        while (corpus_.size() < target) {
+            corpus_.push_back(static_cast<char>(byte(rng_)));
+        }
+    }
+
+    void AppendText(size_t target) {
+        static const std::vector<std::string> kWords = {
+            "the", "of", "and", "to", "a", "in", "is", "that", "for", "it", "as", "was", "with", "be", "by",
+            "on", "not", "he", "this", "are", "or", "his", "from", "at", "which", "but", "have", "an", "had",
+            "they", "you", "were", "their", "one", "all", "we", "can", "her", "has", "there", "been", "if",
+            "more", "when", "will", "would", "who", "so", "no", "request", "server", "latency", "network",
+            "worker", "message", "buffer", "cluster", "throughput", "timeout", "response", "payload",
+            "connection", "benchmark", "distributed", "configuration", "performance", "measurement"};
+        // Zipf: the rank-r word is drawn with weight 1/r
+        std::vector<double> weights;
+        for (size_t rank = 1; rank <= kWords.size(); ++rank) {
+            weights.push_back(1.0 / rank);
+        }
+        std::discrete_distribution<size_t> word(weights.begin(), weights.end());
+        std::uniform_int_distribution<int> sentenceLength(5, 20);
+        std::uniform_int_distribution<int> number(0, 99999);
+        std::bernoulli_distribution digits(0.03);
+
+        while (corpus_.size() < target) {
+            int length = sentenceLength(rng_);
+            for (int i = 0; i < length && corpus_.size() < target; ++i) {
+                std::string token = digits(rng_) ? std::to_string(number(rng_)) : kWords[word(rng_)];
+                if (i == 0) {
+                    token[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(token[0])));
+                }
+                corpus_.append(token);
+                corpus_.push_back(i + 1 == length ? '.' : ' ');
+            }
+            corpus_.push_back(std::bernoulli_distribution(0.2)(rng_) ? '\n' : ' ');
+        }
+        corpus_.resize(target);
+    }
+
+    void AppendProtobuf(size_t target) {
+        std::uniform_int_distribution<int> enumValue(0, 4);
+        std::uniform_int_distribution<int> floatCount(3, 16);
+        std::uniform_int_distribution<int> nameNumber(0, 9999);
+        std::normal_distribution<float> reading(20.0f, 5.0f);
+        static const char* kNames[] = {"alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel"};
+        std::uniform_int_distribution<int> name(0, 7);
+
+        while (corpus_.size() < target) {
+            std::string record;
+            ++recordId_;
+            timestampNs_ += 1000 + recordId_ % 977;
+            AppendTag(record, 1, 0);
+            AppendVarint(record, recordId_);
+            AppendTag(record, 2, 1);
+            record.append(reinterpret_cast<const char*>(&timestampNs_), sizeof(timestampNs_));
+            std::string label = std::string(kNames[name(rng_)]) + "-" + std::to_string(nameNumber(rng_));
+            AppendTag(record, 3, 2);
+            AppendVarint(record, label.size());
+            record.append(label);
+            AppendTag(record, 4, 0);
+            AppendVarint(record, enumValue(rng_));
+
+            std::string floats;
+            for (int i = floatCount(rng_); i > 0; --i) {
+                float value = reading(rng_);
+                floats.append(reinterpret_cast<const char*>(&value), sizeof(value));
+            }
+            AppendTag(record, 5, 2);
+            AppendVarint(record, floats.size());
+            record.append(floats);
+
+            std::string nested;
+            AppendTag(nested, 1, 0);
+            AppendVarint(nested, recordId_ % 64);
+            AppendTag(nested, 2, 2);
+            AppendVarint(nested, std::strlen(kNames[recordId_ % 8]));
+            nested.append(kNames[recordId_ % 8]);
+            AppendTag(record, 6, 2);
+            AppendVarint(record, nested.size());
+            record.append(nested);
+
+            // Each record is a length-delimited entry of a repeated field
+            AppendTag(corpus_, 1, 2);
+            AppendVarint(corpus_, record.size());
+            corpus_.append(record);
+        }
+        corpus_.resize(target);
+    }
+
+    static void AppendTag(std::string& out, int field, int wireType) { AppendVarint(out, (field << 3) | wireType); }
+
+    static void AppendVarint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    std::string kind_;
+    std::mt19937_64 rng_;
+    std::string corpus_;
+    uint64_t recordId_ = 0;
+    uint64_t timestampNs_ = 1700000000000000000ull;
+};
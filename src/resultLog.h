@@ -0,0 +1,254 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Binary per-sample result log (.brlog), the --results-format binary
+// alternative to benchmark_results_*.csv.
+//
+// The file is a one-page header followed by fixed-size blocks of
+// kRecordsPerBlock records. Each block stores its records column by column:
+//
+//   int64  latencyNs[kRecordsPerBlock]
+//   uint32 payloadSize[kRecordsPerBlock]
+//   uint16 worker[kRecordsPerBlock]      worker whose response completed the request
+//   uint8  status[kRecordsPerBlock]      0 = success, 1 = failed
+//   uint8  pattern[kRecordsPerBlock]     index into the header's pattern table
+//
+// Blocks are 64 KiB and page-aligned, so block b of column c sits at a fixed
+// offset and a reader can map the file and scan one column without touching
+// the others. Only the first recordCount records are valid; the last block is
+// usually partly filled.
+namespace resultlog {
+
+constexpr char kMagic[8] = {'B', 'R', 'E', 'S', 'L', 'O', 'G', '1'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderBytes = 4096;
+constexpr size_t kRecordsPerBlock = 4096;
+constexpr size_t kMaxPatterns = 8;
+constexpr size_t kMaxWorkers = 56;
+constexpr size_t kNameBytes = 32;
+constexpr size_t kAddressBytes = 64;
+constexpr uint8_t kStatusOk = 0;
+constexpr uint8_t kStatusFailed = 1;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordsPerBlock;
+    uint64_t recordCount;  // advanced after each record is complete
+    uint32_t patternCount;
+    uint32_t workerCount;  // addresses beyond kMaxWorkers are not named
+    char patterns[kMaxPatterns][kNameBytes];
+    char workers[kMaxWorkers][kAddressBytes];
+};
+static_assert(sizeof(Header) <= kHeaderBytes, "result log header must fit in one page");
+
+// Column offsets within a block
+constexpr size_t kLatencyOffset = 0;
+constexpr size_t kPayloadOffset = kLatencyOffset + kRecordsPerBlock * sizeof(int64_t);
+constexpr size_t kWorkerOffset = kPayloadOffset + kRecordsPerBlock * sizeof(uint32_t);
+constexpr size_t kStatusOffset = kWorkerOffset + kRecordsPerBlock * sizeof(uint16_t);
+constexpr size_t kPatternOffset = kStatusOffset + kRecordsPerBlock * sizeof(uint8_t);
+constexpr size_t kBlockBytes = kPatternOffset + kRecordsPerBlock * sizeof(uint8_t);
+static_assert(kBlockBytes % 4096 == 0, "blocks must stay page-aligned");
+
+inline void CopyName(char* out, size_t capacity, const std::string& name) {
+    std::memset(out, 0, capacity);
+    std::memcpy(out, name.data(), std::min(name.size(), capacity - 1));
+}
+
+}  // namespace resultlog
+
+// Appends records to a .brlog through a shared mapping of the block being
+// filled: a record is five stores into mapped memory, with no formatting and
+// no write() per sample. The file grows one block at a time, and as the
+// header's record count is advanced after every record, the log stays
+// readable up to the last sample even if the head is killed mid-run. Not
+// thread-safe; callers serialize Append.
+class ResultLogWriter {
+public:
+    ResultLogWriter() = default;
+    ResultLogWriter(const ResultLogWriter&) = delete;
+    ResultLogWriter& operator=(const ResultLogWriter&) = delete;
+    ~ResultLogWriter() { Close(); }
+
+    // Throws std::runtime_error if the file cannot be created or mapped.
+    void Open(const std::string& path, const std::vector<std::string>& patterns,
+              const std::vector<std::string>& workers) {
+        Close();
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) {
+            throw std::runtime_error("cannot create result log " + path + ": " + std::strerror(errno));
+        }
+        if (::ftruncate(fd_, resultlog::kHeaderBytes) != 0) {
+            Fail("cannot size result log " + path);
+        }
+        void* header = ::mmap(nullptr, resultlog::kHeaderBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (header == MAP_FAILED) {
+            Fail("cannot map result log " + path);
+        }
+        header_ = static_cast<resultlog::Header*>(header);
+        std::memcpy(header_->magic, resultlog::kMagic, sizeof(resultlog::kMagic));
+        header_->version = resultlog::kVersion;
+        header_->recordsPerBlock = resultlog::kRecordsPerBlock;
+        header_->recordCount = 0;
+        header_->patternCount = static_cast<uint32_t>(std::min(patterns.size(), resultlog::kMaxPatterns));
+        for (size_t i = 0; i < header_->patternCount; ++i) {
+            resultlog::CopyName(header_->patterns[i], resultlog::kNameBytes, patterns[i]);
+        }
+        header_->workerCount = static_cast<uint32_t>(workers.size());
+        for (size_t i = 0; i < workers.size() && i < resultlog::kMaxWorkers; ++i) {
+            resultlog::CopyName(header_->workers[i], resultlog::kAddressBytes, workers[i]);
+        }
+        path_ = path;
+    }
+
+    bool IsOpen() const { return fd_ >= 0; }
+
+    void Append(uint32_t payloadSize, int64_t latencyNs, bool success, uint16_t worker, uint8_t pattern = 0) {
+        size_t slot = header_->recordCount % resultlog::kRecordsPerBlock;
+        if (slot == 0) {
+            MapBlock(header_->recordCount / resultlog::kRecordsPerBlock);
+        }
+        reinterpret_cast<int64_t*>(block_ + resultlog::kLatencyOffset)[slot] = latencyNs;
+        reinterpret_cast<uint32_t*>(block_ + resultlog::kPayloadOffset)[slot] = payloadSize;
+        reinterpret_cast<uint16_t*>(block_ + resultlog::kWorkerOffset)[slot] = worker;
+        reinterpret_cast<uint8_t*>(block_ + resultlog::kStatusOffset)[slot] =
+            success ? resultlog::kStatusOk : resultlog::kStatusFailed;
+        reinterpret_cast<uint8_t*>(block_ + resultlog::kPatternOffset)[slot] = pattern;
+        ++header_->recordCount;
+    }
+
+    uint64_t RecordCount() const { return header_ == nullptr ? 0 : header_->recordCount; }
+
+    void Close() {
+        if (block_ != nullptr) {
+            ::munmap(block_, resultlog::kBlockBytes);
+            block_ = nullptr;
+        }
+        if (header_ != nullptr) {
+            ::munmap(header_, resultlog::kHeaderBytes);
+            header_ = nullptr;
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+private:
+    void MapBlock(uint64_t index) {
+        if (block_ != nullptr) {
+            ::munmap(block_, resultlog::kBlockBytes);
+            block_ = nullptr;
+        }
+        off_t offset = static_cast<off_t>(resultlog::kHeaderBytes + index * resultlog::kBlockBytes);
+        if (::ftruncate(fd_, offset + static_cast<off_t>(resultlog::kBlockBytes)) != 0) {
+            Fail("cannot grow result log " + path_);
+        }
+        void* block = ::mmap(nullptr, resultlog::kBlockBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, offset);
+        if (block == MAP_FAILED) {
+            Fail("cannot map result log " + path_);
+        }
+        block_ = static_cast<char*>(block);
+    }
+
+    [[noreturn]] void Fail(const std::string& message) {
+        std::string error = message + ": " + std::strerror(errno);
+        Close();
+        throw std::runtime_error(error);
+    }
+
+    int fd_ = -1;
+    std::string path_;
+    resultlog::Header* header_ = nullptr;
+    char* block_ = nullptr;
+};
+
+// Read-only view of a whole .brlog mapped into memory. Columns are exposed
+// per block so scans run over contiguous arrays.
+class ResultLogReader {
+public:
+    // Throws std::runtime_error for a missing, truncated or foreign file.
+    explicit ResultLogReader(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open result log " + path + ": " + std::strerror(errno));
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < resultlog::kHeaderBytes) {
+            ::close(fd);
+            throw std::runtime_error(path + " is not a result log");
+        }
+        size_ = static_cast<size_t>(info.st_size);
+        void* data = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("cannot map result log " + path + ": " + std::strerror(errno));
+        }
+        data_ = static_cast<const char*>(data);
+        // Scans are strictly sequential
+        ::madvise(data, size_, MADV_SEQUENTIAL);
+
+        const auto& header = *reinterpret_cast<const resultlog::Header*>(data_);
+        size_t blocks = (size_ - resultlog::kHeaderBytes) / resultlog::kBlockBytes;
+        if (std::memcmp(header.magic, resultlog::kMagic, sizeof(resultlog::kMagic)) != 0 ||
+            header.version != resultlog::kVersion || header.recordsPerBlock != resultlog::kRecordsPerBlock ||
+            header.recordCount > blocks * resultlog::kRecordsPerBlock) {
+            ::munmap(const_cast<char*>(data_), size_);
+            throw std::runtime_error(path + " is not a version " + std::to_string(resultlog::kVersion) +
+                                     " result log or is truncated");
+        }
+        recordCount_ = header.recordCount;
+        for (uint32_t i = 0; i < header.patternCount && i < resultlog::kMaxPatterns; ++i) {
+            patterns_.emplace_back(header.patterns[i], strnlen(header.patterns[i], resultlog::kNameBytes));
+        }
+        for (uint32_t i = 0; i < header.workerCount && i < resultlog::kMaxWorkers; ++i) {
+            workers_.emplace_back(header.workers[i], strnlen(header.workers[i], resultlog::kAddressBytes));
+        }
+    }
+
+    ResultLogReader(const ResultLogReader&) = delete;
+    ResultLogReader& operator=(const ResultLogReader&) = delete;
+    ~ResultLogReader() { ::munmap(const_cast<char*>(data_), size_); }
+
+    uint64_t RecordCount() const { return recordCount_; }
+    size_t BlockCount() const { return (recordCount_ + resultlog::kRecordsPerBlock - 1) / resultlog::kRecordsPerBlock; }
+
+    // Valid records in block b
+    size_t BlockRecords(size_t b) const {
+        return std::min<uint64_t>(resultlog::kRecordsPerBlock, recordCount_ - b * resultlog::kRecordsPerBlock);
+    }
+
+    const int64_t* LatencyNs(size_t b) const { return Column<int64_t>(b, resultlog::kLatencyOffset); }
+    const uint32_t* PayloadSize(size_t b) const { return Column<uint32_t>(b, resultlog::kPayloadOffset); }
+    const uint16_t* Worker(size_t b) const { return Column<uint16_t>(b, resultlog::kWorkerOffset); }
+    const uint8_t* Status(size_t b) const { return Column<uint8_t>(b, resultlog::kStatusOffset); }
+    const uint8_t* Pattern(size_t b) const { return Column<uint8_t>(b, resultlog::kPatternOffset); }
+
+    const std::vector<std::string>& Patterns() const { return patterns_; }
+    const std::vector<std::string>& Workers() const { return workers_; }
+
+private:
+    template <typename T>
+    const T* Column(size_t b, size_t offset) const {
+        return reinterpret_cast<const T*>(data_ + resultlog::kHeaderBytes + b * resultlog::kBlockBytes + offset);
+    }
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    uint64_t recordCount_ = 0;
+    std::vector<std::string> patterns_;
+    std::vector<std::string> workers_;
+};
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/cpuTime.h"
+
+// --service-time: emulated per-request work at the worker that answers a
+// request, so the head sees server-side queueing and head-of-line blocking
+// instead of an instant acknowledgement. A service time is drawn per request:
+//
+//   const:US             US microseconds for every request
+//   exp:MEAN_US          exponential with that mean, as in M/M/c models
+//   bimodal:FAST,SLOW,P  SLOW microseconds with probability P, else FAST
+//   file:PATH            empirical: samples in microseconds, one per line (blank
+//                        lines and # comments skipped), drawn through the
+//                        interpolated inverse CDF
+//
+// and --service-ns-per-byte adds a fixed cost per payload byte on top.
+//
+// --service-work spin burns the time as CPU on the handling thread, measured
+// in thread CPU time so a preempted thread still owes the rest, like real
+// request processing; sleep blocks the thread without using CPU, like a
+// synchronous call to a backend. Either way the handling thread is held, so
+// queueing behind busy threads shows up as the engine and --threads make it.
+class ServiceTime {
+public:
+    enum class Kind { kNone, kConstant, kExponential, kBimodal, kEmpirical };
+    enum class Work { kSpin, kSleep };
+
+    bool Active() const { return kind_ != Kind::kNone || nsPerByte_ > 0.0; }
+
+    void SetWork(Work work) { work_ = work; }
+    void SetNsPerByte(double nsPerByte) { nsPerByte_ = nsPerByte; }
+
+    // The next request's service time; uses a per-thread generator
+    int64_t SampleNs(size_t payloadBytes) const {
+        thread_local std::mt19937_64 rng(std::random_device{}());
+        double us = 0.0;
+        switch (kind_) {
+        case Kind::kNone:
+            break;
+        case Kind::kConstant:
+            us = fastUs_;
+            break;
+        case Kind::kExponential:
+            us = std::exponential_distribution<double>(1.0 / fastUs_)(rng);
+            break;
+        case Kind::kBimodal:
+            us = std::uniform_real_distribution<double>(0.0, 1.0)(rng) < slowFraction_ ? slowUs_ : fastUs_;
+            break;
+        case Kind::kEmpirical: {
+            double position = std::uniform_real_distribution<double>(0.0, 1.0)(rng) * (samplesUs_.size() - 1);
+            size_t below = static_cast<size_t>(position);
+            size_t above = std::min(below + 1, samplesUs_.size() - 1);
+            us = samplesUs_[below] + (samplesUs_[above] - samplesUs_[below]) * (position - below);
+            break;
+        }
+        }
+        return static_cast<int64_t>(us * 1e3 + nsPerByte_ * static_cast<double>(payloadBytes));
+    }
+
+    // Holds the calling thread for ns
+    void Perform(int64_t ns) const {
+        if (ns <= 0) {
+            return;
+        }
+        if (work_ == Work::kSleep) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+            return;
+        }
+        uint64_t done = ThreadCpuNs() + static_cast<uint64_t>(ns);
+        while (ThreadCpuNs() < done) {
+        }
+    }
+
+    // For the startup line
+    std::string Describe() const {
+        std::ostringstream text;
+        switch (kind_) {
+        case Kind::kNone:
+            text << "none";
+            break;
+        case Kind::kConstant:
+            text << "constant " << fastUs_ << "us";
+            break;
+        case Kind::kExponential:
+            text << "exponential, mean " << fastUs_ << "us";
+            break;
+        case Kind::kBimodal:
+            text << "bimodal " << fastUs_ << "us / " << slowUs_ << "us at " << slowFraction_;
+            break;
+        case Kind::kEmpirical:
+            text << "empirical, " << samplesUs_.size() << " samples from " << samplesUs_.front() << "us to "
+                 << samplesUs_.back() << "us";
+            break;
+        }
+        if (nsPerByte_ > 0.0) {
+            text << " + " << nsPerByte_ << "ns/byte";
+        }
+        text << (work_ == Work::kSpin ? ", spinning" : ", sleeping");
+        return text.str();
+    }
+
+    // false for a malformed spec; throws std::runtime_error for an unreadable
+    // or empty sample file
+    friend bool ParseServiceTime(const std::string& spec, ServiceTime* model);
+
+private:
+    Kind kind_ = Kind::kNone;
+    Work work_ = Work::kSpin;
+    double fastUs_ = 0.0;       // constant value, exponential mean, or bimodal fast mode
+    double slowUs_ = 0.0;
+    double slowFraction_ = 0.0;
+    std::vector<double> samplesUs_;  // sorted
+    double nsPerByte_ = 0.0;
+};
+
+inline bool ParseServiceTime(const std::string& spec, ServiceTime* model) {
+    size_t colon = spec.find(':');
+    std::string kind = spec.substr(0, colon);
+    std::string value = colon == std::string::npos ? "" : spec.substr(colon + 1);
+    if (kind == "none") {
+        model->kind_ = ServiceTime::Kind::kNone;
+        return true;
+    }
+    if (kind == "file") {
+        std::ifstream file(value);
+        if (value.empty() || !file) {
+            throw std::runtime_error("cannot open service time file '" + value + "'");
+        }
+        std::vector<double> samples;
+        std::string line;
+        while (std::getline(file, line)) {
+            line = line.substr(0, line.find('#'));
+            std::istringstream fields(line);
+            double us;
+            if (fields >> us) {
+                if (us < 0.0 || !std::isfinite(us)) {
+                    throw std::runtime_error("negative or non-finite service time in '" + value + "'");
+                }
+                samples.push_back(us);
+            }
+        }
+        if (samples.empty()) {
+            throw std::runtime_error("no service times in '" + value + "'");
+        }
+        std::sort(samples.begin(), samples.end());
+        model->kind_ = ServiceTime::Kind::kEmpirical;
+        model->samplesUs_ = std::move(samples);
+        return true;
+    }
+
+    std::vector<double> numbers;
+    std::stringstream list(value);
+    std::string field;
+    while (std::getline(list, field, ',')) {
+        try {
+            size_t used = 0;
+            numbers.push_back(std::stod(field, &used));
+            if (used != field.size()) {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    if (kind == "const" && numbers.size() == 1 && numbers[0] >= 0.0) {
+        model->kind_ = ServiceTime::Kind::kConstant;
+        model->fastUs_ = numbers[0];
+    } else if (kind == "exp" && numbers.size() == 1 && numbers[0] > 0.0) {
+        model->kind_ = ServiceTime::Kind::kExponential;
+        model->fastUs_ = numbers[0];
+    } else if (kind == "bimodal" && numbers.size() == 3 && numbers[0] >= 0.0 && numbers[1] >= 0.0 &&
+               numbers[2] >= 0.0 && numbers[2] <= 1.0) {
+        model->kind_ = ServiceTime::Kind::kBimodal;
+        model->fastUs_ = numbers[0];
+        model->slowUs_ = numbers[1];
+        model->slowFraction_ = numbers[2];
+    } else {
+        return false;
+    }
+    return true;
+}
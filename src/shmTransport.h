@@ -0,0 +1,410 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <google/protobuf/message_lite.h>
+
+// Shared-memory transport for a head and workers on the same host.
+//
+// A worker publishes one POSIX shared-memory segment named after its gRPC port
+// (see ShmSegmentName). The segment holds kShmSlots connection slots; a client
+// claims a free slot and then owns its request ring as the only producer, while
+// the worker is the only producer on the slot's response ring. Both rings are
+// lock-free single-producer/single-consumer byte rings carrying length-prefixed
+// serialized BenchmarkRequest/BenchmarkResponse messages, so the protobuf
+// semantics match the gRPC path exactly.
+//
+// Consumers busy-poll for a short while and then either keep spinning
+// (ShmWait::kSpin) or sleep on a futex in the segment (ShmWait::kFutex); a
+// producer only issues the wake syscall when a consumer announced it sleeps.
+
+constexpr uint32_t kShmMagic = 0x42534d31;  // "BSM1"
+constexpr int kShmSlots = 16;
+constexpr size_t kShmDefaultRingBytes = 1 << 20;
+
+enum class ShmWait { kSpin, kFutex };
+
+// What ShmRing::TryRead found
+enum class ShmRead { kEmpty, kMessage, kMalformed };
+
+inline std::string ShmSegmentName(const std::string& address) {
+    return "/benchmark_shm_" + address.substr(address.rfind(':') + 1);
+}
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// A futex word plus a flag telling producers that a consumer may be asleep on it.
+struct ShmWakeWord {
+    std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> sleepers;
+
+    void Notify() {
+        seq.fetch_add(1, std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_seq_cst) != 0) {
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&seq), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+        }
+    }
+
+    // Waits until ready() holds or timeoutMs passes; returns ready().
+    template <typename Ready>
+    bool Wait(Ready ready, ShmWait mode, int timeoutMs) {
+        // Spinning on a single CPU only delays the producer it is waiting for
+        static const int kSpinIterations = std::thread::hardware_concurrency() > 1 ? 4000 : 0;
+        for (int i = 0; i < kSpinIterations; ++i) {
+            if (ready()) {
+                return true;
+            }
+            CpuRelax();
+        }
+        if (mode == ShmWait::kSpin) {
+            std::this_thread::yield();
+            return ready();
+        }
+
+        uint32_t observed = seq.load(std::memory_order_seq_cst);
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        if (!ready()) {
+            timespec timeout{timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&seq), FUTEX_WAIT, observed, &timeout, nullptr, 0);
+        }
+        sleepers.fetch_sub(1, std::memory_order_seq_cst);
+        return ready();
+    }
+};
+
+struct alignas(64) ShmRingHeader {
+    alignas(64) std::atomic<uint64_t> writePos;
+    alignas(64) std::atomic<uint64_t> readPos;
+    alignas(64) ShmWakeWord wake;
+};
+
+// View of one SPSC ring: a header and a power-of-two data area in the segment.
+// Positions grow monotonically; each record is a 4-byte length followed by the
+// message, padded to 8 bytes. A record never straddles the end of the data
+// area; the producer writes a wrap marker and continues at offset 0 instead.
+class ShmRing {
+public:
+    static constexpr uint32_t kWrapMarker = UINT32_MAX;
+
+    ShmRing() = default;
+    ShmRing(ShmRingHeader* header, char* data, size_t capacity)
+        : header_(header), data_(data), capacity_(capacity) {}
+
+    void Reset() {
+        header_->writePos.store(0, std::memory_order_relaxed);
+        header_->readPos.store(0, std::memory_order_relaxed);
+    }
+
+    size_t MaxMessageBytes() const { return capacity_ / 2 - 8; }
+
+    bool Empty() const {
+        return header_->readPos.load(std::memory_order_relaxed) ==
+               header_->writePos.load(std::memory_order_seq_cst);
+    }
+
+    // Serializes message straight into the ring. Returns false if it does not
+    // fit right now; messages larger than MaxMessageBytes() never fit.
+    bool TryWrite(const google::protobuf::MessageLite& message) {
+        size_t size = message.ByteSizeLong();
+        if (size > MaxMessageBytes()) {
+            return false;
+        }
+        uint64_t write = header_->writePos.load(std::memory_order_relaxed);
+        uint64_t read = header_->readPos.load(std::memory_order_acquire);
+        size_t need = Align8(4 + size);
+        size_t offset = write & (capacity_ - 1);
+        size_t skip = (capacity_ - offset < need) ? capacity_ - offset : 0;
+        if (capacity_ - (write - read) < skip + need) {
+            return false;
+        }
+
+        if (skip != 0) {
+            StoreLength(offset, kWrapMarker);
+            write += skip;
+            offset = 0;
+        }
+        StoreLength(offset, static_cast<uint32_t>(size));
+        message.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(data_ + offset + 4));
+        header_->writePos.store(write + need, std::memory_order_seq_cst);
+        return true;
+    }
+
+    // Parses the next record into message. A record that fails to parse is
+    // consumed and reported as kMalformed; its requestId is lost with it, so the
+    // caller cannot answer it and gives up on the slot instead.
+    ShmRead TryRead(google::protobuf::MessageLite* message) {
+        uint64_t read = header_->readPos.load(std::memory_order_relaxed);
+        uint64_t write = header_->writePos.load(std::memory_order_acquire);
+        if (read == write) {
+            return ShmRead::kEmpty;
+        }
+        size_t offset = read & (capacity_ - 1);
+        uint32_t size = LoadLength(offset);
+        if (size == kWrapMarker) {
+            read += capacity_ - offset;
+            offset = 0;
+            size = LoadLength(offset);
+        }
+        bool parsed = message->ParseFromArray(data_ + offset + 4, static_cast<int>(size));
+        header_->readPos.store(read + Align8(4 + size), std::memory_order_release);
+        return parsed ? ShmRead::kMessage : ShmRead::kMalformed;
+    }
+
+    ShmWakeWord& wake() { return header_->wake; }
+
+private:
+    static size_t Align8(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+
+    void StoreLength(size_t offset, uint32_t length) { std::memcpy(data_ + offset, &length, 4); }
+
+    uint32_t LoadLength(size_t offset) const {
+        uint32_t length;
+        std::memcpy(&length, data_ + offset, 4);
+        return length;
+    }
+
+    ShmRingHeader* header_ = nullptr;
+    char* data_ = nullptr;
+    size_t capacity_ = 0;
+};
+
+struct alignas(64) ShmSlotHeader {
+    std::atomic<uint32_t> state;  // kFree, kClaiming, kClaimed or kBroken
+    std::atomic<int32_t> ownerPid;
+};
+
+struct alignas(64) ShmSegmentHeader {
+    std::atomic<uint32_t> magic;
+    int32_t workerPid;
+    uint64_t ringBytes;
+    ShmWakeWord doorbell;  // rung by clients after every request
+    ShmSlotHeader slots[kShmSlots];
+};
+
+// A mapped segment. The worker creates it; clients open the existing one.
+class ShmSegment {
+public:
+    static constexpr uint32_t kFree = 0;
+    static constexpr uint32_t kClaiming = 1;
+    static constexpr uint32_t kClaimed = 2;
+    static constexpr uint32_t kBroken = 3;  // claimed, but the worker stopped serving it
+
+    static std::unique_ptr<ShmSegment> Create(const std::string& name, size_t ringBytes) {
+        if (ringBytes < 4096 || (ringBytes & (ringBytes - 1)) != 0) {
+            throw std::runtime_error("shm ring size must be a power of two >= 4096");
+        }
+        shm_unlink(name.c_str());
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            throw std::runtime_error("shm_open(" + name + ") failed: " + std::strerror(errno));
+        }
+        size_t size = SegmentBytes(ringBytes);
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            close(fd);
+            throw std::runtime_error("ftruncate(" + name + ") failed: " + std::strerror(errno));
+        }
+
+        auto segment = std::unique_ptr<ShmSegment>(new ShmSegment(name, fd, size, true));
+        ShmSegmentHeader* header = segment->header();
+        header->workerPid = getpid();
+        header->ringBytes = ringBytes;
+        header->doorbell.seq.store(0);
+        header->doorbell.sleepers.store(0);
+        for (auto& slot : header->slots) {
+            slot.state.store(kFree);
+            slot.ownerPid.store(0);
+        }
+        header->magic.store(kShmMagic, std::memory_order_release);
+        return segment;
+    }
+
+    static std::unique_ptr<ShmSegment> Open(const std::string& name) {
+        int fd = shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd < 0) {
+            throw std::runtime_error("shm_open(" + name + ") failed: " + std::strerror(errno) +
+                                     " (is the worker running with --shm on this host?)");
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ShmSegmentHeader)) {
+            close(fd);
+            throw std::runtime_error("shm segment " + name + " is not initialised");
+        }
+        auto segment = std::unique_ptr<ShmSegment>(new ShmSegment(name, fd, st.st_size, false));
+        if (segment->header()->magic.load(std::memory_order_acquire) != kShmMagic) {
+            throw std::runtime_error("shm segment " + name + " has the wrong format");
+        }
+        return segment;
+    }
+
+    ~ShmSegment() {
+        munmap(base_, size_);
+        close(fd_);
+        if (owner_) {
+            shm_unlink(name_.c_str());
+        }
+    }
+
+    ShmSegmentHeader* header() { return reinterpret_cast<ShmSegmentHeader*>(base_); }
+    size_t ringBytes() { return header()->ringBytes; }
+
+    bool WorkerAlive() { return kill(header()->workerPid, 0) == 0 || errno == EPERM; }
+
+    ShmRing RequestRing(int slot) { return RingAt(SlotOffset(slot)); }
+    ShmRing ResponseRing(int slot) { return RingAt(SlotOffset(slot) + sizeof(ShmRingHeader) + ringBytes()); }
+
+    // Claims a free slot (or one whose owner process has exited) and resets its
+    // rings. Returns -1 if every slot is in use.
+    int ClaimSlot() {
+        for (int i = 0; i < kShmSlots; ++i) {
+            ShmSlotHeader& slot = header()->slots[i];
+            uint32_t expected = kFree;
+            bool claimed = slot.state.compare_exchange_strong(expected, kClaiming);
+            if (!claimed && (expected == kClaimed || expected == kBroken)) {
+                pid_t owner = slot.ownerPid.load();
+                if (kill(owner, 0) != 0 && errno == ESRCH) {
+                    claimed = slot.state.compare_exchange_strong(expected, kClaiming);
+                }
+            }
+            if (claimed) {
+                RequestRing(i).Reset();
+                ResponseRing(i).Reset();
+                slot.ownerPid.store(getpid());
+                slot.state.store(kClaimed, std::memory_order_release);
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    void ReleaseSlot(int slot) { header()->slots[slot].state.store(kFree, std::memory_order_release); }
+
+    bool SlotClaimed(int slot) {
+        return header()->slots[slot].state.load(std::memory_order_acquire) == kClaimed;
+    }
+
+    // The worker gives up on a slot that sent a malformed request; its owner
+    // sees that and fails whatever it still has outstanding
+    void BreakSlot(int slot) { header()->slots[slot].state.store(kBroken, std::memory_order_release); }
+
+    bool SlotBroken(int slot) {
+        return header()->slots[slot].state.load(std::memory_order_acquire) == kBroken;
+    }
+
+private:
+    ShmSegment(const std::string& name, int fd, size_t size, bool owner)
+        : name_(name), fd_(fd), size_(size), owner_(owner) {
+        base_ = static_cast<char*>(mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0));
+        if (base_ == MAP_FAILED) {
+            close(fd_);
+            throw std::runtime_error("mmap(" + name_ + ") failed: " + std::strerror(errno));
+        }
+    }
+
+    static size_t HeaderBytes() { return (sizeof(ShmSegmentHeader) + 4095) & ~static_cast<size_t>(4095); }
+    static size_t SlotBytes(size_t ringBytes) { return 2 * (sizeof(ShmRingHeader) + ringBytes); }
+    static size_t SegmentBytes(size_t ringBytes) { return HeaderBytes() + kShmSlots * SlotBytes(ringBytes); }
+
+    size_t SlotOffset(int slot) { return HeaderBytes() + slot * SlotBytes(ringBytes()); }
+
+    ShmRing RingAt(size_t offset) {
+        auto* ringHeader = reinterpret_cast<ShmRingHeader*>(base_ + offset);
+        return ShmRing(ringHeader, base_ + offset + sizeof(ShmRingHeader), ringBytes());
+    }
+
+    std::string name_;
+    int fd_;
+    size_t size_;
+    bool owner_;
+    char* base_ = nullptr;
+};
+
+// Client end of one slot: the caller is the only producer of requests and the
+// only consumer of responses on it.
+class ShmConnection {
+public:
+    ShmConnection(const std::string& address, ShmWait wait)
+        : segment_(ShmSegment::Open(ShmSegmentName(address))), wait_(wait) {
+        slot_ = segment_->ClaimSlot();
+        if (slot_ < 0) {
+            throw std::runtime_error("no free shm slot on " + address);
+        }
+        requests_ = segment_->RequestRing(slot_);
+        responses_ = segment_->ResponseRing(slot_);
+    }
+
+    ~ShmConnection() { segment_->ReleaseSlot(slot_); }
+
+    size_t MaxMessageBytes() const { return requests_.MaxMessageBytes(); }
+
+    // Blocks while the request ring is full. Returns false if the message can
+    // never fit or the worker has gone away.
+    bool Send(const google::protobuf::MessageLite& request) {
+        if (request.ByteSizeLong() > requests_.MaxMessageBytes() || !Intact()) {
+            return false;
+        }
+        while (!requests_.TryWrite(request)) {
+            if (!segment_->WorkerAlive() || !Intact()) {
+                return false;
+            }
+            responses_.wake().Wait([]() { return false; }, ShmWait::kSpin, 0);
+        }
+        segment_->header()->doorbell.Notify();
+        return true;
+    }
+
+    // Waits up to timeoutMs for the next response. Returns false on timeout,
+    // or once the connection is no longer Intact().
+    bool Receive(google::protobuf::MessageLite* response, int timeoutMs) {
+        if (ReadResponse(response)) {
+            return true;
+        }
+        responses_.wake().Wait([this]() { return !responses_.Empty(); }, wait_, timeoutMs);
+        return ReadResponse(response);
+    }
+
+    bool WorkerAlive() { return segment_->WorkerAlive(); }
+
+    // False once either end has read a record it could not parse: a request
+    // or response has been lost without its id, so the slot is unusable.
+    bool Intact() { return !malformed_ && !segment_->SlotBroken(slot_); }
+
+private:
+    bool ReadResponse(google::protobuf::MessageLite* response) {
+        if (malformed_) {
+            return false;
+        }
+        ShmRead read = responses_.TryRead(response);
+        malformed_ = read == ShmRead::kMalformed;
+        return read == ShmRead::kMessage;
+    }
+
+    std::unique_ptr<ShmSegment> segment_;
+    ShmWait wait_;
+    int slot_ = -1;
+    ShmRing requests_;
+    ShmRing responses_;
+    bool malformed_ = false;
+};
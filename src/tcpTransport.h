@@ -0,0 +1,322 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <google/protobuf/message_lite.h>
+
+// Raw TCP transport: the same BenchmarkRequest/BenchmarkResponse messages as the
+// gRPC path, each sent as a 4-byte little-endian length followed by the
+// serialized message, with no HTTP/2, flow control or call setup. It measures
+// what the kernel and protobuf cost on their own, so the gRPC transports can be
+// plotted against it.
+
+constexpr size_t kTcpFrameHeaderBytes = 4;
+constexpr size_t kTcpMaxFrameBytes = 64 << 20;
+
+// Appends message to out as one frame.
+inline void AppendFrame(const google::protobuf::MessageLite& message, std::vector<char>& out) {
+    size_t size = message.ByteSizeLong();
+    size_t offset = out.size();
+    out.resize(offset + kTcpFrameHeaderBytes + size);
+    uint32_t length = static_cast<uint32_t>(size);
+    std::memcpy(out.data() + offset, &length, kTcpFrameHeaderBytes);
+    message.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(out.data() + offset + kTcpFrameHeaderBytes));
+}
+
+// Serializes message as one frame into buffer; returns the frame size or 0 if
+// it does not fit in capacity.
+inline size_t WriteFrame(const google::protobuf::MessageLite& message, char* buffer, size_t capacity) {
+    size_t size = message.ByteSizeLong();
+    if (kTcpFrameHeaderBytes + size > capacity) {
+        return 0;
+    }
+    uint32_t length = static_cast<uint32_t>(size);
+    std::memcpy(buffer, &length, kTcpFrameHeaderBytes);
+    message.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(buffer + kTcpFrameHeaderBytes));
+    return kTcpFrameHeaderBytes + size;
+}
+
+// Length of the complete frame at the start of data, 0 if more bytes are
+// needed, or -1 if the frame is larger than kTcpMaxFrameBytes.
+inline long CompleteFrameBytes(const char* data, size_t available) {
+    if (available < kTcpFrameHeaderBytes) {
+        return 0;
+    }
+    uint32_t length;
+    std::memcpy(&length, data, kTcpFrameHeaderBytes);
+    if (length > kTcpMaxFrameBytes) {
+        return -1;
+    }
+    size_t frame = kTcpFrameHeaderBytes + length;
+    return available >= frame ? static_cast<long>(frame) : 0;
+}
+
+// Microseconds a blocking read on a transport socket busy-polls the device
+// queue before sleeping (SO_BUSY_POLL, set by --tuning low-latency); 0 = off
+inline std::atomic<int>& TcpBusyPollUs() {
+    static std::atomic<int> busyPollUs{0};
+    return busyPollUs;
+}
+
+// Every connected transport socket: Nagle off, and busy polling if asked for.
+// SO_BUSY_POLL needs CAP_NET_ADMIN on most kernels; without it the socket
+// silently keeps interrupt-driven reads.
+inline void TuneSocket(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    int busyPollUs = TcpBusyPollUs().load(std::memory_order_relaxed);
+    if (busyPollUs > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &busyPollUs, sizeof(busyPollUs));
+    }
+}
+
+inline int ListenTcp(const std::string& port) {
+    int fd = socket(AF_INET6, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("socket() failed: ") + std::strerror(errno));
+    }
+    int one = 1;
+    int zero = 0;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero));
+    sockaddr_in6 address{};
+    address.sin6_family = AF_INET6;
+    address.sin6_addr = in6addr_any;
+    address.sin6_port = htons(static_cast<uint16_t>(std::stoi(port)));
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, 128) != 0) {
+        close(fd);
+        throw std::runtime_error("cannot listen on port " + port + ": " + std::strerror(errno));
+    }
+    return fd;
+}
+
+inline int ConnectTcp(const std::string& address) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        throw std::runtime_error("TCP address must be host:port, got " + address);
+    }
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* results = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &results) != 0) {
+        throw std::runtime_error("cannot resolve " + address);
+    }
+    int fd = -1;
+    for (addrinfo* ai = results; ai != nullptr && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(results);
+    if (fd < 0) {
+        throw std::runtime_error("cannot connect to " + address);
+    }
+    TuneSocket(fd);
+    return fd;
+}
+
+// Blocking client connection. One thread may Send while another Receives.
+class TcpConnection {
+public:
+    explicit TcpConnection(const std::string& address) : fd_(ConnectTcp(address)) {}
+
+    ~TcpConnection() { close(fd_); }
+
+    bool Send(const google::protobuf::MessageLite& message) {
+        sendBuffer_.clear();
+        AppendFrame(message, sendBuffer_);
+        size_t sent = 0;
+        while (sent < sendBuffer_.size()) {
+            ssize_t n = send(fd_, sendBuffer_.data() + sent, sendBuffer_.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            sent += n;
+        }
+        return true;
+    }
+
+    // Blocks for the next frame. Returns false once the peer closes the connection
+    // or sends a frame that does not parse.
+    bool Receive(google::protobuf::MessageLite* message) {
+        static constexpr size_t kReadChunk = 64 * 1024;
+        while (true) {
+            long frame = CompleteFrameBytes(receiveBuffer_.data() + consumed_, receiveBuffer_.size() - consumed_);
+            if (frame < 0) {
+                return false;
+            }
+            if (frame > 0) {
+                const char* data = receiveBuffer_.data() + consumed_ + kTcpFrameHeaderBytes;
+                if (!message->ParseFromArray(data, static_cast<int>(frame - kTcpFrameHeaderBytes))) {
+                    return false;
+                }
+                consumed_ += frame;
+                return true;
+            }
+
+            receiveBuffer_.erase(receiveBuffer_.begin(), receiveBuffer_.begin() + consumed_);
+            consumed_ = 0;
+            size_t filled = receiveBuffer_.size();
+            receiveBuffer_.resize(filled + kReadChunk);
+            ssize_t n = recv(fd_, receiveBuffer_.data() + filled, kReadChunk, 0);
+            receiveBuffer_.resize(filled + std::max<ssize_t>(n, 0));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+        }
+    }
+
+    // Half-closes the connection; the peer sees EOF once it has answered everything.
+    void CloseWrite() { shutdown(fd_, SHUT_WR); }
+
+private:
+    int fd_;
+    std::vector<char> sendBuffer_;
+    std::vector<char> receiveBuffer_;
+    size_t consumed_ = 0;
+};
+
+// Minimal io_uring wrapper on the raw system calls: one submission and one
+// completion ring, batched submission through a single io_uring_enter and
+// registered (fixed) buffers.
+class IoUring {
+public:
+    explicit IoUring(unsigned entries) {
+        io_uring_params params{};
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd_ < 0) {
+            throw std::runtime_error(std::string("io_uring_setup failed: ") + std::strerror(errno));
+        }
+
+        sqRingBytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingBytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMmap) {
+            sqRingBytes_ = cqRingBytes_ = std::max(sqRingBytes_, cqRingBytes_);
+        }
+        sqRing_ = Map(sqRingBytes_, IORING_OFF_SQ_RING);
+        cqRing_ = singleMmap ? sqRing_ : Map(cqRingBytes_, IORING_OFF_CQ_RING);
+        sqesBytes_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(Map(sqesBytes_, IORING_OFF_SQES));
+
+        char* sq = static_cast<char*>(sqRing_);
+        sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sqEntries_ = params.sq_entries;
+
+        char* cq = static_cast<char*>(cqRing_);
+        cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    }
+
+    ~IoUring() {
+        munmap(sqes_, sqesBytes_);
+        if (cqRing_ != sqRing_) {
+            munmap(cqRing_, cqRingBytes_);
+        }
+        munmap(sqRing_, sqRingBytes_);
+        close(fd_);
+    }
+
+    void RegisterBuffers(const std::vector<iovec>& buffers) {
+        if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, buffers.data(),
+                    static_cast<unsigned>(buffers.size())) != 0) {
+            throw std::runtime_error(std::string("io_uring buffer registration failed: ") + std::strerror(errno));
+        }
+    }
+
+    // Next free submission entry, zeroed; queued until the next Submit.
+    io_uring_sqe* NextSqe() {
+        unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if (localTail_ - head >= sqEntries_) {
+            return nullptr;
+        }
+        unsigned index = localTail_ & sqMask_;
+        io_uring_sqe* sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqArray_[index] = index;
+        ++localTail_;
+        return sqe;
+    }
+
+    // Submits everything queued since the last call in one io_uring_enter and
+    // waits until at least waitFor completions are available.
+    void Submit(unsigned waitFor) {
+        unsigned toSubmit = localTail_ - *sqTail_;
+        __atomic_store_n(sqTail_, localTail_, __ATOMIC_RELEASE);
+        unsigned flags = waitFor > 0 ? IORING_ENTER_GETEVENTS : 0;
+        while (syscall(__NR_io_uring_enter, fd_, toSubmit, waitFor, flags, nullptr, 0) < 0 && errno == EINTR) {
+            toSubmit = 0;
+        }
+    }
+
+    io_uring_cqe* PeekCompletion() {
+        unsigned head = *cqHead_;
+        if (head == __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+            return nullptr;
+        }
+        return &cqes_[head & cqMask_];
+    }
+
+    void ConsumeCompletion() { __atomic_store_n(cqHead_, *cqHead_ + 1, __ATOMIC_RELEASE); }
+
+private:
+    void* Map(size_t bytes, off_t offset) {
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        if (p == MAP_FAILED) {
+            throw std::runtime_error(std::string("io_uring mmap failed: ") + std::strerror(errno));
+        }
+        return p;
+    }
+
+    int fd_;
+    void* sqRing_ = nullptr;
+    void* cqRing_ = nullptr;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqRingBytes_ = 0;
+    size_t cqRingBytes_ = 0;
+    size_t sqesBytes_ = 0;
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned* sqArray_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    unsigned localTail_ = 0;
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe* cqes_;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <string>
+
+#include <grpc/support/time.h>
+#include <grpcpp/completion_queue.h>
+#include <grpcpp/server_builder.h>
+#include <grpcpp/support/channel_arguments.h>
+
+// --tuning: named sets of gRPC and socket settings for the head's channels and
+// the worker's server, so low-jitter configurations are switched as a whole
+// and recorded by name with the results.
+//
+//   default      gRPC's own settings
+//   low-latency  completion-queue threads spin instead of sleeping in the
+//                kernel; SO_BUSY_POLL on the raw TCP transport's sockets; no
+//                write coalescing; BDP probing off, so no PINGs or window
+//                jumps land mid-run, with a large fixed stream window instead
+//   throughput   BDP probing on, large write buffer and read chunks
+//
+// gRPC 1.51 offers no public hook to set socket options on its own sockets, so
+// SO_BUSY_POLL for gRPC traffic needs the net.core.busy_read sysctl instead.
+struct TuningProfile {
+    std::string name = "default";
+    bool busyPollCq = false;   // drain completion queues with a zero-deadline AsyncNext loop
+    int socketBusyPollUs = 0;  // SO_BUSY_POLL on raw TCP sockets; 0 = off
+    int writeBufferBytes = -1; // GRPC_ARG_HTTP2_WRITE_BUFFER_SIZE; -1 = gRPC default
+    int bdpProbe = -1;         // GRPC_ARG_HTTP2_BDP_PROBE: 0 off, 1 on, -1 = gRPC default
+    int lookaheadBytes = -1;   // GRPC_ARG_HTTP2_STREAM_LOOKAHEAD_BYTES (initial stream window)
+    int readChunkBytes = -1;   // GRPC_ARG_TCP_READ_CHUNK_SIZE
+
+    template <typename SetInt>
+    void ForEachArg(SetInt setInt) const {
+        if (writeBufferBytes >= 0) {
+            setInt(GRPC_ARG_HTTP2_WRITE_BUFFER_SIZE, writeBufferBytes);
+        }
+        if (bdpProbe >= 0) {
+            setInt(GRPC_ARG_HTTP2_BDP_PROBE, bdpProbe);
+        }
+        if (lookaheadBytes >= 0) {
+            setInt(GRPC_ARG_HTTP2_STREAM_LOOKAHEAD_BYTES, lookaheadBytes);
+        }
+        if (readChunkBytes >= 0) {
+            setInt(GRPC_ARG_TCP_READ_CHUNK_SIZE, readChunkBytes);
+        }
+    }
+
+    void Apply(grpc::ChannelArguments* args) const {
+        ForEachArg([args](const char* name, int value) { args->SetInt(name, value); });
+    }
+
+    void Apply(grpc::ServerBuilder* builder) const {
+        ForEachArg([builder](const char* name, int value) { builder->AddChannelArgument(name, value); });
+    }
+
+    // For the console and the result files
+    std::string Describe() const {
+        std::string text = name;
+        std::string settings;
+        auto add = [&settings](const std::string& setting) { settings += (settings.empty() ? "" : ", ") + setting; };
+        if (busyPollCq) {
+            add("cq busy-poll");
+        }
+        if (socketBusyPollUs > 0) {
+            add("SO_BUSY_POLL " + std::to_string(socketBusyPollUs) + "us");
+        }
+        if (writeBufferBytes >= 0) {
+            add("write buffer " + std::to_string(writeBufferBytes / 1024) + " KB");
+        }
+        if (bdpProbe >= 0) {
+            add(std::string("bdp probe ") + (bdpProbe ? "on" : "off"));
+        }
+        if (lookaheadBytes >= 0) {
+            add("stream window " + std::to_string(lookaheadBytes / 1024) + " KB");
+        }
+        if (readChunkBytes >= 0) {
+            add("read chunk " + std::to_string(readChunkBytes / 1024) + " KB");
+        }
+        return settings.empty() ? text : text + " (" + settings + ")";
+    }
+};
+
+// false for an unknown name
+inline bool ParseTuningProfile(const std::string& name, TuningProfile* profile) {
+    TuningProfile tuning;
+    tuning.name = name;
+    if (name == "low-latency") {
+        tuning.busyPollCq = true;
+        tuning.socketBusyPollUs = 50;
+        tuning.writeBufferBytes = 0;
+        tuning.bdpProbe = 0;
+        tuning.lookaheadBytes = 8 << 20;
+    } else if (name == "throughput") {
+        tuning.writeBufferBytes = 1 << 20;
+        tuning.bdpProbe = 1;
+        tuning.readChunkBytes = 1 << 20;
+    } else if (name != "default") {
+        return false;
+    }
+    *profile = tuning;
+    return true;
+}
+
+// Next() for a completion queue, spinning on a zero deadline under busyPoll
+// so the thread never sleeps in the kernel between events. Returns false once
+// the queue is shut down and drained.
+inline bool NextCompletion(grpc::CompletionQueue* cq, bool busyPoll, void** tag, bool* ok) {
+    if (!busyPoll) {
+        return cq->Next(tag, ok);
+    }
+    while (true) {
+        switch (cq->AsyncNext(tag, ok, gpr_time_0(GPR_CLOCK_MONOTONIC))) {
+        case grpc::CompletionQueue::GOT_EVENT:
+            return true;
+        case grpc::CompletionQueue::SHUTDOWN:
+            return false;
+        case grpc::CompletionQueue::TIMEOUT:
+            break;
+        }
+    }
+}
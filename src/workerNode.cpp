@@ -15,27 +15,53 @@ using grpc::Status;
 using demo::DemoService;
 using demo::Request;
 using demo::Response;
+using demo::BatchRequest;
+using demo::BatchResponse;
 
 class DemoServiceImpl final : public DemoService::Service {
+public:
+    // delayMs: simulated processing time per job, so some workers can be made slower than others
+    explicit DemoServiceImpl(int delayMs) : delayMs_(delayMs) {}
+
+private:
     Status ProcessRequest(ServerContext* context, const Request* request,
                          Response* response) override {
-        
-        std::cout << "Worker received job " << request->jobid() 
-                  << " with query: " << request->query() << std::endl;
+        Process(*request, response);
+        return Status::OK;
+    }
+
+    // The jobs run one after another, as they would one call each, but share
+    // a single RPC's overhead
+    Status ProcessBatch(ServerContext* /*context*/, const BatchRequest* request,
+                        BatchResponse* response) override {
+        std::cout << "Worker received batch of " << request->requests_size() << " jobs" << std::endl;
+        for (const auto& job : request->requests()) {
+            Process(job, response->add_responses());
+        }
+        return Status::OK;
+    }
 
-        response->set_jobid(request->jobid());
-        response->set_result("Processed: " + request->query() + " [Worker Response]");
+    void Process(const Request& request, Response* response) {
+        std::cout << "Worker received job " << request.jobid() 
+                  << " with query: " << request.query() << std::endl;
+
+        if (delayMs_ > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs_));
+        }
+
+        response->set_jobid(request.jobid());
+        response->set_result("Processed: " + request.query() + " [Worker Response]");
         response->set_success(true);
         
-        std::cout << "Worker completed job " << request->jobid() << std::endl;
-        
-        return Status::OK;
+        std::cout << "Worker completed job " << request.jobid() << std::endl;
     }
+
+    int delayMs_;
 };
 
-void RunServer(const std::string& port) {
+void RunServer(const std::string& port, int delayMs) {
     std::string server_address("0.0.0.0:" + port);
-    DemoServiceImpl service;
+    DemoServiceImpl service(delayMs);
 
     ServerBuilder builder;
     builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
@@ -49,13 +75,21 @@ void RunServer(const std::string& port) {
 
 int main(int argc, char** argv) {
     std::string port = "50051";
+    int delayMs = 0;
     
     if (argc > 1) {
         port = argv[1];
     }
+    if (argc > 2) {
+        delayMs = std::stoi(argv[2]);
+    }
     
-    std::cout << "Starting worker node on port " << port << std::endl;
-    RunServer(port);
+    std::cout << "Starting worker node on port " << port;
+    if (delayMs > 0) {
+        std::cout << " (" << delayMs << "ms per job)";
+    }
+    std::cout << std::endl;
+    RunServer(port, delayMs);
     
     return 0;
 }
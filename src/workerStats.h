@@ -0,0 +1,303 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/latencyHistogram.h"
+
+// Worker-side instrumentation that stays off the request path's critical
+// sections: every thread that handles requests records into its own shard of
+// counters and stage histograms, found through a thread_local pointer, so
+// recording is a handful of uncontended relaxed atomics. The shard of a thread
+// that exits, as the sync engine's pollers do, keeps its samples and is handed
+// to the next new thread. Shards are only
+// merged when a snapshot is taken. A resetting snapshot folds the shards into
+// a running total before clearing them, so the cumulative view a scraper reads
+// survives the resets of the head's per-size snapshots.
+//
+//   arrival  head's send timestamp -> handler start: the request's one-way
+//            trip to the handler, wire and gRPC's queues together. gRPC does
+//            not expose when a call reached the server, so this is not the
+//            worker's queue wait alone; across hosts it also includes the
+//            head-worker clock offset, and on a forwarded-to worker every hop
+//            upstream of it.
+//   handler  handler start -> response ready: the worker's whole residence,
+//            including any injected delay and, on a forwarding worker, the
+//            downstream call
+//   forward  downstream call sent -> its response back (forwarding and
+//            multicasting workers only); handler minus forward is the
+//            worker's own work
+//   service  the emulated service time drawn for the request (--service-time
+//            only); handler minus service is the worker's own overhead
+enum class Stage { kArrival, kHandler, kForward, kService };
+constexpr size_t kStageCount = 4;
+
+inline const char* StageName(Stage stage) {
+    switch (stage) {
+    case Stage::kArrival:
+        return "arrival";
+    case Stage::kHandler:
+        return "handler";
+    case Stage::kForward:
+        return "forward";
+    case Stage::kService:
+        return "service";
+    }
+    return "unknown";
+}
+
+struct StatsSnapshot {
+    uint64_t answered = 0;   // requests this worker answered itself
+    uint64_t forwarded = 0;  // requests relayed or multicast to the next workers
+    double intervalSec = 0.0;  // since the last reset, or uptime for the cumulative view
+    size_t threads = 0;      // live threads that have recorded anything
+    std::array<LatencyHistogram, kStageCount> stages;
+};
+
+class WorkerStats {
+public:
+    WorkerStats()
+        : registry_(std::make_shared<Registry>()), start_(std::chrono::steady_clock::now()), intervalStart_(start_) {}
+
+    void Record(Stage stage, int64_t ns) {
+        LocalShard().stages[static_cast<size_t>(stage)].Record(ns < 0 ? 0 : static_cast<uint64_t>(ns));
+    }
+
+    void CountAnswered() { LocalShard().answered.fetch_add(1, std::memory_order_relaxed); }
+    void CountForwarded() { LocalShard().forwarded.fetch_add(1, std::memory_order_relaxed); }
+
+    // Merges every shard into out: the interval since the last reset. With
+    // reset the shards are folded into the total and cleared, and a new
+    // interval starts; a sample recorded while that happens may be lost.
+    void Snapshot(StatsSnapshot* out, bool reset) {
+        std::lock_guard<std::mutex> lock(registry_->mutex);
+        auto now = std::chrono::steady_clock::now();
+        out->intervalSec = std::chrono::duration<double>(now - intervalStart_).count();
+        MergeShards(out);
+        if (reset) {
+            total_.answered += out->answered;
+            total_.forwarded += out->forwarded;
+            for (size_t i = 0; i < kStageCount; ++i) {
+                total_.stages[i].Merge(out->stages[i]);
+            }
+            for (const auto& shard : registry_->shards) {
+                shard->answered.store(0, std::memory_order_relaxed);
+                shard->forwarded.store(0, std::memory_order_relaxed);
+                for (auto& stage : shard->stages) {
+                    stage.Reset();
+                }
+            }
+            intervalStart_ = now;
+        }
+    }
+
+    // Everything since the worker started, resets or not
+    void Cumulative(StatsSnapshot* out) {
+        std::lock_guard<std::mutex> lock(registry_->mutex);
+        out->intervalSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+        MergeShards(out);
+        out->answered += total_.answered;
+        out->forwarded += total_.forwarded;
+        for (size_t i = 0; i < kStageCount; ++i) {
+            out->stages[i].Merge(total_.stages[i]);
+        }
+    }
+
+    // Prometheus text exposition format of the cumulative view, for scraping
+    // the periodic dump
+    static void WriteText(std::ostream& out, const StatsSnapshot& snapshot, uint64_t logDropped) {
+        out << "# TYPE worker_requests_answered counter\n"
+            << "worker_requests_answered " << snapshot.answered << "\n"
+            << "# TYPE worker_requests_forwarded counter\n"
+            << "worker_requests_forwarded " << snapshot.forwarded << "\n"
+            << "# TYPE worker_uptime_seconds gauge\n"
+            << "worker_uptime_seconds " << snapshot.intervalSec << "\n"
+            << "# TYPE worker_stats_threads gauge\n"
+            << "worker_stats_threads " << snapshot.threads << "\n"
+            << "# TYPE worker_log_dropped counter\n"
+            << "worker_log_dropped " << logDropped << "\n"
+            << "# TYPE worker_stage_seconds summary\n";
+        for (size_t i = 0; i < kStageCount; ++i) {
+            const LatencyHistogram& histogram = snapshot.stages[i];
+            const char* name = StageName(static_cast<Stage>(i));
+            for (double quantile : {0.5, 0.9, 0.99}) {
+                out << "worker_stage_seconds{stage=\"" << name << "\",quantile=\"" << quantile << "\"} "
+                    << histogram.ValueAtPercentile(quantile * 100.0) / 1e9 << "\n";
+            }
+            out << "worker_stage_seconds_sum{stage=\"" << name << "\"} "
+                << histogram.MeanNs() * histogram.TotalCount() / 1e9 << "\n"
+                << "worker_stage_seconds_count{stage=\"" << name << "\"} " << histogram.TotalCount() << "\n";
+        }
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> answered{0};
+        std::atomic<uint64_t> forwarded{0};
+        std::array<LatencyHistogram, kStageCount> stages;
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Shard>> shards;
+        std::vector<Shard*> idle;  // shards of exited threads
+    };
+
+    // Gives the thread's shard back when the thread exits. It shares the
+    // registry, so whichever of the thread and the WorkerStats ends last frees it.
+    struct LocalHandle {
+        std::shared_ptr<Registry> registry;
+        Shard* shard = nullptr;
+
+        ~LocalHandle() { Release(); }
+
+        void Release() {
+            if (registry) {
+                std::lock_guard<std::mutex> lock(registry->mutex);
+                registry->idle.push_back(shard);
+            }
+        }
+    };
+
+    void MergeShards(StatsSnapshot* out) const {
+        out->threads = registry_->shards.size() - registry_->idle.size();
+        for (const auto& shard : registry_->shards) {
+            out->answered += shard->answered.load(std::memory_order_relaxed);
+            out->forwarded += shard->forwarded.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < kStageCount; ++i) {
+                out->stages[i].Merge(shard->stages[i]);
+            }
+        }
+    }
+
+    // A worker process has one WorkerStats; the registry check keeps a
+    // thread's cached shard from leaking into another instance all the same.
+    Shard& LocalShard() {
+        thread_local LocalHandle local;
+        if (local.registry != registry_) {
+            local.Release();
+            std::lock_guard<std::mutex> lock(registry_->mutex);
+            if (registry_->idle.empty()) {
+                registry_->shards.push_back(std::make_unique<Shard>());
+                local.shard = registry_->shards.back().get();
+            } else {
+                local.shard = registry_->idle.back();
+                registry_->idle.pop_back();
+            }
+            local.registry = registry_;
+        }
+        return *local.shard;
+    }
+
+    std::shared_ptr<Registry> registry_;
+    StatsSnapshot total_;  // folded in by resets
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point intervalStart_;
+};
+
+// Log lines from the request path go through a bounded multi-producer ring
+// and are written to stdout by a background thread, so a handler never takes
+// the stdout lock or waits for a flush. Formatting is a vsnprintf into the
+// claimed slot. When the ring is full the line is dropped and counted rather
+// than blocking the caller.
+class AsyncLog {
+public:
+    static constexpr size_t kSlots = 1024;  // power of two
+    static constexpr size_t kLineBytes = 192;
+
+    AsyncLog() {
+        for (size_t i = 0; i < kSlots; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        writer_ = std::thread([this]() { Drain(); });
+    }
+
+    ~AsyncLog() {
+        stopping_.store(true, std::memory_order_release);
+        writer_.join();
+    }
+
+    AsyncLog(const AsyncLog&) = delete;
+    AsyncLog& operator=(const AsyncLog&) = delete;
+
+    // A newline is added
+    __attribute__((format(printf, 2, 3))) void Printf(const char* format, ...) {
+        size_t position = enqueue_.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots_[position & (kSlots - 1)];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (enqueue_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            } else {
+                position = enqueue_.load(std::memory_order_relaxed);
+            }
+        }
+
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(slot->text, kLineBytes - 1, format, args);
+        va_end(args);
+        length = length < 0 ? 0 : std::min<int>(length, kLineBytes - 2);
+        slot->text[length] = '\n';
+        slot->length = static_cast<size_t>(length) + 1;
+        slot->sequence.store(position + 1, std::memory_order_release);
+    }
+
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        size_t length = 0;
+        char text[kLineBytes];
+    };
+
+    void Drain() {
+        static constexpr auto kIdle = std::chrono::milliseconds(5);
+        size_t position = 0;
+        while (true) {
+            bool wrote = false;
+            while (true) {
+                Slot& slot = slots_[position & (kSlots - 1)];
+                if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+                    break;
+                }
+                fwrite(slot.text, 1, slot.length, stdout);
+                slot.sequence.store(position + kSlots, std::memory_order_release);
+                ++position;
+                wrote = true;
+            }
+            if (wrote) {
+                fflush(stdout);
+            } else if (stopping_.load(std::memory_order_acquire)) {
+                return;
+            } else {
+                std::this_thread::sleep_for(kIdle);
+            }
+        }
+    }
+
+    std::array<Slot, kSlots> slots_;
+    alignas(64) std::atomic<size_t> enqueue_{0};
+    alignas(64) std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> stopping_{false};
+    std::thread writer_;
+};